@@ -32,6 +32,7 @@
 #include "Colors.h"
 #include "UI\DialogueWidget.h"
 #include "ResourceManager.h"
+#include "ResourceStreamManager.h"
 #include "Config.h"
 
 #include "WorldObject.h"
@@ -41,6 +42,20 @@ Gameplay::Gameplay()
     m_hoverObject = nullptr;
     m_dialogueWidget = nullptr;
     m_dialogueSourceGUID = 0;
+    m_player = nullptr;
+    m_loginTime = 0;
+    m_resumeToken = 0;
+    m_resumeState = SESSION_RESUME_NONE;
+    m_resumeAttempts = 0;
+    m_resumeRetryTime = 0;
+    m_connectionLostTime = 0;
+    m_connectionLost = false;
+    m_currentMap = nullptr;
+    m_currentChunkX = 0;
+    m_currentChunkY = 0;
+    m_prefetchChunkX = 0;
+    m_prefetchChunkY = 0;
+    ResetMovementState(0.0f, 0.0f);
 }
 
 void Gameplay::ConnectToServer()
@@ -48,12 +63,28 @@ void Gameplay::ConnectToServer()
     sNetwork->Connect(sConfig->GetStringValue(CONFIG_STRING_CONNECT_HOST), (uint16_t)sConfig->GetIntValue(CONFIG_INT_CONNECT_PORT));
 }
 
+uint32_t Gameplay::GetOfferedCapabilities()
+{
+    // offer optional protocol features; older servers ignore them, newer confirm those they are going to use
+    uint32_t capabilities = PROTOCOL_CAP_LARGE_FRAMES | PROTOCOL_CAP_SESSION_RESUME | PROTOCOL_CAP_CHECKSUM_BATCH_ID | PROTOCOL_CAP_PING;
+    if (sConfig->GetIntValue(CONFIG_INT_NETWORK_COMPACT_UPDATES) != 0)
+        capabilities |= PROTOCOL_CAP_COMPACT_OBJECT_UPDATES;
+
+    return capabilities;
+}
+
 void Gameplay::Login(const char* username, const char* password)
 {
+    m_loginTime = getMSTime();
+    m_resumeToken = 0;
+
+    sNetwork->SetProtocolCapabilities(PROTOCOL_CAP_NONE);
+
     SmartPacket pkt(CP_LOGIN_REQUEST);
     pkt.WriteString(username);
     pkt.WriteString(password);
     pkt.WriteUInt32(APP_VERSION);
+    pkt.WriteUInt32(GetOfferedCapabilities());
     sNetwork->SendPacket(pkt);
 }
 
@@ -74,11 +105,173 @@ void Gameplay::EnterWorld(uint32_t guid)
     sApplication->SetStageType(STAGE_CONNECTING);
 }
 
+void Gameplay::SetResumeToken(uint64_t token)
+{
+    m_resumeToken = token;
+}
+
+void Gameplay::SignalConnectionLost()
+{
+    // just mark it, the rest is done in main thread
+    m_connectionLost = true;
+}
+
+bool Gameplay::IsResumingSession()
+{
+    return (m_resumeState != SESSION_RESUME_NONE);
+}
+
+void Gameplay::UpdateSessionResume()
+{
+    uint32_t now = getMSTime();
+
+    if (m_connectionLost.exchange(false))
+    {
+        // we wanted to disconnect, or there's nothing to resume
+        if (sNetwork->IsDisconnectRequested() || m_resumeToken == 0 || !m_player || !m_currentMap)
+            return;
+
+        if (m_resumeState == SESSION_RESUME_NONE)
+        {
+            sLog->Info("Connection lost, trying to resume session");
+            m_connectionLostTime = now;
+            m_resumeAttempts = 0;
+            sApplication->SignalGlobalEvent(GA_CONNECTION_RESUMING);
+        }
+
+        if (m_resumeAttempts >= SESSION_RESUME_ATTEMPTS)
+        {
+            AbandonSession();
+            return;
+        }
+
+        // the first attempt goes right away, the connection could have been just reset
+        m_resumeRetryTime = now + (m_resumeAttempts == 0 ? 0 : SESSION_RESUME_RETRY_DELAY);
+        m_resumeAttempts++;
+        m_resumeState = SESSION_RESUME_WAITING;
+    }
+
+    switch (m_resumeState)
+    {
+        case SESSION_RESUME_WAITING:
+            if ((int32_t)(now - m_resumeRetryTime) >= 0)
+            {
+                m_resumeState = SESSION_RESUME_CONNECTING;
+                ConnectToServer();
+            }
+            break;
+        case SESSION_RESUME_CONNECTING:
+            // connected, ask for the old session instead of logging in
+            if (sNetwork->GetConnectionState() == CONNECTION_STATE_AUTH)
+            {
+                m_resumeState = SESSION_RESUME_REQUESTED;
+                SendResumeSession();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Gameplay::SendResumeSession()
+{
+    sNetwork->SetProtocolCapabilities(PROTOCOL_CAP_NONE);
+
+    SmartPacket pkt(CP_RESUME_SESSION);
+    pkt.WriteUInt64(m_resumeToken);
+    pkt.WriteUInt32(APP_VERSION);
+    pkt.WriteUInt32(GetOfferedCapabilities());
+    sNetwork->SendPacket(pkt);
+}
+
+void Gameplay::SignalSessionResumed(uint32_t mapId, float posX, float posY)
+{
+    // the world we kept is of no use on another map
+    if (!m_player || !m_currentMap || m_currentMap->GetId() != mapId)
+    {
+        AbandonSession();
+        sNetwork->Disconnect();
+        return;
+    }
+
+    // objects around could have changed while we were away; the server sends everything it sees now
+    std::vector<WorldObject*> foreign;
+    ObjectGuidMap const& objects = m_currentMap->GetObjectGuidMap();
+    for (ObjectGuidMap::const_iterator itr = objects.begin(); itr != objects.end(); ++itr)
+    {
+        if (itr->second != m_player)
+            foreign.push_back(itr->second);
+    }
+
+    for (WorldObject* obj : foreign)
+    {
+        m_currentMap->RemoveWorldObject(obj);
+        delete obj;
+    }
+
+    // server-side state of these was lost with the connection
+    EndDialogue();
+    m_nameQuerySent.clear();
+    m_itemQuerySent.clear();
+
+    // continue from position known to server
+    m_player->SetPosition(posX, posY);
+    ResetMovementState(posX, posY);
+
+    sNetwork->SetConnectionState(CONNECTION_STATE_INGAME);
+    m_resumeState = SESSION_RESUME_NONE;
+    m_resumeAttempts = 0;
+
+    // map, chunks and caches were kept; just resend requests the old connection did not answer
+    m_chunkScheduler.RetryInFlight();
+    RequestSorroundingChunks();
+
+    // replies to verifications sent over the old connection will never come; Update sends them again
+    sResourceStreamManager->RequeuePendingChecksums();
+
+    SendInventoryRequest();
+
+    sLog->Info("Session resumed %u ms after losing connection", getMSTimeDiff(m_connectionLostTime, getMSTime()));
+
+    sDrawing->SetCanvasRedrawFlag();
+    sApplication->SignalGlobalEvent(GA_CONNECTION_RESUMED);
+}
+
+void Gameplay::AbandonSession()
+{
+    sLog->Error("Could not resume session, full login is needed");
+
+    m_resumeState = SESSION_RESUME_NONE;
+    m_resumeToken = 0;
+
+    sApplication->SignalGlobalEvent(GA_CONNECTION_RESUME_FAILED);
+}
+
 void Gameplay::Update()
 {
+    UpdateSessionResume();
+
+    // verifications the send buffer could not take are sent again, once there's a connection to send them to
+    if (m_resumeState == SESSION_RESUME_NONE)
+        sResourceStreamManager->ResendUnsentChecksums();
+
     // update map only when in game stage
     if (sApplication->GetStageType() == STAGE_GAME && m_currentMap)
+    {
         m_currentMap->Update();
+
+        // nothing is sent until the session is resumed
+        if (m_player && m_resumeState == SESSION_RESUME_NONE)
+        {
+            UpdateMovementHeartbeat();
+
+            // request chunks we are moving to
+            UpdateChunkStreaming();
+
+            // send more chunk requests, if the window allows it
+            m_chunkScheduler.Update(m_player->GetPositionX(), m_player->GetPositionY());
+        }
+    }
 }
 
 void Gameplay::MovementKeyEvent(MoveDirectionElement dir, bool press)
@@ -86,34 +279,122 @@ void Gameplay::MovementKeyEvent(MoveDirectionElement dir, bool press)
     // if player is created
     if (m_player)
     {
+        // movement is applied locally right away, server gets informed in next heartbeat update
+
         // start movement on press
         if (press)
         {
             if (!m_player->IsMovingInDirection(dir))
-            {
-                SmartPacket pkt(CP_MOVE_START_DIRECTION);
-                pkt.WriteUInt8(dir);
-                sNetwork->SendPacket(pkt);
-
                 m_player->StartMovementInDirection(dir);
-            }
         }
         else // stop movement on release
         {
             if (m_player->IsMovingInDirection(dir))
-            {
-                SmartPacket pkt(CP_MOVE_STOP_DIRECTION);
-                pkt.WriteUInt8(dir);
-                pkt.WriteFloat(m_player->GetPositionX());
-                pkt.WriteFloat(m_player->GetPositionY());
-                sNetwork->SendPacket(pkt);
-
                 m_player->StopMovementInDirection(dir);
-            }
+        }
+
+        // start coalescing window with first change (zero is reserved for "nothing pending")
+        if (m_pendingMovementTime == 0)
+        {
+            m_pendingMovementTime = getMSTime();
+            if (m_pendingMovementTime == 0)
+                m_pendingMovementTime = 1;
         }
     }
 }
 
+void Gameplay::ResetMovementState(float x, float y)
+{
+    m_sentMoveMask = 0;
+    m_sentPositionX = x;
+    m_sentPositionY = y;
+    m_sentMovementTime = getMSTime();
+    m_pendingMovementTime = 0;
+}
+
+void Gameplay::UpdateMovementHeartbeat()
+{
+    uint32_t now = getMSTime();
+    uint8_t moveMask = m_player->GetMoveMask();
+    uint32_t sinceSent = getMSTimeDiff(m_sentMovementTime, now);
+
+    // key changes are collected for a while, so fast toggles result in just one packet
+    if (m_pendingMovementTime != 0)
+    {
+        if (getMSTimeDiff(m_pendingMovementTime, now) < MOVEMENT_COALESCE_WINDOW)
+            return;
+
+        m_pendingMovementTime = 0;
+
+        // the keys were released to the original state - check drift below
+        if (moveMask != m_sentMoveMask)
+        {
+            SendMovementUpdate(moveMask, m_player->GetPositionX(), m_player->GetPositionY());
+            return;
+        }
+    }
+
+    // server does not move us, when not moving, and we had sent exact position when we stopped
+    if (m_sentMoveMask == 0 && moveMask == 0 && m_player->GetPositionX() == m_sentPositionX && m_player->GetPositionY() == m_sentPositionY)
+        return;
+
+    // where the server thinks we are (collisions are the main source of difference)
+    Vector2 vec = m_player->GetMovementVector(m_sentMoveMask);
+    float expX = m_sentPositionX + vec.x * (float)sinceSent;
+    float expY = m_sentPositionY + vec.y * (float)sinceSent;
+
+    float drift = sqrt(pow(m_player->GetPositionX() - expX, 2.0f) + pow(m_player->GetPositionY() - expY, 2.0f));
+
+    if ((drift >= MOVEMENT_HEARTBEAT_DRIFT && sinceSent >= MOVEMENT_HEARTBEAT_MIN_INTERVAL)
+        || (moveMask != 0 && sinceSent >= MOVEMENT_HEARTBEAT_MAX_INTERVAL))
+    {
+        SendMovementUpdate(moveMask, m_player->GetPositionX(), m_player->GetPositionY());
+    }
+}
+
+void Gameplay::SendMovementUpdate(uint8_t moveMask, float x, float y)
+{
+    uint8_t changed = moveMask ^ m_sentMoveMask;
+
+    // single direction change is described by direction packets, which are shorter
+    if (changed != 0 && (changed & (changed - 1)) == 0)
+    {
+        if ((moveMask & changed) != 0)
+        {
+            SmartPacket pkt(CP_MOVE_START_DIRECTION);
+            pkt.WriteUInt8(changed);
+            sNetwork->SendPacket(pkt);
+
+            // server continues from the position it expects
+            Vector2 vec = m_player->GetMovementVector(m_sentMoveMask);
+            uint32_t sinceSent = getMSTimeDiff(m_sentMovementTime, getMSTime());
+            x = m_sentPositionX + vec.x * (float)sinceSent;
+            y = m_sentPositionY + vec.y * (float)sinceSent;
+        }
+        else
+        {
+            SmartPacket pkt(CP_MOVE_STOP_DIRECTION);
+            pkt.WriteUInt8(changed);
+            pkt.WriteFloat(x);
+            pkt.WriteFloat(y);
+            sNetwork->SendPacket(pkt);
+        }
+    }
+    else // multiple changes at once, or position correction
+    {
+        SmartPacket pkt(CP_MOVE_HEARTBEAT);
+        pkt.WriteUInt8(moveMask);
+        pkt.WriteFloat(x);
+        pkt.WriteFloat(y);
+        sNetwork->SendPacket(pkt);
+    }
+
+    m_sentMoveMask = moveMask;
+    m_sentPositionX = x;
+    m_sentPositionY = y;
+    m_sentMovementTime = getMSTime();
+}
+
 void Gameplay::CreatePlayer(uint32_t mapId, float posX, float posY)
 {
     // init inventory
@@ -127,6 +408,8 @@ void Gameplay::CreatePlayer(uint32_t mapId, float posX, float posY)
     m_player->SetMapId(mapId);
     m_player->SetPosition(posX, posY);
 
+    ResetMovementState(posX, posY);
+
     LoadMap(mapId);
 }
 
@@ -157,6 +440,13 @@ void Gameplay::LoadMap(uint32_t mapId)
     m_currentMap = new Map();
     m_currentMap->SetId(mapId);
 
+    // the same header was already verified with current server content
+    if (sVerificationStorage->IsVerified(VERIFIED_CONTENT_MAP, mapId, 0, 0, mrec->headerChecksum.c_str()))
+    {
+        SignalMapLoaded(mapId);
+        return;
+    }
+
     // and verify checksum
     SendRequestMapMetadataChecksumVerify(mapId, mrec->headerChecksum.c_str());
 }
@@ -184,6 +474,9 @@ void Gameplay::SignalMapLoaded(uint32_t mapId)
         return;
     }
 
+    // remember verified header for next sessions
+    sVerificationStorage->SetVerified(VERIFIED_CONTENT_MAP, mapId, 0, 0, mrec->headerChecksum.c_str());
+
     // load contents
     m_currentMap->LoadFromFile();
 
@@ -191,6 +484,9 @@ void Gameplay::SignalMapLoaded(uint32_t mapId)
     if (m_player)
         m_currentMap->AddWorldObject(m_player);
 
+    // chunks of previous map are no longer interesting
+    m_chunkScheduler.Reset(m_currentMap->GetId());
+
     // store current location
     m_currentChunkX = m_currentMap->GetChunkIndexX((uint32_t)m_player->GetPositionX());
     m_currentChunkY = m_currentMap->GetChunkIndexY((uint32_t)m_player->GetPositionY());
@@ -255,10 +551,6 @@ void Gameplay::SendRequestMapChunk(uint32_t mapId, uint32_t startX, uint32_t sta
 
 void Gameplay::SendRequestMapChunkChecksumVerify(uint32_t mapId, uint32_t startX, uint32_t startY, const char* checksum)
 {
-    // TODO: request chunk checksum just once per session!!! The chunk cannot change while the server is running!
-    //       the Gameplay class expects SignalChunkLoaded callback call, so when the checksum had already been
-    //       verified, just call this method and everything should work fine
-
     SmartPacket pkt(CP_MAP_CHUNK_VERIFY_CHECKSUM);
     pkt.WriteUInt32(mapId);
     pkt.WriteUInt32(startX);
@@ -366,39 +658,104 @@ void Gameplay::RequestSorroundingChunks(bool force)
 
             // if forced, or if we are moving to new chunks, request them
             if (force || iX > endX_old || iX < beginX_old || iY > endY_old || iY < beginY_old)
-            {
-                m_chunkLoadQueue.push_back(ChunkLoadQueueRecord(startX, startY));
-
-                if (MapChunkDatabaseRecord* mrec = sMapStorage->GetMapChunkRecord(m_currentMap->GetId(), startX, startY))
-                    SendRequestMapChunkChecksumVerify(m_currentMap->GetId(), startX, startY, mrec->checksum.c_str());
-                else
-                    SendRequestMapChunk(m_currentMap->GetId(), startX, startY);
-            }
+                m_chunkScheduler.Enqueue(startX, startY);
         }
     }
+
+    // we are no longer interested in chunks we moved away from (including the ones prefetched in another direction)
+    m_chunkScheduler.CancelOutside(beginX, beginY, endX, endY);
+
+    // store current location; prefetch is evaluated again from here
+    m_currentChunkX = cellX;
+    m_currentChunkY = cellY;
+    m_prefetchChunkX = cellX;
+    m_prefetchChunkY = cellY;
+
+    // send the nearest requests right away
+    m_chunkScheduler.Update(m_player->GetPositionX(), m_player->GetPositionY());
+
+    // all the chunks may have been served from cache
+    CheckChunksLoaded();
+}
+
+void Gameplay::UpdateChunkStreaming()
+{
+    float posX = m_player->GetPositionX();
+    float posY = m_player->GetPositionY();
+
+    // the player is in new chunk just after getting far enough from the old one, so walking along the boundary
+    // does not request and cancel the same chunks over and over again
+    float chunkX = (float)Map::GetChunkStartX(m_currentChunkX);
+    float chunkY = (float)Map::GetChunkStartY(m_currentChunkY);
+    if (posX < chunkX - MAP_CHUNK_HYSTERESIS || posX >= chunkX + MAP_CHUNK_SIZE_X + MAP_CHUNK_HYSTERESIS
+        || posY < chunkY - MAP_CHUNK_HYSTERESIS || posY >= chunkY + MAP_CHUNK_SIZE_Y + MAP_CHUNK_HYSTERESIS)
+    {
+        // request newly entered ring of chunks
+        RequestSorroundingChunks();
+    }
+
+    // look ahead along movement vector
+    Vector2 vec = m_player->GetMovementVector(m_player->GetMoveMask());
+    float aheadX = num_max(posX + vec.x * MAP_CHUNK_PREFETCH_TIME, 0.0f);
+    float aheadY = num_max(posY + vec.y * MAP_CHUNK_PREFETCH_TIME, 0.0f);
+
+    uint32_t prefetchX = Map::GetChunkIndexX((uint32_t)aheadX);
+    uint32_t prefetchY = Map::GetChunkIndexY((uint32_t)aheadY);
+
+    if (prefetchX == m_prefetchChunkX && prefetchY == m_prefetchChunkY)
+        return;
+
+    m_prefetchChunkX = prefetchX;
+    m_prefetchChunkY = prefetchY;
+
+    // schedule surroundings of the place we are heading to; the scheduler skips what we already have,
+    // and the distance ordering sends them after the chunks around us
+    uint32_t beginX, beginY, endX, endY, iX, iY;
+    m_currentMap->GetCellSorroundingLimits(prefetchX, prefetchY, beginX, beginY, endX, endY);
+
+    for (iX = beginX; iX <= endX; iX++)
+        for (iY = beginY; iY <= endY; iY++)
+            m_chunkScheduler.Enqueue(Map::GetChunkStartX(iX), Map::GetChunkStartY(iY));
+
+    CheckChunksLoaded();
 }
 
-void Gameplay::SignalChunkLoaded(uint32_t startX, uint32_t startY)
+void Gameplay::SignalChunkLoaded(uint32_t startX, uint32_t startY, bool fromCache)
 {
-    sLog->Info("Chunk [%u ; %u] loaded!", startX, startY);
+    sLog->Info("Chunk [%u ; %u] loaded%s!", startX, startY, fromCache ? " from cache" : "");
+
+    // erase chunk from scheduler, this frees space for another request
+    m_chunkScheduler.SignalLoaded(startX, startY);
 
-    // erase chunk from loadlist
-    for (std::list<ChunkLoadQueueRecord>::iterator itr = m_chunkLoadQueue.begin(); itr != m_chunkLoadQueue.end(); ++itr)
+    // remember verified chunk for next sessions; cached chunks are verified already
+    if (!fromCache)
     {
-        if ((*itr).startX == startX && (*itr).startY == startY)
-        {
-            m_chunkLoadQueue.erase(itr);
-            break;
-        }
+        if (MapChunkDatabaseRecord* mrec = sMapStorage->GetMapChunkRecord(m_currentMap->GetId(), startX, startY))
+            sVerificationStorage->SetVerified(VERIFIED_CONTENT_MAP_CHUNK, m_currentMap->GetId(), startX, startY, mrec->checksum.c_str());
     }
 
     // redraw, since there's new content
     sDrawing->SetCanvasRedrawFlag();
 
-    if (m_chunkLoadQueue.empty())
+    // cached chunks are signalled while the sorroundings are still being enqueued, the caller checks
+    // the idle state when it's done
+    if (!fromCache)
+        CheckChunksLoaded();
+}
+
+void Gameplay::CheckChunksLoaded()
+{
+    if (m_chunkScheduler.IsIdle())
     {
         // All chunks loaded
 
+        // report just the first time after login, it's the number benchmarks are interested in
+        if (m_loginTime != 0)
+        {
+            sLog->Info("World playable %u ms after login", getMSTimeDiff(m_loginTime, getMSTime()));
+            m_loginTime = 0;
+        }
+
         // TODO: allow player movement here, or something like that
     }
 }
@@ -471,6 +828,10 @@ WorldObject* Gameplay::GetForeignObject(uint64_t guid)
 
 void Gameplay::AddChatMessage(TalkType type, const wchar_t* author, const wchar_t* message)
 {
+    // headless bot has nowhere to render messages to
+    if (sApplication->IsHeadless())
+        return;
+
     std::wstring toPrint = L"";
 
     // server messages behaves differently
@@ -602,6 +963,10 @@ void Gameplay::CheckHoverObject()
 
 void Gameplay::StartOrResetDialogue(uint64_t sourceGuid, const wchar_t* headerText)
 {
+    // headless bot does not display dialogues
+    if (sApplication->IsHeadless())
+        return;
+
     // if no dialogue widget present, create one
     if (!m_dialogueWidget)
         m_dialogueWidget = DialogueWidget::Create(headerText);
@@ -21,6 +21,9 @@
 #define BW_GAMEPLAY_H
 
 #include "Singleton.h"
+#include "MapChunkScheduler.h"
+
+#include <atomic>
 
 class WorldObject;
 class Map;
@@ -35,6 +38,36 @@ enum MoveDirectionElement;
 // maximum number of slots the character could have in his inventory
 #define CHARACTER_INVENTORY_SLOTS 100
 
+// time for which movement key changes are merged into one packet (ms)
+#define MOVEMENT_COALESCE_WINDOW 40
+// distance between real position and position expected by server, that triggers heartbeat
+#define MOVEMENT_HEARTBEAT_DRIFT 0.15f
+// minimum time between two drift triggered heartbeats (ms)
+#define MOVEMENT_HEARTBEAT_MIN_INTERVAL 100
+// maximum time between two heartbeats during movement (ms)
+#define MOVEMENT_HEARTBEAT_MAX_INTERVAL 1000
+
+// distance the player has to walk beyond chunk boundary to be considered in the new chunk (fields)
+#define MAP_CHUNK_HYSTERESIS 2.0f
+// chunks around the position the player would reach in this time (ms) are requested in advance
+#define MAP_CHUNK_PREFETCH_TIME 3000.0f
+
+// count of reconnection attempts before lost session is abandoned
+#define SESSION_RESUME_ATTEMPTS 5
+// delay between two reconnection attempts (ms)
+#define SESSION_RESUME_RETRY_DELAY 2000
+
+/*
+ * State of lost session resuming
+ */
+enum SessionResumeState
+{
+    SESSION_RESUME_NONE = 0,            // not resuming
+    SESSION_RESUME_WAITING = 1,         // waiting for next reconnection attempt
+    SESSION_RESUME_CONNECTING = 2,      // reconnecting to server
+    SESSION_RESUME_REQUESTED = 3,       // resume request sent, waiting for response
+};
+
 /*
  * Structure for character list record
  */
@@ -50,19 +83,6 @@ struct CharacterListRecord
     // TODO: more
 };
 
-/*
- * Queue record for loading map chunks
- */
-struct ChunkLoadQueueRecord
-{
-    ChunkLoadQueueRecord(uint32_t sX, uint32_t sY) : startX(sX), startY(sY) {};
-
-    // startX coordinate of chunk
-    uint32_t startX;
-    // startY coordinate of chunk
-    uint32_t startY;
-};
-
 /*
  * Record of chat message (rendered)
  */
@@ -117,6 +137,16 @@ class Gameplay
         void RequestCharacterList();
         // send world enter packet
         void EnterWorld(uint32_t guid);
+        // sets token the session could be resumed with after losing connection; 0 = not resumable
+        void SetResumeToken(uint64_t token);
+        // signals lost connection or failed connection attempt; could be called from network thread
+        void SignalConnectionLost();
+        // restores in-game state after server accepted session resume
+        void SignalSessionResumed(uint32_t mapId, float posX, float posY);
+        // gives up resuming lost session; the player has to log in again
+        void AbandonSession();
+        // is the client trying to resume lost session?
+        bool IsResumingSession();
 
         // updates entities and maps
         void Update();
@@ -170,8 +200,12 @@ class Gameplay
 
         // send request packets for chunks sorrounding current player; force parameter causes ignoring cached state
         void RequestSorroundingChunks(bool force = false);
-        // signals gameplay class, that the chunk was successfully retrieved and loaded
-        void SignalChunkLoaded(uint32_t startX, uint32_t startY);
+        // signals gameplay class, that the chunk was successfully retrieved and loaded; fromCache marks chunk verified in previous session
+        void SignalChunkLoaded(uint32_t startX, uint32_t startY, bool fromCache = false);
+        // checks whether all requested chunks are loaded and reports it
+        void CheckChunksLoaded();
+        // checks player chunk change and requests chunks around the player and ahead of him
+        void UpdateChunkStreaming();
 
         // creates object in world using only guid for initialization
         WorldObject* CreateForeignObject(uint64_t guid);
@@ -216,12 +250,40 @@ class Gameplay
         // protected singleton constructor
         Gameplay();
 
+        // retrieves protocol capabilities offered to server
+        uint32_t GetOfferedCapabilities();
+        // reconnects and sends resume request, when it's time to do so
+        void UpdateSessionResume();
+        // sends session resume request using stored token
+        void SendResumeSession();
+
         // checks delayed item operation list and reports newly loaded items
         void CheckDelayedItemOperationsFor(uint32_t itemId);
 
+        // sends movement state of local player to server, when needed
+        void UpdateMovementHeartbeat();
+        // sends packet describing change from last sent movement state to the current one
+        void SendMovementUpdate(uint8_t moveMask, float x, float y);
+        // resets movement state known to server
+        void ResetMovementState(float x, float y);
+
     private:
         // guid of current player
         uint32_t m_playerGuid;
+        // time of sending login request, until the world becomes playable (mstime; 0 when not measuring)
+        uint32_t m_loginTime;
+        // token the session could be resumed with; 0 if none
+        uint64_t m_resumeToken;
+        // state of lost session resuming
+        SessionResumeState m_resumeState;
+        // count of reconnection attempts of current resume
+        uint32_t m_resumeAttempts;
+        // time of next reconnection attempt (mstime)
+        uint32_t m_resumeRetryTime;
+        // time the connection was lost (mstime)
+        uint32_t m_connectionLostTime;
+        // was the connection lost since last update? set by network thread
+        std::atomic<bool> m_connectionLost;
         // character list used in lobby stage
         std::list<CharacterListRecord*> m_characterList;
 
@@ -233,9 +295,24 @@ class Gameplay
         uint32_t m_currentChunkX;
         // current player chunk Y coordinate
         uint32_t m_currentChunkY;
-
-        // queue of chunks that are currently being retrieved or loaded
-        std::list<ChunkLoadQueueRecord> m_chunkLoadQueue;
+        // chunk X coordinate, which surroundings were prefetched last time
+        uint32_t m_prefetchChunkX;
+        // chunk Y coordinate, which surroundings were prefetched last time
+        uint32_t m_prefetchChunkY;
+
+        // movement mask last sent to server
+        uint8_t m_sentMoveMask;
+        // position X last sent to server
+        float m_sentPositionX;
+        // position Y last sent to server
+        float m_sentPositionY;
+        // time of last sent movement packet
+        uint32_t m_sentMovementTime;
+        // time of first movement key change not yet sent to server; 0 if none
+        uint32_t m_pendingMovementTime;
+
+        // scheduler of chunks that are currently being retrieved or loaded
+        MapChunkScheduler m_chunkScheduler;
         // set of item queries that has been sent
         std::set<uint32_t> m_itemQuerySent;
         // chat message history
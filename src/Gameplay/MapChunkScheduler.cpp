@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "MapChunkScheduler.h"
+#include "Gameplay.h"
+#include "Map.h"
+#include "MapStorage.h"
+#include "StorageManager.h"
+
+#include <algorithm>
+
+MapChunkScheduler::MapChunkScheduler()
+{
+    m_mapId = 0;
+    m_inFlightCount = 0;
+}
+
+MapChunkScheduler::~MapChunkScheduler()
+{
+    //
+}
+
+uint64_t MapChunkScheduler::MakeChunkKey(uint32_t startX, uint32_t startY)
+{
+    return ((uint64_t)startX << 32) | (uint64_t)startY;
+}
+
+void MapChunkScheduler::Reset(uint32_t mapId)
+{
+    m_mapId = mapId;
+    m_requests.clear();
+    m_loadedChunks.clear();
+    m_inFlightCount = 0;
+}
+
+void MapChunkScheduler::Enqueue(uint32_t startX, uint32_t startY)
+{
+    uint64_t key = MakeChunkKey(startX, startY);
+
+    // the chunk cannot change while the server is running, so it's loaded just once per session
+    if (m_loadedChunks.find(key) != m_loadedChunks.end())
+        return;
+
+    // merge with existing request
+    if (m_requests.find(key) != m_requests.end())
+        return;
+
+    // cached chunk verified with current server content is already loaded from map file
+    MapChunkDatabaseRecord* mrec = sMapStorage->GetMapChunkRecord(m_mapId, startX, startY);
+    if (mrec && sVerificationStorage->IsVerified(VERIFIED_CONTENT_MAP_CHUNK, m_mapId, startX, startY, mrec->checksum.c_str()))
+    {
+        sGameplay->SignalChunkLoaded(startX, startY, true);
+        return;
+    }
+
+    MapChunkRequest &request = m_requests[key];
+    request.startX = startX;
+    request.startY = startY;
+    request.inFlight = false;
+    request.sentTime = 0;
+}
+
+void MapChunkScheduler::CancelOutside(uint32_t beginX, uint32_t beginY, uint32_t endX, uint32_t endY)
+{
+    uint32_t iX, iY;
+
+    for (std::unordered_map<uint64_t, MapChunkRequest>::iterator itr = m_requests.begin(); itr != m_requests.end(); )
+    {
+        iX = Map::GetChunkIndexX(itr->second.startX);
+        iY = Map::GetChunkIndexY(itr->second.startY);
+
+        // requests already sent could not be taken back, their response just frees the window
+        if (!itr->second.inFlight && (iX < beginX || iX > endX || iY < beginY || iY > endY))
+            itr = m_requests.erase(itr);
+        else
+            ++itr;
+    }
+}
+
+void MapChunkScheduler::Update(float posX, float posY)
+{
+    uint32_t now = getMSTime();
+    std::vector<std::pair<float, MapChunkRequest*>> waiting;
+    float dx, dy;
+
+    for (std::unordered_map<uint64_t, MapChunkRequest>::iterator itr = m_requests.begin(); itr != m_requests.end(); ++itr)
+    {
+        MapChunkRequest &request = itr->second;
+
+        // the response got lost somewhere (i.e. failed chunk retrieval does not tell us which chunk it was), try again
+        if (request.inFlight && getMSTimeDiff(request.sentTime, now) >= MAP_CHUNK_REQUEST_TIMEOUT)
+        {
+            request.inFlight = false;
+            m_inFlightCount--;
+        }
+
+        if (!request.inFlight)
+        {
+            // squared distance of chunk center from position
+            dx = (float)request.startX + MAP_CHUNK_SIZE_X / 2.0f - posX;
+            dy = (float)request.startY + MAP_CHUNK_SIZE_Y / 2.0f - posY;
+            waiting.push_back(std::make_pair(dx * dx + dy * dy, &request));
+        }
+    }
+
+    if (waiting.empty() || m_inFlightCount >= MAP_CHUNK_MAX_IN_FLIGHT)
+        return;
+
+    // nearest first; the chunk under the player is always the nearest one
+    uint32_t count = num_min((uint32_t)waiting.size(), MAP_CHUNK_MAX_IN_FLIGHT - m_inFlightCount);
+    std::partial_sort(waiting.begin(), waiting.begin() + count, waiting.end(),
+        [](const std::pair<float, MapChunkRequest*> &a, const std::pair<float, MapChunkRequest*> &b) { return a.first < b.first; });
+
+    for (uint32_t i = 0; i < count; i++)
+        SendRequest(*waiting[i].second);
+}
+
+void MapChunkScheduler::SendRequest(MapChunkRequest &request)
+{
+    // verify checksum of the cached chunk, or retrieve the whole chunk, if we don't have it
+    if (MapChunkDatabaseRecord* mrec = sMapStorage->GetMapChunkRecord(m_mapId, request.startX, request.startY))
+        sGameplay->SendRequestMapChunkChecksumVerify(m_mapId, request.startX, request.startY, mrec->checksum.c_str());
+    else
+        sGameplay->SendRequestMapChunk(m_mapId, request.startX, request.startY);
+
+    request.inFlight = true;
+    request.sentTime = getMSTime();
+    m_inFlightCount++;
+}
+
+void MapChunkScheduler::RetryInFlight()
+{
+    for (std::unordered_map<uint64_t, MapChunkRequest>::iterator itr = m_requests.begin(); itr != m_requests.end(); ++itr)
+        itr->second.inFlight = false;
+
+    m_inFlightCount = 0;
+}
+
+bool MapChunkScheduler::SignalLoaded(uint32_t startX, uint32_t startY)
+{
+    uint64_t key = MakeChunkKey(startX, startY);
+
+    m_loadedChunks.insert(key);
+
+    std::unordered_map<uint64_t, MapChunkRequest>::iterator itr = m_requests.find(key);
+    if (itr == m_requests.end())
+        return false;
+
+    if (itr->second.inFlight)
+        m_inFlightCount--;
+
+    m_requests.erase(itr);
+
+    return true;
+}
+
+bool MapChunkScheduler::IsIdle()
+{
+    return m_requests.empty();
+}
@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_MAPCHUNKSCHEDULER_H
+#define BW_MAPCHUNKSCHEDULER_H
+
+// maximum count of chunk requests waiting for server response at once
+#define MAP_CHUNK_MAX_IN_FLIGHT 4
+// time after which unanswered chunk request is sent again (ms)
+#define MAP_CHUNK_REQUEST_TIMEOUT 15000
+
+/*
+ * Structure of scheduled map chunk request
+ */
+struct MapChunkRequest
+{
+    // startX coordinate of chunk
+    uint32_t startX;
+    // startY coordinate of chunk
+    uint32_t startY;
+    // is the request sent and waiting for response?
+    bool inFlight;
+    // time of sending the request (mstime)
+    uint32_t sentTime;
+};
+
+/*
+ * Class scheduling map chunk requests - nearest chunks go first, just few of them at once
+ */
+class MapChunkScheduler
+{
+    public:
+        MapChunkScheduler();
+        ~MapChunkScheduler();
+
+        // forgets all requests and loaded chunks, and starts scheduling for specified map
+        void Reset(uint32_t mapId);
+        // schedules chunk request; requests for already requested or loaded chunks are merged
+        void Enqueue(uint32_t startX, uint32_t startY);
+        // cancels waiting requests for chunks outside of specified chunk index range
+        void CancelOutside(uint32_t beginX, uint32_t beginY, uint32_t endX, uint32_t endY);
+        // sends waiting requests nearest to specified position, while there's free space in window
+        void Update(float posX, float posY);
+        // marks requests sent over lost connection as waiting, so they are sent again
+        void RetryInFlight();
+        // signals loaded chunk; returns true, if it was scheduled
+        bool SignalLoaded(uint32_t startX, uint32_t startY);
+        // is there any request waiting or in flight?
+        bool IsIdle();
+
+    protected:
+        // creates key for chunk maps
+        static uint64_t MakeChunkKey(uint32_t startX, uint32_t startY);
+        // sends request for chunk contents or its checksum verification
+        void SendRequest(MapChunkRequest &request);
+
+    private:
+        // ID of map the chunks belong to
+        uint32_t m_mapId;
+        // scheduled requests
+        std::unordered_map<uint64_t, MapChunkRequest> m_requests;
+        // count of requests waiting for response
+        uint32_t m_inFlightCount;
+        // chunks loaded and verified during this session
+        std::set<uint64_t> m_loadedChunks;
+};
+
+#endif
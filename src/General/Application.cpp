@@ -26,6 +26,8 @@
 #include "Gameplay.h"
 #include "FramerateLimiter.h"
 #include "Config.h"
+#include "UpdateFieldRegistry.h"
+#include "LocalServer.h"
 
 #include "CRC32.h"
 
@@ -37,6 +39,9 @@ Application::Application()
     m_stage = nullptr;
     m_stageType = STAGE_NONE;
     m_pendingStageType = STAGE_NONE;
+    m_headless = false;
+    m_quit = false;
+    m_exitCode = 0;
 
     memset(&m_keyMod, 0, sizeof(m_keyMod));
 }
@@ -46,16 +51,33 @@ Application::~Application()
     //
 }
 
-bool Application::Init()
+bool Application::Init(int argc, char** argv)
 {
     sConfig->InitDefaults();
 
-    if (!sConfig->LoadConfig())
+    // the first argument not being config override is path to config file
+    const char* configPath = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--", 2) != 0)
+        {
+            configPath = argv[i];
+            break;
+        }
+    }
+
+    if (!sConfig->LoadConfig(configPath))
         return false;
 
+    // command line overrides have precedence over config file
+    for (int i = 1; i < argc; i++)
+        sConfig->ProcessCommandLineArgument(argv[i]);
+
     if (!sConfig->ValidateConfig())
         return false;
 
+    m_headless = (sConfig->GetIntValue(CONFIG_INT_HEADLESS) != 0);
+
     // log some info
     sLog->Info("BubbleWorld " APP_VERSION_STR);
 
@@ -68,22 +90,27 @@ bool Application::Init()
     setlocale(LC_ALL, "cs_CZ");
 #endif
 
-    // init SDL library
-    if (SDL_Init(SDL_INIT_EVERYTHING) == -1)
+    // init SDL library; headless bot needs just timers
+    if (SDL_Init(m_headless ? SDL_INIT_TIMER : SDL_INIT_EVERYTHING) == -1)
     {
         sLog->Error("Could not initialize SDL subsystem");
         return false;
     }
 
-    // init SDL_image library
-    if (!IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG | IMG_INIT_TIF))
+    if (!m_headless)
     {
-        sLog->Error("Could not initialize SDL_image subsystem");
-        return false;
-    }
+        // init SDL_image library
+        if (!IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG | IMG_INIT_TIF))
+        {
+            sLog->Error("Could not initialize SDL_image subsystem");
+            return false;
+        }
 
-    // init drawing class
-    sDrawing->Init();
+        // init drawing class
+        sDrawing->Init();
+    }
+    else
+        sLog->Info("Running headless as bot %s", sConfig->GetStringValue(CONFIG_STRING_BOT_USERNAME));
 
     // init local file storages
     if (!sStorageManager->Init())
@@ -92,6 +119,9 @@ bool Application::Init()
         return false;
     }
 
+    // register updatefield change subscriptions
+    sUpdateFieldRegistry->Initialize();
+
     // init networking
     if (!sNetwork->Init())
     {
@@ -99,6 +129,13 @@ bool Application::Init()
         return false;
     }
 
+    // start stand-in server, so the client has something to connect to
+    if (sConfig->GetIntValue(CONFIG_INT_LOCAL_SERVER) != 0 && !sLocalServer->Init())
+    {
+        sLog->Error("Could not initialize local server");
+        return false;
+    }
+
     // move stage to menu
     SetStageType(STAGE_MENU);
 
@@ -110,77 +147,12 @@ bool Application::Init()
 
 int Application::Run()
 {
-    SDL_Event ev;
-
-    int quit = 0;
     // main application loop
-    while (!quit)
+    while (!m_quit)
     {
-        while (SDL_PollEvent(&ev))
-        {
-            switch (ev.type)
-            {
-                // quit signal (close window, alt+f4, ..)
-                case SDL_QUIT:
-                    quit = true;
-                    break;
-                // mouse move - store coordinates
-                case SDL_MOUSEMOTION:
-                    m_mouseX = ev.motion.x;
-                    m_mouseY = ev.motion.y;
-                    sDrawing->OnMouseMove(m_mouseX, m_mouseY);
-                    sGameplay->CheckHoverObject();
-                    break;
-                // mouse click - signal UI and stage
-                case SDL_MOUSEBUTTONDOWN:
-                    if (m_stage)
-                    {
-                        // left button
-                        if (ev.button.button == 1)
-                            m_stage->OnMouseClick(true, true);
-                        // right button
-                        else if (ev.button.button == 2)
-                            m_stage->OnMouseClick(false, true);
-                    }
-                    sDrawing->OnMouseClick(ev.button.button == 1, true, m_mouseX, m_mouseY);
-                    break;
-                // mouse button up - signal UI and stage
-                case SDL_MOUSEBUTTONUP:
-                    if (m_stage)
-                    {
-                        // left button
-                        if (ev.button.button == 1)
-                            m_stage->OnMouseClick(true, false);
-                        // right button
-                        else if (ev.button.button == 2)
-                            m_stage->OnMouseClick(false, false);
-                    }
-                    sDrawing->OnMouseClick(ev.button.button == 1, false, m_mouseX, m_mouseY);
-                    break;
-                // key pressed event - signal UI and stage
-                case SDL_KEYDOWN:
-                    StoreKeyMod(ev.key.keysym.mod);
-                    if (!sDrawing->OnKeyPress(ev.key.keysym.sym, true))
-                    {
-                        if (m_stage)
-                            m_stage->OnKeyPress(ev.key.keysym.sym, true);
-                    }
-                    break;
-                // key released event - signal UI and stage
-                case SDL_KEYUP:
-                    StoreKeyMod(ev.key.keysym.mod);
-                    if (!sDrawing->OnKeyPress(ev.key.keysym.sym, false))
-                    {
-                        if (m_stage)
-                            m_stage->OnKeyPress(ev.key.keysym.sym, false);
-                    }
-                    break;
-                // text input event - when focused to textfield widget
-                case SDL_TEXTINPUT:
-                    sDrawing->OnTextInput(ev.text.text);
-                    break;
-            }
-        }
+        // headless bot has no window to receive events from
+        if (!m_headless)
+            ProcessEvents();
 
         // process pending packets
         sNetwork->ProcessPending();
@@ -193,7 +165,8 @@ int Application::Run()
         sGameplay->Update();
 
         // update drawing class and draw if needed
-        sDrawing->Update();
+        if (!m_headless)
+            sDrawing->Update();
 
         // perform "after draw" method on stage
         if (m_stage)
@@ -202,13 +175,97 @@ int Application::Run()
         // if there is some stage change waiting to be done, switch stages
         SetStage_internal();
 
+        // send all packets produced during this frame at once
+        sNetwork->FlushSendBuffer();
+
         // invoke framerate limiter
         sFramerateLimiter->Limit();
     }
 
+    // stop network thread before tearing everything down
+    sNetwork->Shutdown();
+    sLocalServer->Shutdown();
+
     SDL_Quit();
 
-    return 0;
+    return m_exitCode;
+}
+
+void Application::Quit(int exitCode)
+{
+    m_quit = true;
+    m_exitCode = exitCode;
+}
+
+void Application::ProcessEvents()
+{
+    SDL_Event ev;
+
+    while (SDL_PollEvent(&ev))
+    {
+        switch (ev.type)
+        {
+            // quit signal (close window, alt+f4, ..)
+            case SDL_QUIT:
+                m_quit = true;
+                break;
+            // mouse move - store coordinates
+            case SDL_MOUSEMOTION:
+                m_mouseX = ev.motion.x;
+                m_mouseY = ev.motion.y;
+                sDrawing->OnMouseMove(m_mouseX, m_mouseY);
+                sGameplay->CheckHoverObject();
+                break;
+            // mouse click - signal UI and stage
+            case SDL_MOUSEBUTTONDOWN:
+                if (m_stage)
+                {
+                    // left button
+                    if (ev.button.button == 1)
+                        m_stage->OnMouseClick(true, true);
+                    // right button
+                    else if (ev.button.button == 2)
+                        m_stage->OnMouseClick(false, true);
+                }
+                sDrawing->OnMouseClick(ev.button.button == 1, true, m_mouseX, m_mouseY);
+                break;
+            // mouse button up - signal UI and stage
+            case SDL_MOUSEBUTTONUP:
+                if (m_stage)
+                {
+                    // left button
+                    if (ev.button.button == 1)
+                        m_stage->OnMouseClick(true, false);
+                    // right button
+                    else if (ev.button.button == 2)
+                        m_stage->OnMouseClick(false, false);
+                }
+                sDrawing->OnMouseClick(ev.button.button == 1, false, m_mouseX, m_mouseY);
+                break;
+            // key pressed event - signal UI and stage
+            case SDL_KEYDOWN:
+                StoreKeyMod(ev.key.keysym.mod);
+                if (!sDrawing->OnKeyPress(ev.key.keysym.sym, true))
+                {
+                    if (m_stage)
+                        m_stage->OnKeyPress(ev.key.keysym.sym, true);
+                }
+                break;
+            // key released event - signal UI and stage
+            case SDL_KEYUP:
+                StoreKeyMod(ev.key.keysym.mod);
+                if (!sDrawing->OnKeyPress(ev.key.keysym.sym, false))
+                {
+                    if (m_stage)
+                        m_stage->OnKeyPress(ev.key.keysym.sym, false);
+                }
+                break;
+            // text input event - when focused to textfield widget
+            case SDL_TEXTINPUT:
+                sDrawing->OnTextInput(ev.text.text);
+                break;
+        }
+    }
 }
 
 void Application::StoreKeyMod(uint16_t mod)
@@ -240,23 +297,29 @@ void Application::SetStage_internal()
 
     StageTemplate* st = nullptr;
 
-    // create new state from pending type
-    switch (m_pendingStageType)
+    // headless bot handles all stages by its script
+    if (m_headless)
+        st = new BotStage(m_pendingStageType);
+    else
     {
-        case STAGE_MENU:
-            st = new MenuStage();
-            break;
-        case STAGE_LOBBY:
-            st = new LobbyStage();
-            break;
-        case STAGE_CONNECTING:
-            st = new ConnectingStage();
-            break;
-        case STAGE_GAME:
-            st = new GameStage();
-            break;
-        default:
-            break;
+        // create new state from pending type
+        switch (m_pendingStageType)
+        {
+            case STAGE_MENU:
+                st = new MenuStage();
+                break;
+            case STAGE_LOBBY:
+                st = new LobbyStage();
+                break;
+            case STAGE_CONNECTING:
+                st = new ConnectingStage();
+                break;
+            case STAGE_GAME:
+                st = new GameStage();
+                break;
+            default:
+                break;
+        }
     }
 
     // stage has to be created at this point
@@ -271,7 +334,8 @@ void Application::SetStage_internal()
     if (m_stage)
     {
         m_stage->OnLeave();
-        sDrawing->DestroyUI();
+        if (!m_headless)
+            sDrawing->DestroyUI();
         delete m_stage;
     }
 
@@ -44,10 +44,14 @@ class Application
     public:
         ~Application();
 
-        // initializes application, parses configs, ..
-        bool Init();
+        // initializes application, parses configs and command line arguments, ..
+        bool Init(int argc = 0, char** argv = nullptr);
         // main run method
         int Run();
+        // requests main loop to end with supplied exit code
+        void Quit(int exitCode = 0);
+        // is the application running without window, as bot?
+        bool IsHeadless() { return m_headless; };
 
         // retrieves mouse X coordinate within window
         int32_t GetMouseX() { return m_mouseX; };
@@ -82,6 +86,8 @@ class Application
         // protected singleton constructor
         Application();
 
+        // processes pending SDL events (input, window)
+        void ProcessEvents();
         // internal method for switching stages
         void SetStage_internal();
         // stores keymod from key press event
@@ -101,6 +107,13 @@ class Application
 
         // stored keymod
         bool m_keyMod[MAX_KEYMOD];
+
+        // running without window?
+        bool m_headless;
+        // was the quit requested?
+        bool m_quit;
+        // exit code returned from main loop
+        int m_exitCode;
 };
 
 #define sApplication Singleton<Application>::getInstance()
@@ -98,7 +98,7 @@ uint32_t CRC32_Bytes_ContinuousFinalize(uint32_t crc)
 
 uint32_t CRC32_Bytes(uint8_t* data, uint32_t count)
 {
-    uint32_t crc;
+    uint32_t crc = 0;
 
     for (uint32_t i = 0; i < count; i++)
         crc = crc32_tab[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
@@ -108,7 +108,7 @@ uint32_t CRC32_Bytes(uint8_t* data, uint32_t count)
 
 uint32_t CRC32_File(FILE* f)
 {
-    uint32_t crc;
+    uint32_t crc = 0;
     uint8_t rbyte;
 
     while (fread(&rbyte, 1, 1, f) == 1)
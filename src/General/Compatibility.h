@@ -28,7 +28,7 @@
 #ifdef _WIN32
 inline unsigned int getMSTime() { return GetTickCount(); }
 #else
-inline uint32 getMSTime()
+inline uint32_t getMSTime()
 {
     struct timeval tv;
     struct timezone tz;
@@ -37,6 +37,28 @@ inline uint32 getMSTime()
 }
 #endif
 
+// retrieves monotonic time in microseconds; used for measuring short durations
+#ifdef _WIN32
+inline uint64_t getUSTime()
+{
+    static LARGE_INTEGER frequency = { 0 };
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 + (uint64_t)((counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+}
+#else
+inline uint64_t getUSTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+#endif
+
 // retrieves time difference in milliseconds
 inline unsigned int getMSTimeDiff(unsigned int oldMSTime, unsigned int newMSTime)
 {
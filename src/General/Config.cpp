@@ -46,6 +46,41 @@ void ConfigMgr::InitDefaults()
     // connect settings
     SetConfigStringField(CONFIG_STRING_CONNECT_HOST, "connect_ip", "127.0.0.1");
     SetConfigIntField(CONFIG_INT_CONNECT_PORT, "connect_port", 7874);
+    SetConfigIntField(CONFIG_INT_CONNECT_TIMEOUT, "connect_timeout", 5000);
+
+    // network settings
+    SetConfigIntField(CONFIG_INT_NETWORK_DISPATCH_BUDGET, "network_dispatch_budget", 8);
+    SetConfigStringField(CONFIG_STRING_NETWORK_CAPTURE_FILE, "network_capture_file", "");
+    SetConfigStringField(CONFIG_STRING_NETWORK_REPLAY_FILE, "network_replay_file", "");
+    SetConfigIntField(CONFIG_INT_NETWORK_REPLAY_REALTIME, "network_replay_realtime", 1);
+    SetConfigIntField(CONFIG_INT_NETWORK_COMPACT_UPDATES, "network_compact_updates", 1);
+    SetConfigIntField(CONFIG_INT_NETWORK_PING_INTERVAL, "network_ping_interval", 5000);
+    SetConfigStringField(CONFIG_STRING_NETWORK_TELEMETRY_FILE, "network_telemetry_file", "");
+
+    // headless bot settings
+    SetConfigIntField(CONFIG_INT_HEADLESS, "headless", 0);
+    SetConfigStringField(CONFIG_STRING_BOT_USERNAME, "bot_username", "");
+    SetConfigStringField(CONFIG_STRING_BOT_PASSWORD, "bot_password", "");
+    SetConfigIntField(CONFIG_INT_BOT_CHARACTER, "bot_character", 0);
+    SetConfigStringField(CONFIG_STRING_BOT_PATH, "bot_path", "");
+    SetConfigStringField(CONFIG_STRING_BOT_CHAT, "bot_chat", "");
+    SetConfigIntField(CONFIG_INT_BOT_CHAT_INTERVAL, "bot_chat_interval", 10000);
+
+    // local stand-in server settings
+    SetConfigIntField(CONFIG_INT_LOCAL_SERVER, "local_server", 0);
+    SetConfigStringField(CONFIG_STRING_LOCAL_SERVER_DIR, "local_server_dir", "localserver/");
+    SetConfigIntField(CONFIG_INT_LOCAL_SERVER_MAP, "local_server_map", 0);
+    SetConfigIntField(CONFIG_INT_LOCAL_SERVER_OBJECT_DENSITY, "local_server_object_density", 4);
+    SetConfigIntField(CONFIG_INT_LOCAL_SERVER_MOVING_OBJECTS, "local_server_moving_objects", 50);
+    SetConfigIntField(CONFIG_INT_LOCAL_SERVER_OBJECT_IMAGE, "local_server_object_image", 1);
+    SetConfigIntField(CONFIG_INT_LOCAL_SERVER_CHECKSUM_FAILURES, "local_server_checksum_failures", 0);
+
+    // synthetic load generator settings
+    SetConfigIntField(CONFIG_INT_LOADGEN_OBJECTS, "loadgen_objects", 0);
+    SetConfigIntField(CONFIG_INT_LOADGEN_HEARTBEAT_RATE, "loadgen_heartbeat_rate", 0);
+    SetConfigIntField(CONFIG_INT_LOADGEN_CHAT_RATE, "loadgen_chat_rate", 0);
+    SetConfigIntField(CONFIG_INT_LOADGEN_DURATION, "loadgen_duration", 30000);
+    SetConfigIntField(CONFIG_INT_LOADGEN_OBJECT_IMAGE, "loadgen_object_image", 1);
 
     // misc
     SetConfigIntField(CONFIG_INT_FPS_LIMIT, "fps_limit", 200);
@@ -63,6 +98,13 @@ bool ConfigMgr::ValidateConfig()
         errorCount++;
     }
 
+    // validate connection timeout
+    if (GetIntValue(CONFIG_INT_CONNECT_TIMEOUT) <= 0)
+    {
+        std::cerr << "Config error: connect timeout has to be greater than 0" << std::endl;
+        errorCount++;
+    }
+
     // validate FPS limiter value
     if (GetIntValue(CONFIG_INT_FPS_LIMIT) <= 10)
     {
@@ -70,6 +112,46 @@ bool ConfigMgr::ValidateConfig()
         errorCount++;
     }
 
+    // validate packet dispatch budget
+    if (GetIntValue(CONFIG_INT_NETWORK_DISPATCH_BUDGET) < 0)
+    {
+        std::cerr << "Config error: network dispatch budget cannot be negative" << std::endl;
+        errorCount++;
+    }
+
+    // headless bot has to know, who to log in as
+    if (GetIntValue(CONFIG_INT_HEADLESS) != 0 && (strlen(GetStringValue(CONFIG_STRING_BOT_USERNAME)) == 0 || strlen(GetStringValue(CONFIG_STRING_BOT_PASSWORD)) == 0))
+    {
+        std::cerr << "Config error: headless mode requires bot username and password" << std::endl;
+        errorCount++;
+    }
+
+    // validate bot settings
+    if (GetIntValue(CONFIG_INT_BOT_CHARACTER) < 0 || GetIntValue(CONFIG_INT_BOT_CHAT_INTERVAL) < 0)
+    {
+        std::cerr << "Config error: bot character index and chat interval cannot be negative" << std::endl;
+        errorCount++;
+    }
+
+    // validate local server settings
+    if (GetIntValue(CONFIG_INT_LOCAL_SERVER_MAP) < 0 || GetIntValue(CONFIG_INT_LOCAL_SERVER_OBJECT_DENSITY) < 0 || GetIntValue(CONFIG_INT_LOCAL_SERVER_OBJECT_IMAGE) < 0)
+    {
+        std::cerr << "Config error: local server map, object density and object image cannot be negative" << std::endl;
+        errorCount++;
+    }
+
+    if (GetIntValue(CONFIG_INT_LOCAL_SERVER_MOVING_OBJECTS) < 0 || GetIntValue(CONFIG_INT_LOCAL_SERVER_MOVING_OBJECTS) > 100)
+    {
+        std::cerr << "Config error: local server moving objects percentage out of range (0 - 100)" << std::endl;
+        errorCount++;
+    }
+
+    if (GetIntValue(CONFIG_INT_LOCAL_SERVER_CHECKSUM_FAILURES) < 0 || GetIntValue(CONFIG_INT_LOCAL_SERVER_CHECKSUM_FAILURES) > 100)
+    {
+        std::cerr << "Config error: local server checksum failures percentage out of range (0 - 100)" << std::endl;
+        errorCount++;
+    }
+
     // look for uninitialized config values and report them
     for (i = 0; i < CONFIG_MAX_INT_VAL; i++)
     {
@@ -124,6 +206,21 @@ bool ConfigMgr::LoadConfig(const char* path)
     return true;
 }
 
+bool ConfigMgr::ProcessCommandLineArgument(const char* arg)
+{
+    // only "--identifier=value" arguments are config overrides
+    if (strncmp(arg, "--", 2) != 0)
+        return false;
+
+    // the rest is the same as config file line
+    std::string line = arg + 2;
+    line = str_trim(line);
+    if (line.length() > 0)
+        ProcessConfigLine(line);
+
+    return true;
+}
+
 void ConfigMgr::ProcessConfigLine(std::string &line)
 {
     int64_t res;
@@ -30,6 +30,25 @@ enum ConfigIntValues
 {
     CONFIG_INT_CONNECT_PORT = 0,
     CONFIG_INT_FPS_LIMIT = 1,
+    CONFIG_INT_NETWORK_DISPATCH_BUDGET = 2,
+    CONFIG_INT_NETWORK_REPLAY_REALTIME = 3,
+    CONFIG_INT_CONNECT_TIMEOUT = 4,
+    CONFIG_INT_HEADLESS = 5,
+    CONFIG_INT_BOT_CHARACTER = 6,
+    CONFIG_INT_BOT_CHAT_INTERVAL = 7,
+    CONFIG_INT_LOCAL_SERVER = 8,
+    CONFIG_INT_LOCAL_SERVER_MAP = 9,
+    CONFIG_INT_LOCAL_SERVER_OBJECT_DENSITY = 10,
+    CONFIG_INT_LOCAL_SERVER_MOVING_OBJECTS = 11,
+    CONFIG_INT_LOCAL_SERVER_OBJECT_IMAGE = 12,
+    CONFIG_INT_NETWORK_COMPACT_UPDATES = 13,
+    CONFIG_INT_NETWORK_PING_INTERVAL = 14,
+    CONFIG_INT_LOADGEN_OBJECTS = 15,
+    CONFIG_INT_LOADGEN_HEARTBEAT_RATE = 16,
+    CONFIG_INT_LOADGEN_CHAT_RATE = 17,
+    CONFIG_INT_LOADGEN_DURATION = 18,
+    CONFIG_INT_LOADGEN_OBJECT_IMAGE = 19,
+    CONFIG_INT_LOCAL_SERVER_CHECKSUM_FAILURES = 20,
     CONFIG_MAX_INT_VAL
 };
 
@@ -37,6 +56,14 @@ enum ConfigIntValues
 enum ConfigStringValues
 {
     CONFIG_STRING_CONNECT_HOST = 0,
+    CONFIG_STRING_NETWORK_CAPTURE_FILE = 1,
+    CONFIG_STRING_NETWORK_REPLAY_FILE = 2,
+    CONFIG_STRING_NETWORK_TELEMETRY_FILE = 3,
+    CONFIG_STRING_BOT_USERNAME = 4,
+    CONFIG_STRING_BOT_PASSWORD = 5,
+    CONFIG_STRING_BOT_PATH = 6,
+    CONFIG_STRING_BOT_CHAT = 7,
+    CONFIG_STRING_LOCAL_SERVER_DIR = 8,
     CONFIG_MAX_STRING_VAL
 };
 
@@ -71,6 +98,8 @@ class ConfigMgr
         bool LoadConfig(const char* path = nullptr);
         // validates config values (i.e. port range, ..)
         bool ValidateConfig();
+        // processes command line argument in "--identifier=value" format, overriding loaded value
+        bool ProcessCommandLineArgument(const char* arg);
 
         // sets integer value at index
         void SetIntValue(ConfigIntValues index, int64_t value);
@@ -29,7 +29,10 @@
 #include <string>
 #include <set>
 #include <queue>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <tuple>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -39,6 +42,8 @@
 
 // platform-specific headers
 #ifdef _WIN32
+// network event loop uses select(), let it serve more sockets than default 64
+#define FD_SETSIZE 1024
 #include <WS2tcpip.h>
 #include <Windows.h>
 #else
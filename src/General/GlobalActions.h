@@ -35,6 +35,11 @@ enum GlobalActionIDs
     GA_CONNECTION_INCOMPATIBLE_VERSION,
     GA_CONNECTION_BANNED,
 
+    // GameStage
+    GA_CONNECTION_RESUMING,
+    GA_CONNECTION_RESUMED,
+    GA_CONNECTION_RESUME_FAILED,
+
     // LobbyStage
     GA_CHARACTER_LIST_ACQUIRED,
 };
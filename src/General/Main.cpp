@@ -23,7 +23,7 @@
 int SDL_main(int argc, char *argv[])
 {
     // init application
-    if (!sApplication->Init())
+    if (!sApplication->Init(argc, argv))
         return 1;
 
     // start main loop
@@ -38,6 +38,25 @@ enum AuthStatus
     AUTH_STATUS_INCOMPATIBLE_VERSION = 4,
 };
 
+// optional protocol features; client offers them in login request, server confirms those it will use
+enum ProtocolCapability
+{
+    PROTOCOL_CAP_NONE = 0,
+    PROTOCOL_CAP_COMPACT_OBJECT_UPDATES = 1,    // SP_CREATE_OBJECT_COMPACT and SP_UPDATE_OBJECT_COMPACT instead of full ones
+    PROTOCOL_CAP_LARGE_FRAMES = 2,              // extended frames with 32bit contents size; whole resources in one SP_RESOURCE_DATA
+    PROTOCOL_CAP_SESSION_RESUME = 4,            // resume token in SP_ENTER_WORLD_RESULT; CP_RESUME_SESSION after reconnecting
+    PROTOCOL_CAP_CHECKSUM_BATCH_ID = 8,         // CP_RESOURCE_VERIFY_CHECKSUM carries batch ID echoed in SP_RESOURCE_VERIFY_CHECKSUM
+    PROTOCOL_CAP_PING = 16,                     // CP_PING answered by SP_PONG with server time, used for clock synchronization
+};
+
+// status of session resume
+enum ResumeSessionStatus
+{
+    RESUME_SESSION_OK = 0,
+    RESUME_SESSION_UNKNOWN_TOKEN = 1,           // the token is invalid or expired; full login is needed
+    RESUME_SESSION_INCOMPATIBLE_VERSION = 2,
+};
+
 // status of world entering
 enum EnterWorldStatus
 {
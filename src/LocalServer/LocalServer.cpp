@@ -0,0 +1,1116 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "LocalServer.h"
+#include "Log.h"
+#include "Config.h"
+#include "Gameplay.h"
+#include "ObjectEnums.h"
+#include "CompactObjectUpdate.h"
+#include "PacketStructures.h"
+
+#include <sstream>
+
+// table of local server packet handlers; the opcode is also an index here
+static LocalServerHandlerStructure LocalServerHandlerTable[] = {
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // MSG_NONE
+    { &LocalServer::HandleLoginRequest,                 STATE_RESTRICTION_AUTH     },   // CP_LOGIN_REQUEST
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_LOGIN_RESPONSE
+    { &LocalServer::HandleCharacterListRequest,         STATE_RESTRICTION_LOBBY    },   // CP_CHARACTER_LIST_REQUEST
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_CHARACTER_LIST
+    { &LocalServer::HandleRequestResource,              STATE_RESTRICTION_VERIFIED },   // CP_REQUEST_RESOURCE
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_RESOURCE_SEND_START
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_RESOURCE_SEND_FINISHED
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_RESOURCE_DATA
+    { &LocalServer::HandleResourceVerifyChecksum,       STATE_RESTRICTION_VERIFIED },   // CP_RESOURCE_VERIFY_CHECKSUM
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_RESOURCE_VERIFY_CHECKSUM
+    { &LocalServer::HandleEnterWorld,                   STATE_RESTRICTION_LOBBY    },   // CP_ENTER_WORLD
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_ENTER_WORLD_RESULT
+    { &LocalServer::HandleWorldEnterComplete,           STATE_RESTRICTION_GAME     },   // CP_WORLD_ENTER_COMPLETE
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_CREATE_OBJECT
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_UPDATE_OBJECT
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_DESTROY_OBJECT
+    { &LocalServer::HandleGetMapMetadata,               STATE_RESTRICTION_VERIFIED },   // CP_GET_MAP_METADATA
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_MAP_METADATA
+    { &LocalServer::HandleGetMapChunk,                  STATE_RESTRICTION_VERIFIED },   // CP_GET_MAP_CHUNK
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_MAP_CHUNK
+    { &LocalServer::HandleMapMetadataVerifyChecksum,    STATE_RESTRICTION_VERIFIED },   // CP_MAP_METADATA_VERIFY_CHECKSUM
+    { &LocalServer::HandleMapChunkVerifyChecksum,       STATE_RESTRICTION_VERIFIED },   // CP_MAP_CHUNK_VERIFY_CHECKSUM
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_MAP_METADATA_VERIFY_CHECKSUM
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_MAP_CHUNK_VERIFY_CHECKSUM
+    { &LocalServer::HandleGetImageMetadata,             STATE_RESTRICTION_VERIFIED },   // CP_GET_IMAGE_METADATA
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_IMAGE_METADATA
+    { &LocalServer::HandleVerifyImageMetadataChecksum,  STATE_RESTRICTION_VERIFIED },   // CP_VERIFY_IMAGE_METADATA_CHECKSUM
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_VERIFY_IMAGE_METADATA_CHECKSUM
+    { &LocalServer::HandleNameQuery,                    STATE_RESTRICTION_VERIFIED },   // CP_NAME_QUERY
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_NAME_QUERY_RESPONSE
+    { &LocalServer::HandleMoveStartDirection,           STATE_RESTRICTION_GAME     },   // CP_MOVE_START_DIRECTION
+    { &LocalServer::HandleMoveStopDirection,            STATE_RESTRICTION_GAME     },   // CP_MOVE_STOP_DIRECTION
+    { &LocalServer::HandleMoveHeartbeat,                STATE_RESTRICTION_GAME     },   // CP_MOVE_HEARTBEAT
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_MOVE_START_DIRECTION
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_MOVE_STOP_DIRECTION
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_MOVE_HEARTBEAT
+    { &LocalServer::HandleChatMessage,                  STATE_RESTRICTION_GAME     },   // CP_CHAT_MESSAGE
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_CHAT_MESSAGE
+    { nullptr,                                          STATE_RESTRICTION_GAME     },   // CP_INTERACTION_REQUEST
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_DIALOGUE_DATA
+    { nullptr,                                          STATE_RESTRICTION_GAME     },   // CP_DIALOGUE_DECISION
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_DIALOGUE_CLOSE
+    { &LocalServer::HandleInventoryQuery,               STATE_RESTRICTION_GAME     },   // CP_INVENTORY_QUERY
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_INVENTORY
+    { &LocalServer::HandleItemQuery,                    STATE_RESTRICTION_VERIFIED },   // CP_ITEM_QUERY
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_ITEM_QUERY_RESPONSE
+    { nullptr,                                          STATE_RESTRICTION_GAME     },   // CP_INVENTORY_MOVE_ITEM
+    { nullptr,                                          STATE_RESTRICTION_GAME     },   // CP_INVENTORY_REMOVE_ITEM
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_ITEM_OPERATION_INFO
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_UPDATE_INVENTORY_SLOT
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_CREATE_OBJECT_COMPACT
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_UPDATE_OBJECT_COMPACT
+    { &LocalServer::HandlePing,                         STATE_RESTRICTION_VERIFIED },   // CP_PING
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_PONG
+    { &LocalServer::HandleResumeSession,                STATE_RESTRICTION_AUTH     },   // CP_RESUME_SESSION
+    { nullptr,                                          STATE_RESTRICTION_NEVER    },   // SP_RESUME_SESSION_RESULT
+};
+
+static_assert(sizeof(LocalServerHandlerTable) / sizeof(LocalServerHandlerStructure) == MAX_OPCODES, "Local server handler table does not cover all opcodes");
+
+LocalServer::LocalServer()
+{
+    m_thread = nullptr;
+    m_running = false;
+    m_listenSocket = INVALID_SOCKET;
+    m_nextCharacterGuid = LOCAL_SERVER_FIRST_CHARACTER;
+    m_entryMapId = 0;
+    m_playerImageId = 0;
+    m_checksumFailureRate = 0;
+
+    // tokens have to be hard to guess, unlike the synthetic world
+    m_tokenRandom.seed(std::random_device()());
+    m_checksumFailureRandom.seed(0);
+}
+
+LocalServer::~LocalServer()
+{
+    //
+}
+
+bool LocalServer::Init()
+{
+    if (!m_content.Load(sConfig->GetStringValue(CONFIG_STRING_LOCAL_SERVER_DIR)))
+    {
+        sLog->Error("Local server: could not load content");
+        return false;
+    }
+
+    // enter the configured map, or the first one listed
+    m_entryMapId = (uint32_t)sConfig->GetIntValue(CONFIG_INT_LOCAL_SERVER_MAP);
+    if (m_entryMapId == 0)
+        m_entryMapId = m_content.GetDefaultMapId();
+
+    if (!m_content.GetMap(m_entryMapId))
+    {
+        sLog->Error("Local server: entry map %u not found", m_entryMapId);
+        return false;
+    }
+
+    m_playerImageId = (uint32_t)sConfig->GetIntValue(CONFIG_INT_LOCAL_SERVER_OBJECT_IMAGE);
+    m_checksumFailureRate = (uint32_t)sConfig->GetIntValue(CONFIG_INT_LOCAL_SERVER_CHECKSUM_FAILURES);
+
+    m_world.Generate(&m_content, (uint32_t)sConfig->GetIntValue(CONFIG_INT_LOCAL_SERVER_OBJECT_DENSITY),
+        (uint32_t)sConfig->GetIntValue(CONFIG_INT_LOCAL_SERVER_MOVING_OBJECTS), m_playerImageId);
+
+    uint16_t port = (uint16_t)sConfig->GetIntValue(CONFIG_INT_CONNECT_PORT);
+
+    // listen just on loopback, nobody else should connect to stand-in server
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(sockaddr_in));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    m_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (m_listenSocket == INVALID_SOCKET)
+    {
+        sLog->Error("Local server: unable to create socket");
+        return false;
+    }
+
+    // allow restarting right after previous run
+    int reuse = 1;
+    setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(int));
+
+    if (bind(m_listenSocket, (sockaddr*)&addr, sizeof(sockaddr_in)) != 0 || listen(m_listenSocket, SOMAXCONN) != 0)
+    {
+        sLog->Error("Local server: unable to listen on port %u, error %u", port, LASTERROR());
+        CLOSESOCKET(m_listenSocket);
+        m_listenSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    // clients are served by the same event loop as the client side sessions
+    if (!m_eventLoop.Init() || !m_eventLoop.SetListenSocket(m_listenSocket, [this](SOCK sock) { AcceptConnection(sock); }))
+    {
+        sLog->Error("Local server: unable to initialize network event loop");
+        m_eventLoop.Close();
+        CLOSESOCKET(m_listenSocket);
+        m_listenSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    m_running = true;
+    m_thread = new std::thread(&LocalServer::Run, this);
+
+    sLog->Info("Local server: listening on 127.0.0.1:%u", port);
+
+    return true;
+}
+
+void LocalServer::Shutdown()
+{
+    if (!m_thread)
+        return;
+
+    m_running = false;
+    m_eventLoop.Wakeup();
+    m_thread->join();
+    delete m_thread;
+    m_thread = nullptr;
+
+    // closes sessions of connections closed by the thread
+    m_eventLoop.Close();
+    for (NetworkSession* session : m_closedSessions)
+        delete session;
+    m_closedSessions.clear();
+
+    CLOSESOCKET(m_listenSocket);
+    m_listenSocket = INVALID_SOCKET;
+}
+
+bool LocalServer::IsRunning()
+{
+    return m_running;
+}
+
+void LocalServer::Run()
+{
+    uint32_t now, nextTick = getMSTime();
+    std::list<LocalServerConnection*>::iterator itr;
+
+    while (m_running)
+    {
+        // accept connections and receive packets until next world update at most
+        now = getMSTime();
+        m_eventLoop.RunOnce((now < nextTick) ? nextTick - now : 0);
+
+        // the loop has closed sessions removed in previous iteration
+        for (NetworkSession* session : m_closedSessions)
+            delete session;
+        m_closedSessions.clear();
+
+        for (itr = m_connections.begin(); itr != m_connections.end(); ++itr)
+            ProcessPackets(*itr);
+
+        // move the world and let the clients know
+        now = getMSTime();
+        if (now >= nextTick)
+        {
+            UpdateWorld(now);
+            nextTick = now + LOCAL_SERVER_TICK;
+        }
+
+        // send everything produced in this iteration, and get rid of closed connections
+        for (itr = m_connections.begin(); itr != m_connections.end(); )
+        {
+            if ((*itr)->closing)
+            {
+                CloseConnection(*itr);
+                itr = m_connections.erase(itr);
+                continue;
+            }
+
+            SendResourceTransfers(*itr);
+            (*itr)->session->Flush();
+            ++itr;
+        }
+    }
+
+    for (itr = m_connections.begin(); itr != m_connections.end(); ++itr)
+        CloseConnection(*itr);
+    m_connections.clear();
+}
+
+void LocalServer::AcceptConnection(SOCK sock)
+{
+    if (m_connections.size() >= LOCAL_SERVER_MAX_CONNECTIONS)
+    {
+        sLog->Error("Local server: too many connections, refusing another one");
+        CLOSESOCKET(sock);
+        return;
+    }
+
+    // the server handles every packet right away, so just a short queue is needed; the pool gets back
+    // the queued packets and the one being handled
+    NetworkSession* session = new NetworkSession(&m_eventLoop, LOCAL_SERVER_RECV_BUFFER_SIZE, LOCAL_SERVER_SEND_BUFFER_SIZE,
+        LOCAL_SERVER_PACKET_QUEUE_SIZE, LOCAL_SERVER_PACKET_POOL_SIZE, 2 * LOCAL_SERVER_PACKET_QUEUE_SIZE);
+
+    if (!m_eventLoop.AddSession(session))
+    {
+        CLOSESOCKET(sock);
+        delete session;
+        return;
+    }
+
+    LocalServerConnection* conn = new LocalServerConnection();
+    conn->session = session;
+    conn->closing = false;
+    conn->state = CONNECTION_STATE_AUTH;
+    conn->capabilities = PROTOCOL_CAP_NONE;
+    conn->resumeToken = 0;
+    conn->characterGuid = 0;
+    conn->inWorld = false;
+    conn->mapId = 0;
+    conn->x = 0.0f;
+    conn->y = 0.0f;
+    conn->moveMask = 0;
+    conn->positionTime = getMSTime();
+
+    // the callback is called by event loop, which is run by this thread
+    session->SetEventCallback([conn](NetworkSession*, SessionEvent ev) {
+        if (ev == SESSION_EVENT_DISCONNECTED || ev == SESSION_EVENT_CONNECT_FAILED)
+            conn->closing = true;
+    });
+    session->Attach(sock);
+
+    m_connections.push_back(conn);
+
+    sLog->Info("Local server: client connected");
+}
+
+void LocalServer::ProcessPackets(LocalServerConnection* conn)
+{
+    PendingPacket* pp;
+
+    // the rest waits in session until the client takes some of the responses; when the queue fills up,
+    // the session stops receiving and the client is slowed down by TCP flow control
+    while (!conn->closing && conn->session->GetSendBufferFreeSize() >= LOCAL_SERVER_SEND_HEADROOM && conn->session->PopPacket(pp))
+    {
+        HandlePacket(conn, *pp->pkt);
+        conn->session->ReleasePacket(pp);
+    }
+}
+
+void LocalServer::HandlePacket(LocalServerConnection* conn, SmartPacket &packet)
+{
+    if (packet.GetOpcode() >= MAX_OPCODES)
+    {
+        sLog->Error("Local server: client sent unknown opcode %u", packet.GetOpcode());
+        return;
+    }
+
+    LocalServerHandlerStructure &hs = LocalServerHandlerTable[packet.GetOpcode()];
+
+    // verify the state of client connection
+    if ((hs.stateRestriction & (1 << (int)conn->state)) == 0)
+    {
+        sLog->Error("Local server: client sent packet (opcode %u) for state %u, not handling", packet.GetOpcode(), conn->state);
+        return;
+    }
+
+    // the rest is not simulated by local server
+    if (!hs.handler)
+        return;
+
+    try
+    {
+        (this->*hs.handler)(conn, packet);
+    }
+    catch (PacketReadException &ex)
+    {
+        sLog->Error("Local server: read error during handling opcode %u - attempt to read %u bytes at offset %u (real size %u bytes)", packet.GetOpcode(), ex.GetAttemptSize(), ex.GetPosition(), packet.GetSize());
+    }
+}
+
+void LocalServer::SendPacket(LocalServerConnection* conn, SmartPacket &packet)
+{
+    // the session reports failures on its own, and the connection is closed on send error
+    conn->session->SendPacket(packet);
+}
+
+void LocalServer::SendResourceTransfers(LocalServerConnection* conn)
+{
+    bool largeFrames = (conn->capabilities & PROTOCOL_CAP_LARGE_FRAMES) != 0;
+    uint32_t portionSize = largeFrames ? LOCAL_SERVER_LARGE_RESOURCE_PORTION : LOCAL_SERVER_RESOURCE_PORTION;
+    size_t count;
+
+    m_resourcePortion.resize(num_max(m_resourcePortion.size(), (size_t)portionSize));
+
+    while (!conn->resourceTransfers.empty())
+    {
+        LocalResourceTransfer &transfer = conn->resourceTransfers.front();
+
+        // keep space for regular responses; the rest is sent after the client takes some data
+        if (conn->session->GetSendBufferFreeSize() < LOCAL_SERVER_SEND_HEADROOM + portionSize)
+            return;
+
+        if (!transfer.file)
+        {
+            LocalImageRecord* image = m_content.GetImage(transfer.id);
+
+            transfer.file = fopen(image->path.c_str(), "rb");
+            if (!transfer.file)
+            {
+                sLog->Error("Local server: could not open image file %s", image->path.c_str());
+                conn->resourceTransfers.pop_front();
+                continue;
+            }
+
+            SmartPacket start(SP_RESOURCE_SEND_START);
+            start.WriteString(image->filename.c_str());
+            start.WriteUInt8(transfer.type);
+            start.WriteUInt32(transfer.id);
+            SendPacket(conn, start);
+        }
+
+        // send file contents in portions; with extended frames, usually the whole file fits into one
+        count = fread(m_resourcePortion.data(), 1, portionSize, transfer.file);
+        if (count > 0)
+        {
+            SmartPacket data(SP_RESOURCE_DATA);
+            data.WriteUInt8(transfer.type);
+            data.WriteUInt32(transfer.id);
+            if (largeFrames)
+                data.WriteUInt32((uint32_t)count);
+            else
+                data.WriteUInt16((uint16_t)count);
+            data.WriteBytes(m_resourcePortion.data(), (uint32_t)count);
+            SendPacket(conn, data);
+        }
+
+        // the last portion
+        if (count < portionSize)
+        {
+            fclose(transfer.file);
+
+            SmartPacket finished(SP_RESOURCE_SEND_FINISHED);
+            finished.WriteUInt8(transfer.type);
+            finished.WriteUInt32(transfer.id);
+            SendPacket(conn, finished);
+
+            conn->resourceTransfers.pop_front();
+        }
+    }
+}
+
+void LocalServer::CloseConnection(LocalServerConnection* conn)
+{
+    PendingPacket* pp;
+
+    sLog->Info("Local server: client disconnected");
+
+    // keep the session for a while, the client may come back and resume it
+    if (conn->resumeToken != 0 && conn->state == CONNECTION_STATE_INGAME)
+    {
+        uint32_t now = getMSTime();
+        UpdatePlayerPosition(conn, now);
+
+        LocalResumeRecord &rec = m_resumeRecords[conn->resumeToken];
+        rec.username = conn->username;
+        rec.characterGuid = conn->characterGuid;
+        rec.mapId = conn->mapId;
+        rec.x = conn->x;
+        rec.y = conn->y;
+        rec.expireTime = now + LOCAL_SERVER_RESUME_TIMEOUT;
+    }
+
+    for (std::list<LocalResourceTransfer>::iterator itr = conn->resourceTransfers.begin(); itr != conn->resourceTransfers.end(); ++itr)
+    {
+        if (itr->file)
+            fclose(itr->file);
+    }
+
+    // nobody is going to handle the rest
+    while (conn->session->PopPacket(pp))
+        conn->session->ReleasePacket(pp);
+
+    // the loop closes the socket, and the session could be deleted after that
+    conn->session->SetEventCallback(nullptr);
+    m_eventLoop.RemoveSession(conn->session);
+    m_closedSessions.push_back(conn->session);
+
+    delete conn;
+}
+
+void LocalServer::HandleLoginRequest(LOCAL_SERVER_HANDLER_ARGS)
+{
+    std::string username = packet.ReadString();
+    std::string password = packet.ReadString();
+    uint32_t version = packet.ReadUInt32();
+    // older clients do not offer any capabilities
+    uint32_t capabilities = (packet.GetRemainingSize() >= sizeof(uint32_t)) ? packet.ReadUInt32() : (uint32_t)PROTOCOL_CAP_NONE;
+
+    SmartPacket response(SP_LOGIN_RESPONSE);
+
+    // every non-empty name is accepted with any password
+    if (version != APP_VERSION)
+        response.WriteUInt8(AUTH_STATUS_INCOMPATIBLE_VERSION);
+    else if (username.empty())
+        response.WriteUInt8(AUTH_STATUS_UNKNOWN_USER);
+    else
+    {
+        response.WriteUInt8(AUTH_STATUS_OK);
+        response.WriteUInt32(m_content.GetContentEpoch());
+
+        // confirm everything we support from the offer
+        conn->capabilities = capabilities & LOCAL_SERVER_CAPABILITIES;
+        conn->session->SetExtendedFramesEnabled((conn->capabilities & PROTOCOL_CAP_LARGE_FRAMES) != 0);
+        response.WriteUInt32(conn->capabilities);
+
+        conn->username = username;
+        conn->characterGuid = m_nextCharacterGuid++;
+        conn->state = CONNECTION_STATE_LOBBY;
+    }
+
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleCharacterListRequest(LocalServerConnection* conn, SmartPacket & /*packet*/)
+{
+    // every account owns just one character named after it
+    SmartPacket response(SP_CHARACTER_LIST);
+    response.WriteUInt8(1);
+    response.WriteUInt32(conn->characterGuid);
+    response.WriteString(conn->username.c_str());
+    response.WriteUInt16(LOCAL_WORLD_OBJECT_LEVEL);
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleRequestResource(LOCAL_SERVER_HANDLER_ARGS)
+{
+    ResourceType type = (ResourceType)packet.ReadUInt8();
+    uint32_t id = packet.ReadUInt32();
+
+    LocalImageRecord* image = (type == RSTYPE_IMAGE) ? m_content.GetImage(id) : nullptr;
+    if (!image)
+    {
+        sLog->Error("Local server: client requested unknown resource type %u, id %u", type, id);
+        return;
+    }
+
+    // the contents are sent in portions, as the outbound buffer has space for them
+    LocalResourceTransfer transfer;
+    transfer.type = type;
+    transfer.id = id;
+    transfer.file = nullptr;
+    conn->resourceTransfers.push_back(transfer);
+}
+
+void LocalServer::HandleResourceVerifyChecksum(LOCAL_SERVER_HANDLER_ARGS)
+{
+    std::vector<std::pair<uint8_t, uint32_t> > failed;
+    bool batchIds = (conn->capabilities & PROTOCOL_CAP_CHECKSUM_BATCH_ID) != 0;
+
+    uint32_t batchId = batchIds ? packet.ReadUInt32() : 0;
+    uint16_t count = packet.ReadUInt16();
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint8_t type = packet.ReadUInt8();
+        uint32_t id = packet.ReadUInt32();
+        std::string checksum = packet.ReadString();
+
+        LocalImageRecord* image = (type == RSTYPE_IMAGE) ? m_content.GetImage(id) : nullptr;
+        if (!image || image->checksum != checksum || InjectChecksumFailure())
+            failed.push_back(std::make_pair(type, id));
+    }
+
+    // just the failed ones are reported back
+    SmartPacket response(SP_RESOURCE_VERIFY_CHECKSUM);
+    if (batchIds)
+        response.WriteUInt32(batchId);
+    response.WriteUInt16((uint16_t)failed.size());
+    for (size_t i = 0; i < failed.size(); i++)
+    {
+        response.WriteUInt8(failed[i].first);
+        response.WriteUInt32(failed[i].second);
+    }
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleEnterWorld(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint32_t guid = packet.ReadUInt32();
+
+    SmartPacket response(SP_ENTER_WORLD_RESULT);
+
+    if (guid != conn->characterGuid)
+    {
+        response.WriteUInt8(ENTER_WORLD_FAILED_NOT_OWNED_CHARACTER);
+        SendPacket(conn, response);
+        return;
+    }
+
+    // every character starts at map entry point
+    LocalMapRecord* map = m_content.GetMap(m_entryMapId);
+
+    conn->mapId = m_entryMapId;
+    conn->x = (float)map->header.entryX;
+    conn->y = (float)map->header.entryY;
+    conn->moveMask = 0;
+    conn->positionTime = getMSTime();
+    conn->inWorld = false;
+    conn->visibleObjects.clear();
+    conn->state = CONNECTION_STATE_INGAME;
+
+    response.WriteUInt8(ENTER_WORLD_OK);
+    response.WriteUInt32(conn->mapId);
+    response.WriteFloat(conn->x);
+    response.WriteFloat(conn->y);
+
+    if (conn->capabilities & PROTOCOL_CAP_SESSION_RESUME)
+    {
+        conn->resumeToken = GenerateResumeToken();
+        response.WriteUInt64(conn->resumeToken);
+    }
+
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleWorldEnterComplete(LocalServerConnection* conn, SmartPacket & /*packet*/)
+{
+    SendWorldState(conn);
+}
+
+void LocalServer::SendWorldState(LocalServerConnection* conn)
+{
+    // at first, the player itself
+    SmartPacket create((conn->capabilities & PROTOCOL_CAP_COMPACT_OBJECT_UPDATES) ? SP_CREATE_OBJECT_COMPACT : SP_CREATE_OBJECT);
+    create.WriteUInt8(1);
+    WriteCreateObjectRecord(conn, create, MAKE_GUID64(HIGHGUID_PLAYER, 0, conn->characterGuid), m_playerImageId, conn->x, conn->y, conn->moveMask);
+    SendPacket(conn, create);
+
+    // and then everything around
+    conn->inWorld = true;
+    UpdateVisibility(conn);
+}
+
+void LocalServer::HandleGetMapMetadata(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint32_t mapId = packet.ReadUInt32();
+
+    SmartPacket response(SP_MAP_METADATA);
+
+    LocalMapRecord* map = m_content.GetMap(mapId);
+    if (!map)
+    {
+        response.WriteUInt8(GENERIC_STATUS_NOTFOUND);
+        SendPacket(conn, response);
+        return;
+    }
+
+    MapHeader &mh = map->header;
+    std::string name(mh.name, strnlen(mh.name, MAP_NAME_LENGTH));
+
+    response.WriteUInt8(GENERIC_STATUS_OK);
+    response.WriteUInt32(mh.mapId);
+    response.WriteUInt32(mh.sizeX);
+    response.WriteUInt32(mh.sizeY);
+    response.WriteString(name.c_str());
+    response.WriteUInt32(mh.entryX);
+    response.WriteUInt32(mh.entryY);
+    response.WriteUInt16(mh.defaultFieldType);
+    response.WriteUInt32(mh.defaultFieldTexture);
+    response.WriteUInt32(mh.defaultFieldFlags);
+    response.WriteString(map->filename.c_str());
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleGetMapChunk(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint32_t mapId = packet.ReadUInt32();
+    uint32_t startX = packet.ReadUInt32();
+    uint32_t startY = packet.ReadUInt32();
+
+    SmartPacket response(SP_MAP_CHUNK);
+
+    uint32_t sizeX = 0, sizeY = 0;
+    LocalMapRecord* map = m_content.GetMap(mapId);
+    if (map)
+        LocalServerContent::GetMapChunkSize(map, startX, startY, sizeX, sizeY);
+
+    if (sizeX == 0 || sizeY == 0)
+    {
+        response.WriteUInt8(GENERIC_STATUS_NOTFOUND);
+        SendPacket(conn, response);
+        return;
+    }
+
+    response.WriteUInt8(GENERIC_STATUS_OK);
+    response.WriteUInt32(mapId);
+    response.WriteUInt32(startX);
+    response.WriteUInt32(startY);
+    response.WriteUInt32(sizeX);
+    response.WriteUInt32(sizeY);
+
+    for (uint32_t i = 0; i < sizeX; i++)
+    {
+        for (uint32_t j = 0; j < sizeY; j++)
+        {
+            MapField &mf = map->fields[(size_t)(startX + i) * map->header.sizeY + startY + j];
+            response.WriteUInt16(mf.type);
+            response.WriteUInt32(mf.texture);
+            response.WriteUInt32(mf.flags);
+        }
+    }
+
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleMapMetadataVerifyChecksum(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint32_t mapId = packet.ReadUInt32();
+    std::string checksum = packet.ReadString();
+
+    LocalMapRecord* map = m_content.GetMap(mapId);
+
+    SmartPacket response(SP_MAP_METADATA_VERIFY_CHECKSUM);
+    response.WriteUInt8((map && map->checksum == checksum && !InjectChecksumFailure()) ? GENERIC_STATUS_OK : GENERIC_STATUS_ERROR);
+    response.WriteUInt32(mapId);
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleMapChunkVerifyChecksum(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint32_t mapId = packet.ReadUInt32();
+    uint32_t startX = packet.ReadUInt32();
+    uint32_t startY = packet.ReadUInt32();
+    std::string checksum = packet.ReadString();
+
+    uint32_t sizeX = 0, sizeY = 0;
+    LocalMapRecord* map = m_content.GetMap(mapId);
+    if (map)
+        LocalServerContent::GetMapChunkSize(map, startX, startY, sizeX, sizeY);
+
+    bool valid = (sizeX > 0 && sizeY > 0 && checksum == m_content.GetMapChunkChecksum(map, startX, startY) && !InjectChecksumFailure());
+
+    SmartPacket response(SP_MAP_CHUNK_VERIFY_CHECKSUM);
+    response.WriteUInt8(valid ? GENERIC_STATUS_OK : GENERIC_STATUS_ERROR);
+    response.WriteUInt32(mapId);
+    response.WriteUInt32(startX);
+    response.WriteUInt32(startY);
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleGetImageMetadata(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint32_t id = packet.ReadUInt32();
+
+    SmartPacket response(SP_IMAGE_METADATA);
+
+    LocalImageRecord* image = m_content.GetImage(id);
+    if (!image)
+    {
+        response.WriteUInt8(GENERIC_STATUS_NOTFOUND);
+        SendPacket(conn, response);
+        return;
+    }
+
+    response.WriteUInt8(GENERIC_STATUS_OK);
+    response.WriteUInt32(image->id);
+    response.WriteUInt32(image->sizeX);
+    response.WriteUInt32(image->sizeY);
+    response.WriteUInt32(image->baseCenterX);
+    response.WriteUInt32(image->baseCenterY);
+    response.WriteUInt32(image->collisionX1);
+    response.WriteUInt32(image->collisionY1);
+    response.WriteUInt32(image->collisionX2);
+    response.WriteUInt32(image->collisionY2);
+
+    response.WriteUInt32((uint32_t)image->animations.size());
+    for (size_t i = 0; i < image->animations.size(); i++)
+    {
+        response.WriteUInt32(image->animations[i].animId);
+        response.WriteUInt32(image->animations[i].frameBegin);
+        response.WriteUInt32(image->animations[i].frameEnd);
+        response.WriteUInt32(image->animations[i].frameDelay);
+    }
+
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleVerifyImageMetadataChecksum(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint32_t id = packet.ReadUInt32();
+    std::string checksum = packet.ReadString();
+
+    LocalImageRecord* image = m_content.GetImage(id);
+
+    SmartPacket response(SP_VERIFY_IMAGE_METADATA_CHECKSUM);
+    response.WriteUInt8((image && image->metadataChecksum == checksum && !InjectChecksumFailure()) ? GENERIC_STATUS_OK : GENERIC_STATUS_ERROR);
+    response.WriteUInt32(id);
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleNameQuery(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint64_t guid = packet.ReadUInt64();
+
+    std::string name;
+    if (guid == MAKE_GUID64(HIGHGUID_PLAYER, 0, conn->characterGuid))
+        name = conn->username;
+    else if (m_world.GetObject(guid))
+    {
+        std::stringstream ss;
+        ss << "Creature " << EXTRACT_GUIDLOW(guid);
+        name = ss.str();
+    }
+
+    // empty name means unknown object
+    SmartPacket response(SP_NAME_QUERY_RESPONSE);
+    response.WriteUInt64(guid);
+    response.WriteString(name.c_str());
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleMoveStartDirection(LOCAL_SERVER_HANDLER_ARGS)
+{
+    MoveStartDirRequestBlock request;
+    if (!packet.Decode<MoveStartDirRequestLayout>(request))
+        return;
+
+    // continue from where the previous movement led
+    UpdatePlayerPosition(conn, getMSTime());
+    conn->moveMask |= request.dir;
+}
+
+void LocalServer::HandleMoveStopDirection(LOCAL_SERVER_HANDLER_ARGS)
+{
+    MoveStopDirRequestBlock request;
+    if (!packet.Decode<MoveStopDirRequestLayout>(request))
+        return;
+
+    // the client is trusted, there's nothing to cheat on
+    conn->moveMask &= ~request.dir;
+    conn->x = request.x;
+    conn->y = request.y;
+    conn->positionTime = getMSTime();
+}
+
+void LocalServer::HandleMoveHeartbeat(LOCAL_SERVER_HANDLER_ARGS)
+{
+    MoveHeartbeatRequestBlock request;
+    if (!packet.Decode<MoveHeartbeatRequestLayout>(request))
+        return;
+
+    conn->moveMask = request.moveMask;
+    conn->x = request.x;
+    conn->y = request.y;
+    conn->positionTime = getMSTime();
+}
+
+void LocalServer::HandleChatMessage(LOCAL_SERVER_HANDLER_ARGS)
+{
+    ChatMessageRequestHeaderBlock header;
+    std::string msg;
+    if (!packet.Decode<ChatMessageRequestHeaderLayout>(header) || !packet.ReadString(msg))
+        return;
+
+    // nobody else sees the player, so the message is just echoed back as server message
+    SmartPacket response(SP_CHAT_MESSAGE);
+    response.WriteUInt8(TALK_SERVER_MESSAGE);
+    response.WriteUInt64(0);
+    response.WriteString((conn->username + ": " + msg).c_str());
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleInventoryQuery(LocalServerConnection* conn, SmartPacket & /*packet*/)
+{
+    std::map<uint32_t, LocalItemRecord> const& items = m_content.GetItems();
+    std::map<uint32_t, LocalItemRecord>::const_iterator itr = items.begin();
+
+    // one piece of every served item, as long as there's free slot
+    SmartPacket response(SP_INVENTORY);
+    for (uint32_t i = 0; i < CHARACTER_INVENTORY_SLOTS; i++)
+    {
+        if (itr == items.end())
+        {
+            response.WriteUInt32(0);
+            continue;
+        }
+
+        response.WriteUInt32(i + 1);
+        response.WriteUInt32(itr->second.id);
+        response.WriteUInt32(1);
+        ++itr;
+    }
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleItemQuery(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint32_t id = packet.ReadUInt32();
+
+    SmartPacket response(SP_ITEM_QUERY_RESPONSE);
+
+    LocalItemRecord* item = m_content.GetItem(id);
+    if (!item)
+    {
+        response.WriteUInt8(GENERIC_STATUS_NOTFOUND);
+        SendPacket(conn, response);
+        return;
+    }
+
+    response.WriteUInt8(GENERIC_STATUS_OK);
+    response.WriteUInt32(item->id);
+    response.WriteUInt32(item->imageId);
+    response.WriteString(item->name.c_str());
+    response.WriteString(item->description.c_str());
+    response.WriteUInt32(item->stackSize);
+    response.WriteUInt32(item->rarity);
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandlePing(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint32_t clientTime = packet.ReadUInt32();
+
+    // client and server share the clock, so the client should see zero offset
+    SmartPacket response(SP_PONG);
+    response.WriteUInt32(clientTime);
+    response.WriteUInt32(getMSTime());
+    SendPacket(conn, response);
+}
+
+void LocalServer::HandleResumeSession(LOCAL_SERVER_HANDLER_ARGS)
+{
+    uint64_t token = packet.ReadUInt64();
+    uint32_t version = packet.ReadUInt32();
+    uint32_t capabilities = packet.ReadUInt32();
+
+    uint32_t now = getMSTime();
+    PurgeResumeRecords(now);
+
+    SmartPacket response(SP_RESUME_SESSION_RESULT);
+
+    if (version != APP_VERSION)
+    {
+        response.WriteUInt8(RESUME_SESSION_INCOMPATIBLE_VERSION);
+        SendPacket(conn, response);
+        return;
+    }
+
+    std::map<uint64_t, LocalResumeRecord>::iterator itr = m_resumeRecords.find(token);
+    if (token == 0 || itr == m_resumeRecords.end())
+    {
+        response.WriteUInt8(RESUME_SESSION_UNKNOWN_TOKEN);
+        SendPacket(conn, response);
+        return;
+    }
+
+    // restore the character where it was, standing still
+    conn->username = itr->second.username;
+    conn->characterGuid = itr->second.characterGuid;
+    conn->mapId = itr->second.mapId;
+    conn->x = itr->second.x;
+    conn->y = itr->second.y;
+    conn->moveMask = 0;
+    conn->positionTime = now;
+    conn->inWorld = false;
+    conn->visibleObjects.clear();
+    conn->capabilities = capabilities & LOCAL_SERVER_CAPABILITIES;
+    conn->session->SetExtendedFramesEnabled((conn->capabilities & PROTOCOL_CAP_LARGE_FRAMES) != 0);
+    conn->state = CONNECTION_STATE_INGAME;
+
+    // every token is valid just once
+    m_resumeRecords.erase(itr);
+    conn->resumeToken = GenerateResumeToken();
+
+    response.WriteUInt8(RESUME_SESSION_OK);
+    response.WriteUInt32(m_content.GetContentEpoch());
+    response.WriteUInt32(conn->capabilities);
+    response.WriteUInt64(conn->resumeToken);
+    response.WriteUInt32(conn->mapId);
+    response.WriteFloat(conn->x);
+    response.WriteFloat(conn->y);
+    SendPacket(conn, response);
+
+    // the client kept its map, just the objects are sent again right away
+    SendWorldState(conn);
+}
+
+bool LocalServer::InjectChecksumFailure()
+{
+    if (m_checksumFailureRate == 0)
+        return false;
+
+    std::uniform_int_distribution<uint32_t> percent(0, 99);
+    return (percent(m_checksumFailureRandom) < m_checksumFailureRate);
+}
+
+uint64_t LocalServer::GenerateResumeToken()
+{
+    uint64_t token;
+
+    // zero means no token at all
+    do
+    {
+        token = m_tokenRandom();
+    } while (token == 0 || m_resumeRecords.find(token) != m_resumeRecords.end());
+
+    return token;
+}
+
+void LocalServer::PurgeResumeRecords(uint32_t now)
+{
+    for (std::map<uint64_t, LocalResumeRecord>::iterator itr = m_resumeRecords.begin(); itr != m_resumeRecords.end(); )
+    {
+        if ((int32_t)(now - itr->second.expireTime) >= 0)
+            itr = m_resumeRecords.erase(itr);
+        else
+            ++itr;
+    }
+}
+
+void LocalServer::UpdateWorld(uint32_t now)
+{
+    std::vector<LocalWorldObject*> changed;
+    m_world.Update(now, changed);
+
+    for (std::list<LocalServerConnection*>::iterator itr = m_connections.begin(); itr != m_connections.end(); ++itr)
+    {
+        LocalServerConnection* conn = *itr;
+        if (!conn->inWorld || conn->closing)
+            continue;
+
+        UpdatePlayerPosition(conn, now);
+        UpdateVisibility(conn);
+
+        // the client interpolates movement on its own, it needs just changes
+        for (size_t i = 0; i < changed.size(); i++)
+        {
+            if (conn->visibleObjects.find(changed[i]->guid) != conn->visibleObjects.end())
+                SendObjectMovement(conn, changed[i]);
+        }
+    }
+}
+
+void LocalServer::UpdatePlayerPosition(LocalServerConnection* conn, uint32_t now)
+{
+    float dx, dy;
+    uint32_t diff = getMSTimeDiff(conn->positionTime, now);
+    conn->positionTime = now;
+
+    if (conn->moveMask == 0)
+        return;
+
+    LocalServerWorld::GetMovementVector(conn->moveMask, dx, dy);
+
+    LocalMapRecord* map = m_content.GetMap(conn->mapId);
+    conn->x = num_max(0.0f, num_min((float)map->header.sizeX, conn->x + dx * (float)diff));
+    conn->y = num_max(0.0f, num_min((float)map->header.sizeY, conn->y + dy * (float)diff));
+}
+
+void LocalServer::UpdateVisibility(LocalServerConnection* conn)
+{
+    // the client keeps surrounding chunks loaded, so it sees objects in them
+    uint32_t cellX = (uint32_t)conn->x / MAP_CELL_SIZE_X;
+    uint32_t cellY = (uint32_t)conn->y / MAP_CELL_SIZE_Y;
+    float minX = (float)((cellX > MAP_SORROUNDING_CELLS_X ? cellX - MAP_SORROUNDING_CELLS_X : 0) * MAP_CELL_SIZE_X);
+    float minY = (float)((cellY > MAP_SORROUNDING_CELLS_Y ? cellY - MAP_SORROUNDING_CELLS_Y : 0) * MAP_CELL_SIZE_Y);
+    float maxX = (float)((cellX + MAP_SORROUNDING_CELLS_X + 1) * MAP_CELL_SIZE_X);
+    float maxY = (float)((cellY + MAP_SORROUNDING_CELLS_Y + 1) * MAP_CELL_SIZE_Y);
+
+    std::vector<LocalWorldObject*> objects;
+    m_world.GetObjectsInArea(conn->mapId, minX, minY, maxX, maxY, objects);
+
+    std::set<uint64_t> visible;
+    std::vector<LocalWorldObject*> created;
+    std::vector<uint64_t> destroyed;
+
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        visible.insert(objects[i]->guid);
+        if (conn->visibleObjects.find(objects[i]->guid) == conn->visibleObjects.end())
+            created.push_back(objects[i]);
+    }
+
+    for (std::set<uint64_t>::iterator itr = conn->visibleObjects.begin(); itr != conn->visibleObjects.end(); ++itr)
+    {
+        if (visible.find(*itr) == visible.end())
+            destroyed.push_back(*itr);
+    }
+
+    conn->visibleObjects.swap(visible);
+
+    // create objects, which came into sight
+    for (size_t i = 0; i < created.size(); i += UPDATEPACKET_COUNT_LIMIT)
+    {
+        uint32_t count = (uint32_t)num_min(created.size() - i, (size_t)UPDATEPACKET_COUNT_LIMIT);
+
+        SmartPacket create((conn->capabilities & PROTOCOL_CAP_COMPACT_OBJECT_UPDATES) ? SP_CREATE_OBJECT_COMPACT : SP_CREATE_OBJECT);
+        create.WriteUInt8((uint8_t)count);
+        for (uint32_t j = 0; j < count; j++)
+        {
+            LocalWorldObject* obj = created[i + j];
+            WriteCreateObjectRecord(conn, create, obj->guid, obj->imageId, obj->x, obj->y, obj->moveMask);
+        }
+        SendPacket(conn, create);
+    }
+
+    // and destroy the ones out of sight
+    for (size_t i = 0; i < destroyed.size(); i += UPDATEPACKET_COUNT_LIMIT)
+    {
+        uint32_t count = (uint32_t)num_min(destroyed.size() - i, (size_t)UPDATEPACKET_COUNT_LIMIT);
+
+        SmartPacket destroy(SP_DESTROY_OBJECT);
+        destroy.WriteUInt8((uint8_t)count);
+        for (uint32_t j = 0; j < count; j++)
+            destroy.WriteUInt64(destroyed[i + j]);
+        SendPacket(conn, destroy);
+    }
+}
+
+void LocalServer::WriteCreateObjectRecord(LocalServerConnection* conn, SmartPacket &pkt, uint64_t guid, uint32_t imageId, float x, float y, uint8_t moveMask)
+{
+    if (conn->capabilities & PROTOCOL_CAP_COMPACT_OBJECT_UPDATES)
+    {
+        // GUID, movement mask, packed position and field set
+        pkt.WriteUInt64(guid);
+        pkt.WriteUInt8(moveMask);
+        CompactObjectUpdate::WritePosition(pkt, x, y);
+        LocalServerWorld::WriteUnitFields(pkt, guid, imageId, LOCAL_WORLD_OBJECT_LEVEL, LOCAL_WORLD_OBJECT_FACTION, LOCAL_WORLD_OBJECT_HEALTH, true);
+        return;
+    }
+
+    pkt.WriteUInt64(guid);
+    LocalServerWorld::WriteUnitFields(pkt, guid, imageId, LOCAL_WORLD_OBJECT_LEVEL, LOCAL_WORLD_OBJECT_FACTION, LOCAL_WORLD_OBJECT_HEALTH, false);
+    pkt.WriteFloat(x);
+    pkt.WriteFloat(y);
+    pkt.WriteUInt8(moveMask);
+}
+
+void LocalServer::SendObjectMovement(LocalServerConnection* conn, LocalWorldObject* obj)
+{
+    // heartbeat carries both position and movement mask
+    SmartPacket move(SP_MOVE_HEARTBEAT);
+    move.WriteUInt64(obj->guid);
+    move.WriteUInt8(obj->moveMask);
+    move.WriteFloat(obj->x);
+    move.WriteFloat(obj->y);
+    SendPacket(conn, move);
+}
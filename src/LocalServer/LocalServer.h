@@ -0,0 +1,260 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_LOCALSERVER_H
+#define BW_LOCALSERVER_H
+
+#include "Singleton.h"
+#include "NetworkEventLoop.h"
+#include "NetworkSession.h"
+#include "PacketHandlers.h"
+#include "LocalServerContent.h"
+#include "LocalServerWorld.h"
+
+// time between two world updates of local server (ms)
+#define LOCAL_SERVER_TICK               50
+// maximum count of clients connected at once
+#define LOCAL_SERVER_MAX_CONNECTIONS    48
+// size of one resource data portion sent to client
+#define LOCAL_SERVER_RESOURCE_PORTION   32*1024
+// size of one resource data portion sent to client supporting extended frames
+#define LOCAL_SERVER_LARGE_RESOURCE_PORTION 4*1024*1024
+// receive buffer of client session; clients send just small packets, but it has to hold one maximum-sized regular frame
+#define LOCAL_SERVER_RECV_BUFFER_SIZE   128*1024
+// outbound buffer of client session; holds two large resource portions
+#define LOCAL_SERVER_SEND_BUFFER_SIZE   2*LOCAL_SERVER_LARGE_RESOURCE_PORTION
+// outbound buffer space kept free for regular responses; client packets are not handled, while there's less
+#define LOCAL_SERVER_SEND_HEADROOM      256*1024
+// capacity of queue of received packets of client session
+#define LOCAL_SERVER_PACKET_QUEUE_SIZE  256
+// count of packets allocated in advance for client session
+#define LOCAL_SERVER_PACKET_POOL_SIZE   16
+// GUID of the first character; every connection gets its own character
+#define LOCAL_SERVER_FIRST_CHARACTER    1
+// time the session of disconnected player could be resumed within (ms)
+#define LOCAL_SERVER_RESUME_TIMEOUT     60000
+// protocol capabilities the local server supports
+#define LOCAL_SERVER_CAPABILITIES       (PROTOCOL_CAP_COMPACT_OBJECT_UPDATES | PROTOCOL_CAP_LARGE_FRAMES | PROTOCOL_CAP_SESSION_RESUME | PROTOCOL_CAP_CHECKSUM_BATCH_ID | \
+                                         PROTOCOL_CAP_PING)
+
+class LocalServer;
+
+/*
+ * Structure of resource being sent to client in portions
+ */
+struct LocalResourceTransfer
+{
+    // resource type
+    ResourceType type;
+    // resource ID
+    uint32_t id;
+    // resource file; nullptr until the transfer starts
+    FILE* file;
+};
+
+/*
+ * Structure of one client connection to local server
+ */
+struct LocalServerConnection
+{
+    // network session of client
+    NetworkSession* session;
+    // should the connection be closed?
+    bool closing;
+
+    // state of connection
+    ConnectionState state;
+    // name the client logged in with
+    std::string username;
+    // GUID of character owned by this connection
+    uint32_t characterGuid;
+    // protocol capabilities confirmed to client
+    uint32_t capabilities;
+    // token the session could be resumed with; 0 if none
+    uint64_t resumeToken;
+
+    // has the client finished entering world?
+    bool inWorld;
+    // map the player is on
+    uint32_t mapId;
+    // last known player position
+    float x;
+    float y;
+    // player movement mask
+    uint8_t moveMask;
+    // time of last known position (mstime)
+    uint32_t positionTime;
+    // synthetic objects the client knows about
+    std::set<uint64_t> visibleObjects;
+    // requested resources, sent as the outbound buffer has space for them
+    std::list<LocalResourceTransfer> resourceTransfers;
+};
+
+/*
+ * Structure of session kept after the client disconnected, so it could be resumed
+ */
+struct LocalResumeRecord
+{
+    // name the client logged in with
+    std::string username;
+    // GUID of character
+    uint32_t characterGuid;
+    // map the player was on
+    uint32_t mapId;
+    // last known player position
+    float x;
+    float y;
+    // time the record expires (mstime)
+    uint32_t expireTime;
+};
+
+// local server packet handler arguments
+#define LOCAL_SERVER_HANDLER_ARGS LocalServerConnection* conn, SmartPacket &packet
+
+/*
+ * Structure of local server packet handler record
+ */
+struct LocalServerHandlerStructure
+{
+    // handler method; nullptr means the packet is ignored
+    void (LocalServer::*handler)(LOCAL_SERVER_HANDLER_ARGS);
+
+    // state restriction
+    StateRestrictionMask stateRestriction;
+};
+
+/*
+ * Class of in-process stand-in game server - listens on loopback, speaks the same protocol as the real server and
+ * serves content from directory along with synthetic world objects; used for end-to-end tests and benchmarks
+ */
+class LocalServer
+{
+    friend class Singleton<LocalServer>;
+    public:
+        ~LocalServer();
+
+        // loads content, starts listening on loopback on configured connect port and spawns server thread
+        bool Init();
+        // stops server thread and closes all connections
+        void Shutdown();
+        // is the server running?
+        bool IsRunning();
+
+        // client packet handlers
+        void HandleLoginRequest(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleCharacterListRequest(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleRequestResource(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleResourceVerifyChecksum(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleEnterWorld(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleWorldEnterComplete(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleGetMapMetadata(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleGetMapChunk(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleMapMetadataVerifyChecksum(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleMapChunkVerifyChecksum(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleGetImageMetadata(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleVerifyImageMetadataChecksum(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleNameQuery(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleMoveStartDirection(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleMoveStopDirection(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleMoveHeartbeat(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleChatMessage(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleInventoryQuery(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleItemQuery(LOCAL_SERVER_HANDLER_ARGS);
+        void HandlePing(LOCAL_SERVER_HANDLER_ARGS);
+        void HandleResumeSession(LOCAL_SERVER_HANDLER_ARGS);
+
+    protected:
+        // protected singleton constructor
+        LocalServer();
+
+        // server thread routine
+        void Run();
+        // starts serving connection accepted by event loop
+        void AcceptConnection(SOCK sock);
+        // handles packets received from client, as long as there's space for responses
+        void ProcessPackets(LocalServerConnection* conn);
+        // looks handler up and calls it
+        void HandlePacket(LocalServerConnection* conn, SmartPacket &packet);
+        // queues packet to be sent to client
+        void SendPacket(LocalServerConnection* conn, SmartPacket &packet);
+        // sends portions of requested resources, as long as there's space for them
+        void SendResourceTransfers(LocalServerConnection* conn);
+        // closes connection and frees it; the session is deleted after the event loop processes its removal
+        void CloseConnection(LocalServerConnection* conn);
+
+        // should the verification of content with supplied checksum fail regardless of content?
+        bool InjectChecksumFailure();
+
+        // generates new session resume token
+        uint64_t GenerateResumeToken();
+        // removes expired session resume records
+        void PurgeResumeRecords(uint32_t now);
+        // sends player and everything around to client, which finished entering world
+        void SendWorldState(LocalServerConnection* conn);
+
+        // moves synthetic objects and sends updates to clients in world
+        void UpdateWorld(uint32_t now);
+        // updates player position by movement since last known one
+        void UpdatePlayerPosition(LocalServerConnection* conn, uint32_t now);
+        // creates and destroys synthetic objects on client, as the player moves
+        void UpdateVisibility(LocalServerConnection* conn);
+        // sends movement of synthetic object
+        void SendObjectMovement(LocalServerConnection* conn, LocalWorldObject* obj);
+        // writes one object record of create packet, in format confirmed to client
+        void WriteCreateObjectRecord(LocalServerConnection* conn, SmartPacket &pkt, uint64_t guid, uint32_t imageId, float x, float y, uint8_t moveMask);
+
+    private:
+        // server thread
+        std::thread* m_thread;
+        // is the server supposed to run?
+        std::atomic<bool> m_running;
+        // event loop serving listening socket and client sessions; run by server thread
+        NetworkEventLoop m_eventLoop;
+        // listening socket
+        SOCK m_listenSocket;
+        // connected clients
+        std::list<LocalServerConnection*> m_connections;
+        // sessions of closed connections, deleted after the event loop removes them
+        std::vector<NetworkSession*> m_closedSessions;
+        // GUID of next character
+        uint32_t m_nextCharacterGuid;
+        // buffer for resource portion read from file
+        std::vector<uint8_t> m_resourcePortion;
+        // sessions of disconnected players, which could be resumed; key = resume token
+        std::map<uint64_t, LocalResumeRecord> m_resumeRecords;
+        // generator of resume tokens
+        std::mt19937_64 m_tokenRandom;
+        // percentage of checksum verifications failed on purpose
+        uint32_t m_checksumFailureRate;
+        // generator of injected checksum failures, seeded constantly, so every run fails the same way
+        std::mt19937 m_checksumFailureRandom;
+
+        // served content
+        LocalServerContent m_content;
+        // synthetic world objects
+        LocalServerWorld m_world;
+        // map the players enter world on
+        uint32_t m_entryMapId;
+        // image of players
+        uint32_t m_playerImageId;
+};
+
+#define sLocalServer Singleton<LocalServer>::getInstance()
+
+#endif
@@ -0,0 +1,380 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "LocalServerContent.h"
+#include "Log.h"
+#include "CRC32.h"
+
+#include <fstream>
+#include <sstream>
+
+LocalServerContent::LocalServerContent()
+{
+    m_defaultMapId = 0;
+    m_contentEpoch = 0;
+}
+
+LocalServerContent::~LocalServerContent()
+{
+    //
+}
+
+bool LocalServerContent::Load(const char* directory)
+{
+    std::string dir = directory ? directory : "";
+
+    // allow directory to be specified with or without trailing slash
+    if (!dir.empty() && dir[dir.length() - 1] != '/' && dir[dir.length() - 1] != '\\')
+        dir += "/";
+
+    if (!LoadMaps(dir) || !LoadImages(dir) || !LoadItems(dir))
+        return false;
+
+    if (m_maps.empty())
+    {
+        sLog->Error("Local server: no map found in %s%s", dir.c_str(), LOCAL_SERVER_MAPS_INDEX);
+        return false;
+    }
+
+    // content epoch changes whenever any of served content changes
+    uint32_t crc = 0;
+    for (std::map<uint32_t, LocalMapRecord>::iterator itr = m_maps.begin(); itr != m_maps.end(); ++itr)
+        crc = CRC32_Bytes_Continuous((uint8_t*)itr->second.checksum.c_str(), (uint32_t)itr->second.checksum.length(), crc);
+    for (std::map<uint32_t, LocalImageRecord>::iterator itr = m_images.begin(); itr != m_images.end(); ++itr)
+    {
+        crc = CRC32_Bytes_Continuous((uint8_t*)itr->second.checksum.c_str(), (uint32_t)itr->second.checksum.length(), crc);
+        crc = CRC32_Bytes_Continuous((uint8_t*)itr->second.metadataChecksum.c_str(), (uint32_t)itr->second.metadataChecksum.length(), crc);
+    }
+    m_contentEpoch = CRC32_Bytes_ContinuousFinalize(crc);
+
+    sLog->Info("Local server: loaded %u maps, %u images and %u items", (uint32_t)m_maps.size(), (uint32_t)m_images.size(), (uint32_t)m_items.size());
+
+    return true;
+}
+
+bool LocalServerContent::LoadMaps(const std::string &directory)
+{
+    std::ifstream index((directory + LOCAL_SERVER_MAPS_INDEX).c_str());
+    if (!index.is_open())
+    {
+        sLog->Error("Local server: could not open map index %s%s", directory.c_str(), LOCAL_SERVER_MAPS_INDEX);
+        return false;
+    }
+
+    std::string line, filename;
+    uint32_t mapId;
+    MapHeader fh;
+
+    while (std::getline(index, line))
+    {
+        // skip comments and empty lines
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream ls(line);
+        if (!(ls >> mapId >> filename))
+        {
+            sLog->Error("Local server: invalid map index line: %s", line.c_str());
+            continue;
+        }
+
+        FILE* f = fopen((directory + filename).c_str(), "rb");
+        if (!f)
+        {
+            sLog->Error("Local server: could not open map file %s", filename.c_str());
+            continue;
+        }
+
+        if (fread(&fh, sizeof(MapHeader), 1, f) != 1 || fh.mapVersionMagic != MAP_VERSION_MAGIC)
+        {
+            sLog->Error("Local server: map file %s is not valid", filename.c_str());
+            fclose(f);
+            continue;
+        }
+
+        LocalMapRecord &rec = m_maps[mapId];
+
+        // build header the same way as client does from metadata packet, so the checksums match
+        memset(&rec.header, 0, sizeof(MapHeader));
+        rec.header.mapVersionMagic = MAP_VERSION_MAGIC;
+        rec.header.mapId = mapId;
+        rec.header.sizeX = fh.sizeX;
+        rec.header.sizeY = fh.sizeY;
+        for (int i = 0; i < MAP_NAME_LENGTH && fh.name[i] != '\0'; i++)
+            rec.header.name[i] = fh.name[i];
+        rec.header.entryX = fh.entryX;
+        rec.header.entryY = fh.entryY;
+        rec.header.defaultFieldType = fh.defaultFieldType;
+        rec.header.defaultFieldTexture = fh.defaultFieldTexture;
+        rec.header.defaultFieldFlags = fh.defaultFieldFlags;
+
+        rec.filename = filename;
+        rec.checksum = CalculateMapChecksum(rec.header);
+        rec.chunkChecksums.clear();
+
+        // fields are stored column after column
+        rec.fields.resize((size_t)fh.sizeX * fh.sizeY);
+        if (!rec.fields.empty() && fread(rec.fields.data(), sizeof(MapField), rec.fields.size(), f) != rec.fields.size())
+        {
+            sLog->Error("Local server: map file %s is truncated", filename.c_str());
+            fclose(f);
+            m_maps.erase(mapId);
+            continue;
+        }
+
+        fclose(f);
+
+        if (m_defaultMapId == 0)
+            m_defaultMapId = mapId;
+    }
+
+    return true;
+}
+
+bool LocalServerContent::LoadImages(const std::string &directory)
+{
+    std::ifstream index((directory + LOCAL_SERVER_IMAGES_INDEX).c_str());
+    if (!index.is_open())
+    {
+        sLog->Error("Local server: could not open image index %s%s", directory.c_str(), LOCAL_SERVER_IMAGES_INDEX);
+        return false;
+    }
+
+    std::string line, type;
+    uint32_t id;
+
+    while (std::getline(index, line))
+    {
+        // skip comments and empty lines
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream ls(line);
+        if (!(ls >> type >> id))
+        {
+            sLog->Error("Local server: invalid image index line: %s", line.c_str());
+            continue;
+        }
+
+        if (type == "image")
+        {
+            LocalImageRecord rec;
+            rec.id = id;
+            if (!(ls >> rec.filename >> rec.sizeX >> rec.sizeY >> rec.baseCenterX >> rec.baseCenterY >> rec.collisionX1 >> rec.collisionY1 >> rec.collisionX2 >> rec.collisionY2))
+            {
+                sLog->Error("Local server: invalid image index line: %s", line.c_str());
+                continue;
+            }
+
+            rec.path = directory + rec.filename;
+
+            FILE* f = fopen(rec.path.c_str(), "rb");
+            if (!f)
+            {
+                sLog->Error("Local server: could not open image file %s", rec.filename.c_str());
+                continue;
+            }
+
+            rec.checksum = GetCRC32String(CRC32_File(f));
+            fclose(f);
+
+            m_images[id] = rec;
+        }
+        else if (type == "anim")
+        {
+            std::map<uint32_t, LocalImageRecord>::iterator itr = m_images.find(id);
+            if (itr == m_images.end())
+            {
+                sLog->Error("Local server: animation of unknown image %u", id);
+                continue;
+            }
+
+            LocalImageAnimRecord anim;
+            if (!(ls >> anim.animId >> anim.frameBegin >> anim.frameEnd >> anim.frameDelay))
+            {
+                sLog->Error("Local server: invalid image index line: %s", line.c_str());
+                continue;
+            }
+
+            itr->second.animations.push_back(anim);
+        }
+        else
+            sLog->Error("Local server: invalid image index line: %s", line.c_str());
+    }
+
+    // animations are complete now
+    for (std::map<uint32_t, LocalImageRecord>::iterator itr = m_images.begin(); itr != m_images.end(); ++itr)
+        itr->second.metadataChecksum = CalculateImageMetadataChecksum(itr->second);
+
+    return true;
+}
+
+bool LocalServerContent::LoadItems(const std::string &directory)
+{
+    std::ifstream index((directory + LOCAL_SERVER_ITEMS_INDEX).c_str());
+    // items are optional
+    if (!index.is_open())
+        return true;
+
+    std::string line, texts;
+    LocalItemRecord rec;
+
+    while (std::getline(index, line))
+    {
+        // skip comments and empty lines
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream ls(line);
+        if (!(ls >> rec.id >> rec.imageId >> rec.stackSize >> rec.rarity) || !std::getline(ls >> std::ws, texts))
+        {
+            sLog->Error("Local server: invalid item index line: %s", line.c_str());
+            continue;
+        }
+
+        // name and description are separated by | character
+        size_t pos = texts.find('|');
+        rec.name = texts.substr(0, pos);
+        rec.description = (pos != std::string::npos) ? texts.substr(pos + 1) : "";
+
+        m_items[rec.id] = rec;
+    }
+
+    return true;
+}
+
+std::string LocalServerContent::CalculateMapChecksum(MapHeader &header)
+{
+    return GetCRC32String(CRC32_Bytes((uint8_t*)&header, sizeof(MapHeader)));
+}
+
+std::string LocalServerContent::CalculateImageMetadataChecksum(LocalImageRecord &image)
+{
+    uint32_t crc = 0;
+
+    crc = CRC32_Bytes_Continuous((uint8_t*)&image.id, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&image.sizeX, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&image.sizeY, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&image.baseCenterX, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&image.baseCenterY, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&image.collisionX1, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&image.collisionY1, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&image.collisionX2, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&image.collisionY2, sizeof(uint32_t), crc);
+
+    for (size_t i = 0; i < image.animations.size(); i++)
+    {
+        LocalImageAnimRecord &anim = image.animations[i];
+        crc = CRC32_Bytes_Continuous((uint8_t*)&anim.animId, sizeof(uint32_t), crc);
+        crc = CRC32_Bytes_Continuous((uint8_t*)&anim.frameBegin, sizeof(uint32_t), crc);
+        crc = CRC32_Bytes_Continuous((uint8_t*)&anim.frameEnd, sizeof(uint32_t), crc);
+        crc = CRC32_Bytes_Continuous((uint8_t*)&anim.frameDelay, sizeof(uint32_t), crc);
+    }
+
+    return GetCRC32String(CRC32_Bytes_ContinuousFinalize(crc));
+}
+
+LocalMapRecord* LocalServerContent::GetMap(uint32_t id)
+{
+    std::map<uint32_t, LocalMapRecord>::iterator itr = m_maps.find(id);
+    if (itr == m_maps.end())
+        return nullptr;
+
+    return &itr->second;
+}
+
+uint32_t LocalServerContent::GetDefaultMapId()
+{
+    return m_defaultMapId;
+}
+
+std::map<uint32_t, LocalMapRecord>& LocalServerContent::GetMaps()
+{
+    return m_maps;
+}
+
+void LocalServerContent::GetMapChunkSize(LocalMapRecord* map, uint32_t startX, uint32_t startY, uint32_t &sizeX, uint32_t &sizeY)
+{
+    sizeX = (startX < map->header.sizeX) ? num_min((uint32_t)MAP_CHUNK_SIZE_X, map->header.sizeX - startX) : 0;
+    sizeY = (startY < map->header.sizeY) ? num_min((uint32_t)MAP_CHUNK_SIZE_Y, map->header.sizeY - startY) : 0;
+}
+
+const char* LocalServerContent::GetMapChunkChecksum(LocalMapRecord* map, uint32_t startX, uint32_t startY)
+{
+    uint64_t key = ((uint64_t)startX << 32) | (uint64_t)startY;
+
+    std::unordered_map<uint64_t, std::string>::iterator itr = map->chunkChecksums.find(key);
+    if (itr != map->chunkChecksums.end())
+        return itr->second.c_str();
+
+    uint32_t sizeX, sizeY;
+    GetMapChunkSize(map, startX, startY, sizeX, sizeY);
+
+    MapField mf;
+    uint32_t crc = 0;
+
+    // the same as the client does after receiving chunk
+    for (uint32_t i = 0; i < sizeX; i++)
+    {
+        for (uint32_t j = 0; j < sizeY; j++)
+        {
+            MapField &src = map->fields[(size_t)(startX + i) * map->header.sizeY + startY + j];
+
+            memset(&mf, 0, sizeof(MapField));
+            mf.type = src.type;
+            mf.texture = src.texture;
+            mf.flags = src.flags;
+
+            crc = CRC32_Bytes_Continuous((uint8_t*)&mf, sizeof(MapField), crc);
+        }
+    }
+
+    map->chunkChecksums[key] = GetCRC32String(CRC32_Bytes_ContinuousFinalize(crc));
+
+    return map->chunkChecksums[key].c_str();
+}
+
+LocalImageRecord* LocalServerContent::GetImage(uint32_t id)
+{
+    std::map<uint32_t, LocalImageRecord>::iterator itr = m_images.find(id);
+    if (itr == m_images.end())
+        return nullptr;
+
+    return &itr->second;
+}
+
+LocalItemRecord* LocalServerContent::GetItem(uint32_t id)
+{
+    std::map<uint32_t, LocalItemRecord>::iterator itr = m_items.find(id);
+    if (itr == m_items.end())
+        return nullptr;
+
+    return &itr->second;
+}
+
+std::map<uint32_t, LocalItemRecord> const& LocalServerContent::GetItems()
+{
+    return m_items;
+}
+
+uint32_t LocalServerContent::GetContentEpoch()
+{
+    return m_contentEpoch;
+}
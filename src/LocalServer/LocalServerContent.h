@@ -0,0 +1,162 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_LOCALSERVERCONTENT_H
+#define BW_LOCALSERVERCONTENT_H
+
+#include "Map.h"
+
+// index file of served maps; lines in "<mapId> <file>" format, the file uses client map file format
+#define LOCAL_SERVER_MAPS_INDEX     "maps.txt"
+// index file of served images; lines in "image <imageId> <file> <sizeX> <sizeY> <baseCenterX> <baseCenterY> <collisionX1> <collisionY1>
+// <collisionX2> <collisionY2>" and "anim <imageId> <animId> <frameBegin> <frameEnd> <frameDelay>" format
+#define LOCAL_SERVER_IMAGES_INDEX   "images.txt"
+// index file of served items; lines in "<itemId> <imageId> <stackSize> <rarity> <name>|<description>" format
+#define LOCAL_SERVER_ITEMS_INDEX    "items.txt"
+
+/*
+ * Structure of map served by local server
+ */
+struct LocalMapRecord
+{
+    // map header, as the client reconstructs it from metadata packet
+    MapHeader header;
+    // name of map file, as sent to client
+    std::string filename;
+    // map fields, column after column (index is x * sizeY + y)
+    std::vector<MapField> fields;
+    // checksum of map metadata
+    std::string checksum;
+    // cached checksums of chunks, key is made of chunk start coordinates
+    std::unordered_map<uint64_t, std::string> chunkChecksums;
+};
+
+/*
+ * Structure of image animation served by local server
+ */
+struct LocalImageAnimRecord
+{
+    uint32_t animId;
+    uint32_t frameBegin;
+    uint32_t frameEnd;
+    uint32_t frameDelay;
+};
+
+/*
+ * Structure of image served by local server
+ */
+struct LocalImageRecord
+{
+    uint32_t id;
+    // name of image file, as sent to client
+    std::string filename;
+    // full path to image file
+    std::string path;
+    // checksum of image file
+    std::string checksum;
+
+    // image metadata
+    uint32_t sizeX;
+    uint32_t sizeY;
+    uint32_t baseCenterX;
+    uint32_t baseCenterY;
+    uint32_t collisionX1;
+    uint32_t collisionY1;
+    uint32_t collisionX2;
+    uint32_t collisionY2;
+    std::vector<LocalImageAnimRecord> animations;
+    // checksum of image metadata
+    std::string metadataChecksum;
+};
+
+/*
+ * Structure of item served by local server
+ */
+struct LocalItemRecord
+{
+    uint32_t id;
+    uint32_t imageId;
+    std::string name;
+    std::string description;
+    uint32_t stackSize;
+    uint32_t rarity;
+};
+
+/*
+ * Class holding all content served by local server; everything is loaded from directory at once, and the checksums
+ * are calculated the same way the client calculates them
+ */
+class LocalServerContent
+{
+    public:
+        LocalServerContent();
+        ~LocalServerContent();
+
+        // loads maps, images and items from supplied directory
+        bool Load(const char* directory);
+
+        // retrieves map record; returns nullptr if not found
+        LocalMapRecord* GetMap(uint32_t id);
+        // retrieves ID of map listed first; 0 if there's none
+        uint32_t GetDefaultMapId();
+        // retrieves all maps
+        std::map<uint32_t, LocalMapRecord>& GetMaps();
+        // retrieves checksum of map chunk starting at supplied coordinates
+        const char* GetMapChunkChecksum(LocalMapRecord* map, uint32_t startX, uint32_t startY);
+        // retrieves size of map chunk starting at supplied coordinates (chunks at map edge may be smaller)
+        static void GetMapChunkSize(LocalMapRecord* map, uint32_t startX, uint32_t startY, uint32_t &sizeX, uint32_t &sizeY);
+
+        // retrieves image record; returns nullptr if not found
+        LocalImageRecord* GetImage(uint32_t id);
+
+        // retrieves item record; returns nullptr if not found
+        LocalItemRecord* GetItem(uint32_t id);
+        // retrieves all items
+        std::map<uint32_t, LocalItemRecord> const& GetItems();
+
+        // retrieves content epoch - checksum of all served content, so the client knows when to verify its cache again
+        uint32_t GetContentEpoch();
+
+    protected:
+        // loads maps listed in index file
+        bool LoadMaps(const std::string &directory);
+        // loads images listed in index file
+        bool LoadImages(const std::string &directory);
+        // loads items listed in index file
+        bool LoadItems(const std::string &directory);
+
+        // calculates checksum of map metadata
+        static std::string CalculateMapChecksum(MapHeader &header);
+        // calculates checksum of image metadata
+        static std::string CalculateImageMetadataChecksum(LocalImageRecord &image);
+
+    private:
+        // served maps
+        std::map<uint32_t, LocalMapRecord> m_maps;
+        // ID of map listed first
+        uint32_t m_defaultMapId;
+        // served images
+        std::map<uint32_t, LocalImageRecord> m_images;
+        // served items
+        std::map<uint32_t, LocalItemRecord> m_items;
+        // checksum of all served content
+        uint32_t m_contentEpoch;
+};
+
+#endif
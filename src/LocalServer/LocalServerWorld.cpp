@@ -0,0 +1,234 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "LocalServerWorld.h"
+#include "ObjectEnums.h"
+#include "UpdateFields.h"
+#include "CompactObjectUpdate.h"
+#include "Log.h"
+
+#include <cmath>
+
+// how many times to try to find walkable field for generated object
+#define LOCAL_WORLD_PLACEMENT_ATTEMPTS  16
+
+// movement masks synthetic objects pick from
+static const uint8_t localWorldMoveMasks[] = {
+    MOVE_UP, MOVE_RIGHT, MOVE_DOWN, MOVE_LEFT,
+    MOVE_UP | MOVE_RIGHT, MOVE_RIGHT | MOVE_DOWN, MOVE_DOWN | MOVE_LEFT, MOVE_LEFT | MOVE_UP
+};
+
+LocalServerWorld::LocalServerWorld() : m_random(0)
+{
+    m_content = nullptr;
+    m_lastUpdate = 0;
+}
+
+LocalServerWorld::~LocalServerWorld()
+{
+    //
+}
+
+void LocalServerWorld::Generate(LocalServerContent* content, uint32_t density, uint32_t movingPercent, uint32_t imageId)
+{
+    m_content = content;
+    m_objects.clear();
+    m_objectsByGuid.clear();
+
+    uint32_t now = getMSTime();
+    m_lastUpdate = now;
+
+    uint32_t nextGuid = 1;
+    LocalWorldObject obj;
+
+    std::map<uint32_t, LocalMapRecord> &maps = content->GetMaps();
+    for (std::map<uint32_t, LocalMapRecord>::iterator itr = maps.begin(); itr != maps.end(); ++itr)
+    {
+        LocalMapRecord &map = itr->second;
+        if (map.header.sizeX == 0 || map.header.sizeY == 0)
+            continue;
+
+        uint32_t chunksX = (map.header.sizeX + MAP_CHUNK_SIZE_X - 1) / MAP_CHUNK_SIZE_X;
+        uint32_t chunksY = (map.header.sizeY + MAP_CHUNK_SIZE_Y - 1) / MAP_CHUNK_SIZE_Y;
+        uint32_t count = density * chunksX * chunksY;
+
+        std::vector<LocalWorldObject> &objects = m_objects[itr->first];
+        // reserve at once, so the pointers stored in GUID index stay valid
+        objects.reserve(count);
+
+        std::uniform_int_distribution<uint32_t> posX(0, map.header.sizeX - 1);
+        std::uniform_int_distribution<uint32_t> posY(0, map.header.sizeY - 1);
+        std::uniform_int_distribution<uint32_t> percent(0, 99);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t x = 0, y = 0;
+
+            // prefer fields units can walk on
+            for (uint32_t attempt = 0; attempt < LOCAL_WORLD_PLACEMENT_ATTEMPTS; attempt++)
+            {
+                x = posX(m_random);
+                y = posY(m_random);
+                if (map.fields[(size_t)x * map.header.sizeY + y].type == MFT_GROUND)
+                    break;
+            }
+
+            obj.guid = MAKE_GUID64(HIGHGUID_CREATURE, 0, nextGuid++);
+            obj.mapId = itr->first;
+            obj.imageId = imageId;
+            // stand in the middle of field
+            obj.x = (float)x + 0.5f;
+            obj.y = (float)y + 0.5f;
+            obj.moveMask = 0;
+            obj.moving = (percent(m_random) < movingPercent);
+            obj.nextMoveChange = 0;
+
+            if (obj.moving)
+                PickMovement(&obj, now);
+
+            objects.push_back(obj);
+            m_objectsByGuid[obj.guid] = &objects.back();
+        }
+    }
+
+    sLog->Info("Local server: generated %u synthetic objects", (uint32_t)m_objectsByGuid.size());
+}
+
+void LocalServerWorld::PickMovement(LocalWorldObject* obj, uint32_t now)
+{
+    std::uniform_int_distribution<uint32_t> direction(0, sizeof(localWorldMoveMasks) / sizeof(uint8_t) + 3);
+    std::uniform_int_distribution<uint32_t> duration(LOCAL_WORLD_MOVE_MIN_DURATION, LOCAL_WORLD_MOVE_MAX_DURATION);
+
+    // the values beyond mask count mean standing for a while
+    uint32_t dir = direction(m_random);
+    obj->moveMask = (dir < sizeof(localWorldMoveMasks) / sizeof(uint8_t)) ? localWorldMoveMasks[dir] : 0;
+    obj->nextMoveChange = now + duration(m_random);
+}
+
+void LocalServerWorld::GetMovementVector(uint8_t moveMask, float &dx, float &dy)
+{
+    dx = (float)(((moveMask & MOVE_RIGHT) ? 1 : 0) - ((moveMask & MOVE_LEFT) ? 1 : 0));
+    dy = (float)(((moveMask & MOVE_DOWN) ? 1 : 0) - ((moveMask & MOVE_UP) ? 1 : 0));
+
+    // diagonal movement is not faster than straight one
+    float len = sqrt(dx * dx + dy * dy);
+    if (len > 0.0f)
+    {
+        dx = dx / len * LOCAL_WORLD_MOVEMENT_SPEED / 1000.0f;
+        dy = dy / len * LOCAL_WORLD_MOVEMENT_SPEED / 1000.0f;
+    }
+}
+
+void LocalServerWorld::Update(uint32_t now, std::vector<LocalWorldObject*> &changed)
+{
+    uint32_t diff = getMSTimeDiff(m_lastUpdate, now);
+    m_lastUpdate = now;
+
+    float dx, dy, nx, ny;
+
+    for (std::map<uint32_t, std::vector<LocalWorldObject> >::iterator itr = m_objects.begin(); itr != m_objects.end(); ++itr)
+    {
+        LocalMapRecord* map = m_content->GetMap(itr->first);
+
+        for (size_t i = 0; i < itr->second.size(); i++)
+        {
+            LocalWorldObject* obj = &itr->second[i];
+            if (!obj->moving)
+                continue;
+
+            if (obj->moveMask != 0)
+            {
+                GetMovementVector(obj->moveMask, dx, dy);
+                nx = obj->x + dx * (float)diff;
+                ny = obj->y + dy * (float)diff;
+
+                // stop on map edge or in front of field units cannot walk on
+                if (nx < 0.0f || ny < 0.0f || nx >= (float)map->header.sizeX || ny >= (float)map->header.sizeY
+                    || map->fields[(size_t)nx * map->header.sizeY + (size_t)ny].type != MFT_GROUND)
+                {
+                    obj->moveMask = 0;
+                    changed.push_back(obj);
+                    continue;
+                }
+
+                obj->x = nx;
+                obj->y = ny;
+            }
+
+            if (now >= obj->nextMoveChange)
+            {
+                PickMovement(obj, now);
+                changed.push_back(obj);
+            }
+        }
+    }
+}
+
+LocalWorldObject* LocalServerWorld::GetObject(uint64_t guid)
+{
+    std::unordered_map<uint64_t, LocalWorldObject*>::iterator itr = m_objectsByGuid.find(guid);
+    if (itr == m_objectsByGuid.end())
+        return nullptr;
+
+    return itr->second;
+}
+
+void LocalServerWorld::GetObjectsInArea(uint32_t mapId, float minX, float minY, float maxX, float maxY, std::vector<LocalWorldObject*> &objects)
+{
+    std::map<uint32_t, std::vector<LocalWorldObject> >::iterator itr = m_objects.find(mapId);
+    if (itr == m_objects.end())
+        return;
+
+    for (size_t i = 0; i < itr->second.size(); i++)
+    {
+        LocalWorldObject* obj = &itr->second[i];
+        if (obj->x >= minX && obj->x < maxX && obj->y >= minY && obj->y < maxY)
+            objects.push_back(obj);
+    }
+}
+
+uint32_t LocalServerWorld::GetObjectCount()
+{
+    return (uint32_t)m_objectsByGuid.size();
+}
+
+void LocalServerWorld::WriteUnitFields(SmartPacket &pkt, uint64_t guid, uint32_t imageId, uint32_t level, uint32_t faction, uint32_t health, bool compact)
+{
+    uint32_t fields[UNIT_FIELDS_END];
+    float speed = LOCAL_WORLD_MOVEMENT_SPEED;
+
+    memset(fields, 0, sizeof(fields));
+    fields[OBJECT_FIELD_GUID] = (uint32_t)(guid & 0xFFFFFFFF);
+    fields[OBJECT_FIELD_GUID + 1] = (uint32_t)(guid >> 32LL);
+    fields[OBJECT_FIELD_IMAGEID] = imageId;
+    fields[UNIT_FIELD_LEVEL] = level;
+    fields[UNIT_FIELD_MOVEMENT_SPEED] = *((uint32_t*)&speed);
+    fields[UNIT_FIELD_FACTION] = faction;
+    fields[UNIT_FIELD_HEALTH] = health;
+
+    if (compact)
+    {
+        CompactObjectUpdate::WriteFields(pkt, fields, nullptr, UNIT_FIELDS_END);
+        return;
+    }
+
+    pkt.WriteUInt32(UNIT_FIELDS_END);
+    pkt.WriteArray<uint32_t>(fields, UNIT_FIELDS_END);
+}
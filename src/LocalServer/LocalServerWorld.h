@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_LOCALSERVERWORLD_H
+#define BW_LOCALSERVERWORLD_H
+
+#include "LocalServerContent.h"
+#include "SmartPacket.h"
+
+#include <random>
+
+// movement speed of synthetic objects and players (fields per second)
+#define LOCAL_WORLD_MOVEMENT_SPEED      3.0f
+// shortest time of moving in one direction, or standing (ms)
+#define LOCAL_WORLD_MOVE_MIN_DURATION   1000
+// longest time of moving in one direction, or standing (ms)
+#define LOCAL_WORLD_MOVE_MAX_DURATION   5000
+// faction of synthetic objects
+#define LOCAL_WORLD_OBJECT_FACTION      1
+// level of synthetic objects
+#define LOCAL_WORLD_OBJECT_LEVEL        1
+// health of synthetic objects
+#define LOCAL_WORLD_OBJECT_HEALTH       100
+
+/*
+ * Structure of synthetic world object simulated by local server
+ */
+struct LocalWorldObject
+{
+    // object GUID
+    uint64_t guid;
+    // map the object is on
+    uint32_t mapId;
+    // image the object is displayed with
+    uint32_t imageId;
+    // position
+    float x;
+    float y;
+    // current movement mask
+    uint8_t moveMask;
+    // does the object move at all?
+    bool moving;
+    // time of next movement change (mstime)
+    uint32_t nextMoveChange;
+};
+
+/*
+ * Class simulating synthetic world objects of local server - generates them with configured density and lets
+ * some of them wander around
+ */
+class LocalServerWorld
+{
+    public:
+        LocalServerWorld();
+        ~LocalServerWorld();
+
+        // generates objects on every map; density is count of objects per map chunk, movingPercent is percentage of moving ones
+        void Generate(LocalServerContent* content, uint32_t density, uint32_t movingPercent, uint32_t imageId);
+        // moves objects; objects with changed movement are put into supplied vector
+        void Update(uint32_t now, std::vector<LocalWorldObject*> &changed);
+
+        // retrieves object by GUID; returns nullptr if not found
+        LocalWorldObject* GetObject(uint64_t guid);
+        // retrieves objects on map within supplied field range
+        void GetObjectsInArea(uint32_t mapId, float minX, float minY, float maxX, float maxY, std::vector<LocalWorldObject*> &objects);
+        // retrieves total count of objects
+        uint32_t GetObjectCount();
+
+        // writes updatefields of unit with supplied properties into packet (field count followed by fields, or compact
+        // field set)
+        static void WriteUnitFields(SmartPacket &pkt, uint64_t guid, uint32_t imageId, uint32_t level, uint32_t faction, uint32_t health, bool compact);
+        // retrieves movement vector for supplied mask (fields per millisecond)
+        static void GetMovementVector(uint8_t moveMask, float &dx, float &dy);
+
+    protected:
+        // picks next movement of object
+        void PickMovement(LocalWorldObject* obj, uint32_t now);
+
+    private:
+        // content the objects are generated for
+        LocalServerContent* m_content;
+        // objects, grouped by map ID
+        std::map<uint32_t, std::vector<LocalWorldObject> > m_objects;
+        // objects indexed by GUID
+        std::unordered_map<uint64_t, LocalWorldObject*> m_objectsByGuid;
+        // time of last update (mstime)
+        uint32_t m_lastUpdate;
+        // random generator, seeded constantly, so every run looks the same
+        std::mt19937 m_random;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "ClockSync.h"
+
+ClockSync::ClockSync()
+{
+    m_pingInterval = 5000;
+    Reset();
+}
+
+void ClockSync::Reset()
+{
+    m_lastPingTime = 0;
+    m_pingsSent = 0;
+    m_sampleCount = 0;
+    m_smoothedRtt = 0.0f;
+    m_rttVariation = 0.0f;
+    m_minRtt = 0;
+    m_clockOffset = 0;
+
+    memset(m_windowRtt, 0, sizeof(m_windowRtt));
+    memset(m_windowOffset, 0, sizeof(m_windowOffset));
+}
+
+void ClockSync::SetPingInterval(uint32_t interval)
+{
+    m_pingInterval = interval;
+}
+
+bool ClockSync::IsPingDue(uint32_t now)
+{
+    if (m_pingInterval == 0)
+        return false;
+
+    if (m_pingsSent == 0)
+        return true;
+
+    return getMSTimeDiff(m_lastPingTime, now) >= (m_pingsSent < CLOCK_SYNC_FAST_PINGS ? CLOCK_SYNC_FAST_INTERVAL : m_pingInterval);
+}
+
+void ClockSync::OnPingSent(uint32_t now)
+{
+    m_lastPingTime = now;
+    m_pingsSent++;
+}
+
+int32_t ClockSync::AddSample(uint32_t clientSendTime, uint32_t serverTime, uint32_t clientReceiveTime)
+{
+    uint32_t rtt = clientReceiveTime - clientSendTime;
+
+    // pong of ping we did not send in this session (echoed time later than our last ping, or earlier than connecting)
+    if (m_pingsSent == 0 || (int32_t)(m_lastPingTime - clientSendTime) < 0 || (int32_t)rtt < 0)
+        return -1;
+
+    // the server stamped the pong somewhere between sending and receiving; the middle is the best guess
+    int32_t offset = (int32_t)(serverTime - (clientSendTime + rtt / 2));
+
+    if (m_sampleCount == 0)
+    {
+        m_smoothedRtt = (float)rtt;
+        m_rttVariation = (float)rtt / 2.0f;
+        m_minRtt = rtt;
+    }
+    else
+    {
+        m_rttVariation = 0.75f * m_rttVariation + 0.25f * fabs(m_smoothedRtt - (float)rtt);
+        m_smoothedRtt = 0.875f * m_smoothedRtt + 0.125f * (float)rtt;
+        if (rtt < m_minRtt)
+            m_minRtt = rtt;
+    }
+
+    uint32_t slot = m_sampleCount % CLOCK_SYNC_WINDOW;
+    m_windowRtt[slot] = rtt;
+    m_windowOffset[slot] = offset;
+    m_sampleCount++;
+
+    // sample delayed the least on its way tells the offset the most precisely
+    uint32_t count = num_min(m_sampleCount, (uint32_t)CLOCK_SYNC_WINDOW);
+    uint32_t best = 0;
+    for (uint32_t i = 1; i < count; i++)
+    {
+        if (m_windowRtt[i] < m_windowRtt[best])
+            best = i;
+    }
+    m_clockOffset = m_windowOffset[best];
+
+    return (int32_t)rtt;
+}
+
+bool ClockSync::IsSynchronized()
+{
+    return (m_sampleCount > 0);
+}
+
+uint32_t ClockSync::GetRTT()
+{
+    return (uint32_t)(m_smoothedRtt + 0.5f);
+}
+
+uint32_t ClockSync::GetJitter()
+{
+    return (uint32_t)(m_rttVariation + 0.5f);
+}
+
+uint32_t ClockSync::GetMinRTT()
+{
+    return m_minRtt;
+}
+
+int32_t ClockSync::GetClockOffset()
+{
+    return m_clockOffset;
+}
+
+uint32_t ClockSync::ServerToLocalTime(uint32_t serverTime)
+{
+    // mstime wraps around, so does the conversion
+    return serverTime - (uint32_t)m_clockOffset;
+}
+
+uint32_t ClockSync::LocalToServerTime(uint32_t localTime)
+{
+    return localTime + (uint32_t)m_clockOffset;
+}
+
+uint32_t ClockSync::GetServerTime()
+{
+    return LocalToServerTime(getMSTime());
+}
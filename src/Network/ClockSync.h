@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_CLOCKSYNC_H
+#define BW_CLOCKSYNC_H
+
+#include <cstdint>
+
+// count of recent samples the clock offset is chosen from
+#define CLOCK_SYNC_WINDOW               8
+// count of pings sent in short interval after connecting, so the estimate converges quickly
+#define CLOCK_SYNC_FAST_PINGS           4
+// interval of pings sent right after connecting (ms)
+#define CLOCK_SYNC_FAST_INTERVAL        250
+
+/*
+ * Class estimating round-trip time and server clock offset from ping/pong exchanges; smoothed RTT and jitter
+ * (mean deviation) are computed the same way as TCP retransmission timer does, the clock offset is taken from
+ * the sample with the lowest RTT within recent window, as its error (at most half of RTT) is the lowest
+ */
+class ClockSync
+{
+    public:
+        ClockSync();
+
+        // forgets all samples, so the estimate starts over
+        void Reset();
+        // sets interval between pings after the initial ones (ms)
+        void SetPingInterval(uint32_t interval);
+
+        // is it time to send another ping?
+        bool IsPingDue(uint32_t now);
+        // marks ping sent at supplied time
+        void OnPingSent(uint32_t now);
+        // processes pong - local time the ping was sent, server time the pong was sent and local time it arrived;
+        // returns round-trip time of this sample, or -1 if the sample was rejected
+        int32_t AddSample(uint32_t clientSendTime, uint32_t serverTime, uint32_t clientReceiveTime);
+
+        // was at least one sample processed?
+        bool IsSynchronized();
+        // retrieves smoothed round-trip time (ms)
+        uint32_t GetRTT();
+        // retrieves round-trip time jitter (ms)
+        uint32_t GetJitter();
+        // retrieves the lowest round-trip time seen (ms)
+        uint32_t GetMinRTT();
+        // retrieves difference of server clock and local clock (ms)
+        int32_t GetClockOffset();
+
+        // converts server timestamp to local mstime
+        uint32_t ServerToLocalTime(uint32_t serverTime);
+        // converts local mstime to server timestamp
+        uint32_t LocalToServerTime(uint32_t localTime);
+        // retrieves current server time estimate
+        uint32_t GetServerTime();
+
+    private:
+        // interval between pings (ms)
+        uint32_t m_pingInterval;
+        // time of last ping sent
+        uint32_t m_lastPingTime;
+        // count of pings sent since reset
+        uint32_t m_pingsSent;
+
+        // count of processed samples
+        uint32_t m_sampleCount;
+        // smoothed round-trip time (ms)
+        float m_smoothedRtt;
+        // round-trip time mean deviation (ms)
+        float m_rttVariation;
+        // the lowest round-trip time seen (ms)
+        uint32_t m_minRtt;
+        // current clock offset estimate (ms)
+        int32_t m_clockOffset;
+
+        // round-trip times of recent samples
+        uint32_t m_windowRtt[CLOCK_SYNC_WINDOW];
+        // clock offsets of recent samples
+        int32_t m_windowOffset[CLOCK_SYNC_WINDOW];
+};
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "CompactObjectUpdate.h"
+#include "WorldObject.h"
+
+// zigzag encoding maps small negative differences to small unsigned numbers (0, -1, 1, -2, .. to 0, 1, 2, 3, ..)
+static uint32_t _zigzagEncode(uint32_t diff)
+{
+    return (diff << 1) ^ (uint32_t)((int32_t)diff >> 31);
+}
+
+static uint32_t _zigzagDecode(uint32_t value)
+{
+    return (value >> 1) ^ (uint32_t)(-(int32_t)(value & 1));
+}
+
+void CompactObjectUpdate::WriteFields(SmartPacket &packet, const uint32_t* fields, const uint32_t* base, uint32_t count)
+{
+    uint8_t mask[COMPACT_UPDATE_MAX_FIELDS / 8];
+    uint32_t i, last = 0;
+
+    if (count > COMPACT_UPDATE_MAX_FIELDS)
+        count = COMPACT_UPDATE_MAX_FIELDS;
+
+    memset(mask, 0, sizeof(mask));
+
+    // mark fields to be sent; the count is cut right behind the last one, so the mask is as short as possible
+    for (i = 0; i < count; i++)
+    {
+        if (fields[i] != (base ? base[i] : 0))
+        {
+            mask[i / 8] |= 1 << (i % 8);
+            last = i + 1;
+        }
+    }
+
+    packet.WriteVarUInt32(last);
+    packet.WriteBytes(mask, (last + 7) / 8);
+
+    for (i = 0; i < last; i++)
+    {
+        if (mask[i / 8] & (1 << (i % 8)))
+            packet.WriteVarUInt32(base ? _zigzagEncode(fields[i] - base[i]) : fields[i]);
+    }
+}
+
+bool CompactObjectUpdate::ReadFields(SmartPacket &packet, WorldObject* obj, bool delta)
+{
+    uint8_t mask[COMPACT_UPDATE_MAX_FIELDS / 8];
+    uint32_t count, value, i;
+
+    if (!packet.ReadVarUInt32(count) || count > COMPACT_UPDATE_MAX_FIELDS || !packet.ReadBytes(mask, (count + 7) / 8))
+        return false;
+
+    uint32_t objFieldCount = obj ? obj->GetUpdateFieldCount() : 0;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((mask[i / 8] & (1 << (i % 8))) == 0)
+        {
+            // absolute set describes the whole object, missing field means zero
+            if (!delta && i < objFieldCount)
+                obj->SetUInt32Value(i, 0);
+            continue;
+        }
+
+        if (!packet.ReadVarUInt32(value))
+            return false;
+
+        // fields unknown to this client version are skipped
+        if (i >= objFieldCount)
+            continue;
+
+        obj->SetUInt32Value(i, delta ? obj->GetUInt32Value(i) + _zigzagDecode(value) : value);
+    }
+
+    // fields behind the last sent one
+    if (!delta)
+    {
+        for (i = count; i < objFieldCount; i++)
+            obj->SetUInt32Value(i, 0);
+    }
+
+    return true;
+}
+
+void CompactObjectUpdate::WritePosition(SmartPacket &packet, float x, float y)
+{
+    // positions are never negative on map, rounded to the nearest step
+    packet.WriteVarUInt32(x > 0.0f ? (uint32_t)(x * COMPACT_POSITION_SCALE + 0.5f) : 0);
+    packet.WriteVarUInt32(y > 0.0f ? (uint32_t)(y * COMPACT_POSITION_SCALE + 0.5f) : 0);
+}
+
+bool CompactObjectUpdate::ReadPosition(SmartPacket &packet, float &x, float &y)
+{
+    uint32_t px, py;
+
+    if (!packet.ReadVarUInt32(px) || !packet.ReadVarUInt32(py))
+        return false;
+
+    x = (float)px / COMPACT_POSITION_SCALE;
+    y = (float)py / COMPACT_POSITION_SCALE;
+
+    return true;
+}
@@ -0,0 +1,53 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_COMPACTOBJECTUPDATE_H
+#define BW_COMPACTOBJECTUPDATE_H
+
+#include "SmartPacket.h"
+
+class WorldObject;
+
+// count of fixed-point steps per one map field in packed positions
+#define COMPACT_POSITION_SCALE 256.0f
+// the highest count of updatefields accepted in one compact field set
+#define COMPACT_UPDATE_MAX_FIELDS 1024
+
+/*
+ * Compact encoding of updatefield sets used by SP_CREATE_OBJECT_COMPACT and SP_UPDATE_OBJECT_COMPACT; field set
+ * consists of varint field count, bitmask of present fields (one bit per field, rounded up to whole bytes) and
+ * varint value of every present field - absolute value in create packets, zigzag encoded difference from value
+ * known to client in update packets
+ */
+namespace CompactObjectUpdate
+{
+    // writes field set; with base values, writes zigzag differences of changed fields, otherwise absolute values of
+    // non-zero fields
+    void WriteFields(SmartPacket &packet, const uint32_t* fields, const uint32_t* base, uint32_t count);
+    // reads field set and applies it straight to object updatefields (marking changed ones dirty); absolute set
+    // resets fields missing in mask to zero; with no object, the set is just skipped
+    bool ReadFields(SmartPacket &packet, WorldObject* obj, bool delta);
+
+    // writes position packed to fixed-point varints
+    void WritePosition(SmartPacket &packet, float x, float y);
+    // reads position packed by WritePosition
+    bool ReadPosition(SmartPacket &packet, float &x, float &y);
+};
+
+#endif
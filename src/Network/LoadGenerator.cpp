@@ -0,0 +1,361 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "LoadGenerator.h"
+#include "NetworkManager.h"
+#include "CompactObjectUpdate.h"
+#include "Application.h"
+#include "Gameplay.h"
+#include "Map.h"
+#include "Player.h"
+#include "WorldObject.h"
+#include "ObjectEnums.h"
+#include "UpdateFields.h"
+#include "MapEnums.h"
+#include "Log.h"
+
+#include <algorithm>
+
+// names of traffic kinds used in report
+static const char* LoadGeneratorTrafficNames[MAX_LOADGEN_TRAFFIC] = {
+    "names",
+    "creates",
+    "heartbeats",
+    "chat",
+    "destroys"
+};
+
+LoadGenerator::LoadGenerator() : m_random(12345)
+{
+    m_objectCount = 0;
+    m_heartbeatRate = 0;
+    m_chatRate = 0;
+    m_duration = 0;
+    m_imageId = 0;
+
+    m_state = LOADGEN_STATE_WAITING;
+    m_startTime = 0;
+    m_lastFrameTime = 0;
+    m_heartbeatsDue = 0.0;
+    m_chatDue = 0.0;
+    m_nextHeartbeat = 0;
+    m_chatCounter = 0;
+    m_spawnFrameTime = 0;
+    m_spawnMapObjects = 0;
+    memset(m_counters, 0, sizeof(m_counters));
+}
+
+void LoadGenerator::Configure(uint32_t objectCount, uint32_t heartbeatRate, uint32_t chatRate, uint32_t duration, uint32_t imageId)
+{
+    m_objectCount = objectCount;
+    m_heartbeatRate = heartbeatRate;
+    m_chatRate = chatRate;
+    m_duration = duration;
+    m_imageId = imageId;
+}
+
+void LoadGenerator::SetPacketCallback(std::function<void(SmartPacket&)> callback)
+{
+    m_packetCallback = callback;
+}
+
+bool LoadGenerator::IsEnabled()
+{
+    return (m_objectCount > 0 || m_chatRate > 0) && m_packetCallback;
+}
+
+void LoadGenerator::Update()
+{
+    if (!IsEnabled() || m_state == LOADGEN_STATE_FINISHED)
+        return;
+
+    bool inWorld = sNetwork->GetConnectionState() == CONNECTION_STATE_INGAME && sApplication->GetStageType() == STAGE_GAME
+        && sGameplay->GetPlayer() && sGameplay->GetMap();
+
+    uint32_t now = getMSTime();
+
+    if (m_state == LOADGEN_STATE_WAITING)
+    {
+        if (inWorld)
+            Start(now);
+        return;
+    }
+
+    // the world went away before we were done (disconnect, leaving to character list, ..)
+    if (!inWorld)
+    {
+        Finish(now, true);
+        return;
+    }
+
+    // measure the previous frame; the first one contains creation of all objects and their adding to map
+    uint64_t frameTime = getUSTime();
+    uint32_t frameDuration = (uint32_t)num_min(frameTime - m_lastFrameTime, (uint64_t)UINT32_MAX);
+    m_lastFrameTime = frameTime;
+
+    if (m_spawnFrameTime == 0)
+    {
+        m_spawnFrameTime = frameDuration;
+        m_spawnMapObjects = (uint32_t)sGameplay->GetMap()->GetObjectGuidMap().size();
+    }
+    else
+        m_frameTimes.push_back(frameDuration);
+
+    if (getMSTimeDiff(m_startTime, now) >= m_duration)
+    {
+        Finish(now, false);
+        return;
+    }
+
+    double frameSeconds = (double)frameDuration / 1000000.0;
+
+    if (m_heartbeatRate > 0 && !m_guids.empty())
+    {
+        m_heartbeatsDue += m_heartbeatRate * frameSeconds;
+        uint32_t count = (uint32_t)m_heartbeatsDue;
+        m_heartbeatsDue -= count;
+        GenerateHeartbeats(count);
+    }
+
+    if (m_chatRate > 0)
+    {
+        m_chatDue += m_chatRate * frameSeconds;
+        uint32_t count = (uint32_t)m_chatDue;
+        m_chatDue -= count;
+        GenerateChat(count);
+    }
+}
+
+void LoadGenerator::Start(uint32_t now)
+{
+    sLog->Info("Load generator: creating %u objects, %u heartbeats/s, %u chat messages/s for %u ms", m_objectCount, m_heartbeatRate, m_chatRate, m_duration);
+
+    m_state = LOADGEN_STATE_RUNNING;
+    m_startTime = now;
+    m_lastFrameTime = getUSTime();
+    m_heartbeatsDue = 0.0;
+    m_chatDue = 0.0;
+    m_nextHeartbeat = 0;
+    m_chatCounter = 0;
+    m_spawnFrameTime = 0;
+    m_spawnMapObjects = 0;
+    m_frameTimes.clear();
+    m_frameTimes.reserve(1024);
+    memset(m_counters, 0, sizeof(m_counters));
+
+    GenerateObjects();
+}
+
+void LoadGenerator::Finish(uint32_t now, bool interrupted)
+{
+    // objects are gone along with the map, when the world was left
+    if (!interrupted)
+        DestroyObjects();
+
+    WriteReport(now, interrupted);
+
+    m_guids.clear();
+    m_state = LOADGEN_STATE_FINISHED;
+}
+
+void LoadGenerator::Feed(SmartPacket &pkt, LoadGeneratorTraffic traffic, uint32_t items)
+{
+    LoadGeneratorCounters &counters = m_counters[traffic];
+
+    uint64_t handlerStart = getUSTime();
+    m_packetCallback(pkt);
+    uint32_t handlerTime = (uint32_t)num_min(getUSTime() - handlerStart, (uint64_t)UINT32_MAX);
+
+    counters.packets++;
+    counters.items += items;
+    counters.handlerTimeTotal += handlerTime;
+    if (handlerTime > counters.handlerTimeMax)
+        counters.handlerTimeMax = handlerTime;
+}
+
+void LoadGenerator::GenerateObjects()
+{
+    uint32_t i, j, count;
+    uint32_t fields[UNIT_FIELDS_END];
+    float speed = LOADGEN_MOVEMENT_SPEED;
+    bool compact = (sNetwork->GetProtocolCapabilities() & PROTOCOL_CAP_COMPACT_OBJECT_UPDATES) != 0;
+
+    Player* plr = sGameplay->GetPlayer();
+    float centerX = plr->GetPositionX();
+    float centerY = plr->GetPositionY();
+    std::uniform_real_distribution<float> offset(-LOADGEN_SPREAD / 2.0f, LOADGEN_SPREAD / 2.0f);
+    std::uniform_int_distribution<uint32_t> moveMask(0, MOVE_UP | MOVE_RIGHT | MOVE_DOWN | MOVE_LEFT);
+
+    m_guids.resize(m_objectCount);
+    for (i = 0; i < m_objectCount; i++)
+        m_guids[i] = MAKE_GUID64(HIGHGUID_CREATURE, LOADGEN_OBJECT_ENTRY, (i + 1));
+
+    // names go first, so adding objects to map does not trigger name queries
+    for (i = 0; i < m_objectCount; i++)
+    {
+        SmartPacket name(SP_NAME_QUERY_RESPONSE);
+        name.WriteUInt64(m_guids[i]);
+        name.WriteString((std::string("Load generator ") + std::to_string(i + 1)).c_str());
+        Feed(name, LOADGEN_TRAFFIC_NAME, 1);
+    }
+
+    memset(fields, 0, sizeof(fields));
+    fields[OBJECT_FIELD_IMAGEID] = m_imageId;
+    fields[UNIT_FIELD_LEVEL] = 1;
+    fields[UNIT_FIELD_MOVEMENT_SPEED] = *((uint32_t*)&speed);
+    fields[UNIT_FIELD_HEALTH] = 100;
+
+    // split creates the same way server does
+    for (i = 0; i < m_objectCount; i += UPDATEPACKET_COUNT_LIMIT)
+    {
+        count = num_min(m_objectCount - i, (uint32_t)UPDATEPACKET_COUNT_LIMIT);
+
+        SmartPacket create(compact ? SP_CREATE_OBJECT_COMPACT : SP_CREATE_OBJECT);
+        create.WriteUInt8((uint8_t)count);
+        for (j = 0; j < count; j++)
+        {
+            uint64_t guid = m_guids[i + j];
+            float x = std::max(centerX + offset(m_random), 0.0f);
+            float y = std::max(centerY + offset(m_random), 0.0f);
+            uint8_t mask = (uint8_t)moveMask(m_random);
+
+            fields[OBJECT_FIELD_GUID] = (uint32_t)(guid & 0xFFFFFFFF);
+            fields[OBJECT_FIELD_GUID + 1] = (uint32_t)(guid >> 32LL);
+
+            create.WriteUInt64(guid);
+            if (compact)
+            {
+                create.WriteUInt8(mask);
+                CompactObjectUpdate::WritePosition(create, x, y);
+                CompactObjectUpdate::WriteFields(create, fields, nullptr, UNIT_FIELDS_END);
+            }
+            else
+            {
+                create.WriteUInt32(UNIT_FIELDS_END);
+                create.WriteArray<uint32_t>(fields, UNIT_FIELDS_END);
+                create.WriteFloat(x);
+                create.WriteFloat(y);
+                create.WriteUInt8(mask);
+            }
+        }
+        Feed(create, LOADGEN_TRAFFIC_CREATE, count);
+    }
+}
+
+void LoadGenerator::GenerateHeartbeats(uint32_t count)
+{
+    std::uniform_int_distribution<uint32_t> moveMask(0, MOVE_UP | MOVE_RIGHT | MOVE_DOWN | MOVE_LEFT);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t guid = m_guids[m_nextHeartbeat];
+        m_nextHeartbeat = (m_nextHeartbeat + 1) % (uint32_t)m_guids.size();
+
+        // continue from where the client moved the object, just like server would
+        WorldObject* obj = sGameplay->GetForeignObject(guid);
+        if (!obj)
+            continue;
+
+        SmartPacket move(SP_MOVE_HEARTBEAT);
+        move.WriteUInt64(guid);
+        move.WriteUInt8((uint8_t)moveMask(m_random));
+        move.WriteFloat(std::max(obj->GetPositionX(), 0.0f));
+        move.WriteFloat(std::max(obj->GetPositionY(), 0.0f));
+        Feed(move, LOADGEN_TRAFFIC_HEARTBEAT, 1);
+    }
+}
+
+void LoadGenerator::GenerateChat(uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_chatCounter++;
+
+        SmartPacket chat(SP_CHAT_MESSAGE);
+        if (m_guids.empty())
+        {
+            chat.WriteUInt8(TALK_SERVER_MESSAGE);
+            chat.WriteUInt64(0);
+        }
+        else
+        {
+            chat.WriteUInt8(TALK_SAY);
+            chat.WriteUInt64(m_guids[m_random() % m_guids.size()]);
+        }
+        chat.WriteString((std::string("Load generator message ") + std::to_string(m_chatCounter)).c_str());
+        Feed(chat, LOADGEN_TRAFFIC_CHAT, 1);
+    }
+}
+
+void LoadGenerator::DestroyObjects()
+{
+    uint32_t i, j, count;
+    uint32_t total = (uint32_t)m_guids.size();
+
+    for (i = 0; i < total; i += UPDATEPACKET_COUNT_LIMIT)
+    {
+        count = num_min(total - i, (uint32_t)UPDATEPACKET_COUNT_LIMIT);
+
+        SmartPacket destroy(SP_DESTROY_OBJECT);
+        destroy.WriteUInt8((uint8_t)count);
+        for (j = 0; j < count; j++)
+            destroy.WriteUInt64(m_guids[i + j]);
+        Feed(destroy, LOADGEN_TRAFFIC_DESTROY, count);
+    }
+}
+
+void LoadGenerator::WriteReport(uint32_t now, bool interrupted)
+{
+    uint32_t elapsed = getMSTimeDiff(m_startTime, now);
+
+    sLog->Info("Load generator report (%s after %u ms):", interrupted ? "interrupted" : "finished", elapsed);
+
+    for (uint32_t i = 0; i < MAX_LOADGEN_TRAFFIC; i++)
+    {
+        LoadGeneratorCounters &counters = m_counters[i];
+        if (counters.packets == 0)
+            continue;
+
+        double perItem = (double)counters.handlerTimeTotal / (double)counters.items;
+        double itemsPerSecond = counters.handlerTimeTotal > 0 ? (double)counters.items * 1000000.0 / (double)counters.handlerTimeTotal : 0.0;
+
+        sLog->Info("  %-10s %8llu packets %8llu items, handler %8llu us total, %.2f us/item, max %u us/packet, %.0f items/s",
+            LoadGeneratorTrafficNames[i], (unsigned long long)counters.packets, (unsigned long long)counters.items,
+            (unsigned long long)counters.handlerTimeTotal, perItem, counters.handlerTimeMax, itemsPerSecond);
+    }
+
+    sLog->Info("  spawn frame: %.2f ms with %u objects on map", (double)m_spawnFrameTime / 1000.0, m_spawnMapObjects);
+
+    if (m_frameTimes.empty())
+        return;
+
+    std::vector<uint32_t> sorted(m_frameTimes);
+    std::sort(sorted.begin(), sorted.end());
+
+    uint64_t total = 0;
+    for (uint32_t frameTime : sorted)
+        total += frameTime;
+
+    double mean = (double)total / (double)sorted.size();
+    uint32_t p99 = sorted[std::min(sorted.size() - 1, (sorted.size() * 99) / 100)];
+
+    sLog->Info("  frames: %u, mean %.2f ms (%.1f fps), p99 %.2f ms, max %.2f ms", (uint32_t)sorted.size(), mean / 1000.0,
+        mean > 0.0 ? 1000000.0 / mean : 0.0, (double)p99 / 1000.0, (double)sorted.back() / 1000.0);
+}
@@ -0,0 +1,148 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_LOADGENERATOR_H
+#define BW_LOADGENERATOR_H
+
+#include "SmartPacket.h"
+
+#include <random>
+
+// entry part of GUID of synthetic objects, so they could not collide with objects sent by server
+#define LOADGEN_OBJECT_ENTRY            0x3FFFFFF
+// synthetic objects are spread over square of this size (fields) centered at player
+#define LOADGEN_SPREAD                  48.0f
+// movement speed of synthetic objects (fields per second)
+#define LOADGEN_MOVEMENT_SPEED          3.0f
+
+// state of load generator
+enum LoadGeneratorState
+{
+    LOADGEN_STATE_WAITING = 0,          // waiting for the world to become playable
+    LOADGEN_STATE_RUNNING = 1,          // generating traffic
+    LOADGEN_STATE_FINISHED = 2,         // done, the report was written
+};
+
+// kinds of generated traffic
+enum LoadGeneratorTraffic
+{
+    LOADGEN_TRAFFIC_NAME = 0,           // SP_NAME_QUERY_RESPONSE of synthetic objects
+    LOADGEN_TRAFFIC_CREATE = 1,         // SP_CREATE_OBJECT or SP_CREATE_OBJECT_COMPACT
+    LOADGEN_TRAFFIC_HEARTBEAT = 2,      // SP_MOVE_HEARTBEAT
+    LOADGEN_TRAFFIC_CHAT = 3,           // SP_CHAT_MESSAGE
+    LOADGEN_TRAFFIC_DESTROY = 4,        // SP_DESTROY_OBJECT
+    MAX_LOADGEN_TRAFFIC
+};
+
+/*
+ * Structure containing counters of one kind of generated traffic
+ */
+struct LoadGeneratorCounters
+{
+    // count of generated packets
+    uint64_t packets;
+    // count of objects or messages within packets
+    uint64_t items;
+    // sum of handler times (us)
+    uint64_t handlerTimeTotal;
+    // the longest handler time (us)
+    uint32_t handlerTimeMax;
+};
+
+/*
+ * Class generating synthetic server traffic of configurable scale - crowd of objects, their heartbeats and chat
+ * flood; the packets are handled by the same packet handlers as the received ones, and throughput along with
+ * frame times is reported at the end
+ */
+class LoadGenerator
+{
+    public:
+        LoadGenerator();
+
+        // sets scale of traffic; rates are per second, duration in milliseconds
+        void Configure(uint32_t objectCount, uint32_t heartbeatRate, uint32_t chatRate, uint32_t duration, uint32_t imageId);
+        // sets function, which handles generated packets
+        void SetPacketCallback(std::function<void(SmartPacket&)> callback);
+        // is there any traffic to generate?
+        bool IsEnabled();
+        // generates traffic of one frame; has to be called once per frame from main thread
+        void Update();
+
+    protected:
+        // creates synthetic objects around player and starts measurement
+        void Start(uint32_t now);
+        // destroys synthetic objects and writes report
+        void Finish(uint32_t now, bool interrupted);
+        // hands packet to callback and measures time of its handling
+        void Feed(SmartPacket &pkt, LoadGeneratorTraffic traffic, uint32_t items);
+
+        // sends names and creates of all synthetic objects
+        void GenerateObjects();
+        // sends heartbeats of synthetic objects, every one changes movement
+        void GenerateHeartbeats(uint32_t count);
+        // sends chat messages
+        void GenerateChat(uint32_t count);
+        // sends destroy of all synthetic objects
+        void DestroyObjects();
+        // writes throughput and frame time report to log
+        void WriteReport(uint32_t now, bool interrupted);
+
+    private:
+        // count of synthetic objects
+        uint32_t m_objectCount;
+        // heartbeats per second
+        uint32_t m_heartbeatRate;
+        // chat messages per second
+        uint32_t m_chatRate;
+        // time the traffic is generated for (ms)
+        uint32_t m_duration;
+        // image of synthetic objects
+        uint32_t m_imageId;
+        // function handling generated packets
+        std::function<void(SmartPacket&)> m_packetCallback;
+
+        // current state
+        LoadGeneratorState m_state;
+        // time of start (mstime)
+        uint32_t m_startTime;
+        // time of previous update (us)
+        uint64_t m_lastFrameTime;
+        // heartbeats due, but not yet generated (fractional part carried to next frame)
+        double m_heartbeatsDue;
+        // chat messages due, but not yet generated
+        double m_chatDue;
+        // GUIDs of synthetic objects
+        std::vector<uint64_t> m_guids;
+        // index of object to send the next heartbeat for
+        uint32_t m_nextHeartbeat;
+        // count of generated chat messages
+        uint32_t m_chatCounter;
+        // counters of traffic kinds
+        LoadGeneratorCounters m_counters[MAX_LOADGEN_TRAFFIC];
+        // duration of frame, in which the objects were created (us)
+        uint32_t m_spawnFrameTime;
+        // count of objects on map after creating synthetic ones
+        uint32_t m_spawnMapObjects;
+        // durations of frames after that (us)
+        std::vector<uint32_t> m_frameTimes;
+        // random generator, seeded constantly, so every run looks the same
+        std::mt19937 m_random;
+};
+
+#endif
@@ -0,0 +1,542 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "NetworkEventLoop.h"
+#include "NetworkSession.h"
+#include "Log.h"
+
+NetworkEventLoop::NetworkEventLoop()
+{
+    m_running = false;
+    m_sessionCount = 0;
+#ifndef _WIN32
+    m_epoll = -1;
+#endif
+    m_wakeupRecv = INVALID_SOCKET;
+    m_wakeupSend = INVALID_SOCKET;
+    m_wakeupPending = false;
+    m_listenSocket = INVALID_SOCKET;
+}
+
+NetworkEventLoop::~NetworkEventLoop()
+{
+    //
+}
+
+bool NetworkEventLoop::Init()
+{
+#ifndef _WIN32
+    m_epoll = epoll_create1(0);
+    if (m_epoll < 0)
+    {
+        sLog->Error("epoll_create1(): error %u", LASTERROR());
+        return false;
+    }
+#endif
+
+    if (!InitWakeup())
+    {
+        sLog->Error("Unable to create network event loop wakeup channel");
+        return false;
+    }
+
+#ifndef _WIN32
+    // wakeup channel is the only registration without session
+    epoll_event ev;
+    memset(&ev, 0, sizeof(epoll_event));
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeupRecv, &ev) != 0)
+    {
+        sLog->Error("epoll_ctl(): error %u", LASTERROR());
+        return false;
+    }
+#endif
+
+    m_running = true;
+
+    return true;
+}
+
+bool NetworkEventLoop::SetListenSocket(SOCK sock, AcceptCallback callback)
+{
+    // everything waiting is accepted at once, so the socket must not block when there's nothing left
+    if (!SetNonBlocking(sock))
+        return false;
+
+#ifndef _WIN32
+    // listening socket is told apart from sessions and wakeup channel by pointer to its member
+    epoll_event ev;
+    memset(&ev, 0, sizeof(epoll_event));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &m_listenSocket;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, sock, &ev) != 0)
+    {
+        sLog->Error("epoll_ctl(): error %u", LASTERROR());
+        return false;
+    }
+#endif
+
+    m_listenSocket = sock;
+    m_acceptCallback = callback;
+
+    return true;
+}
+
+void NetworkEventLoop::Close()
+{
+    // close sessions waiting for removal
+    ProcessSessionChanges();
+
+    if (m_wakeupRecv != INVALID_SOCKET)
+        CLOSESOCKET(m_wakeupRecv);
+    if (m_wakeupSend != INVALID_SOCKET)
+        CLOSESOCKET(m_wakeupSend);
+    m_wakeupRecv = INVALID_SOCKET;
+    m_wakeupSend = INVALID_SOCKET;
+
+#ifndef _WIN32
+    if (m_epoll >= 0)
+        close(m_epoll);
+    m_epoll = -1;
+#endif
+}
+
+bool NetworkEventLoop::AddSession(NetworkSession* session)
+{
+    {
+        std::unique_lock<std::mutex> lck(m_changesMtx);
+
+#ifdef _WIN32
+        // select() could not watch more sockets; wakeup channel and listening socket take their places too
+        if (m_sessionCount + 2 >= FD_SETSIZE)
+        {
+            sLog->Error("Unable to add network session, event loop is limited to %u sessions", (uint32_t)FD_SETSIZE - 2);
+            return false;
+        }
+#endif
+
+        m_addedSessions.push_back(session);
+        m_sessionCount++;
+    }
+
+    Wakeup();
+
+    return true;
+}
+
+void NetworkEventLoop::RemoveSession(NetworkSession* session)
+{
+    {
+        std::unique_lock<std::mutex> lck(m_changesMtx);
+        m_removedSessions.push_back(session);
+    }
+
+    Wakeup();
+}
+
+void NetworkEventLoop::MarkDirty(NetworkSession* session)
+{
+    // already waiting for processing
+    if (session->m_dirty.exchange(true))
+        return;
+
+    {
+        std::unique_lock<std::mutex> lck(m_changesMtx);
+        m_dirtySessions.push_back(session);
+    }
+
+    Wakeup();
+}
+
+void NetworkEventLoop::Run()
+{
+    while (m_running)
+        RunOnce(NETWORK_IDLE_TIMEOUT);
+}
+
+void NetworkEventLoop::Stop()
+{
+    m_running = false;
+    Wakeup();
+}
+
+bool NetworkEventLoop::IsRunning()
+{
+    return m_running;
+}
+
+uint32_t NetworkEventLoop::GetSessionCount()
+{
+    return (uint32_t)m_sessions.size();
+}
+
+void NetworkEventLoop::RunOnce(uint32_t timeout)
+{
+    uint32_t now = getMSTime();
+
+    // requests from other threads at first
+    ProcessSessionChanges();
+
+    // sessions resolving hostname or connecting check their progress and timeouts
+    if (!m_timedSessions.empty())
+    {
+        std::vector<NetworkSession*> timed(m_timedSessions.begin(), m_timedSessions.end());
+        for (NetworkSession* session : timed)
+        {
+            session->Update(now);
+            UpdateRegistration(session);
+        }
+
+        timeout = num_min(timeout, (uint32_t)RESOLVE_WAIT_STEP);
+    }
+
+    PollSessions(timeout);
+}
+
+void NetworkEventLoop::ProcessSessionChanges()
+{
+    std::vector<NetworkSession*> added, removed, dirty;
+
+    {
+        std::unique_lock<std::mutex> lck(m_changesMtx);
+        added.swap(m_addedSessions);
+        removed.swap(m_removedSessions);
+        dirty.swap(m_dirtySessions);
+    }
+
+    for (NetworkSession* session : added)
+        m_sessions.insert(session);
+
+    uint32_t now = getMSTime();
+
+    for (NetworkSession* session : dirty)
+    {
+        // the flag is cleared before processing, so nothing requested during processing is lost
+        session->m_dirty = false;
+
+        if (m_sessions.find(session) == m_sessions.end())
+            continue;
+
+        session->Update(now);
+        UpdateRegistration(session);
+    }
+
+    // removed sessions are closed silently, nobody is interested in them anymore
+    uint32_t removedCount = 0;
+    for (NetworkSession* session : removed)
+    {
+        if (m_sessions.erase(session) == 0)
+            continue;
+
+        m_timedSessions.erase(session);
+        session->m_eventCallback = nullptr;
+        session->Close(SESSION_EVENT_DISCONNECTED);
+        removedCount++;
+    }
+
+    if (removedCount > 0)
+    {
+        std::unique_lock<std::mutex> lck(m_changesMtx);
+        m_sessionCount -= removedCount;
+    }
+}
+
+void NetworkEventLoop::UpdateRegistration(NetworkSession* session)
+{
+    // keep the list of sessions needing periodic updates
+    if (session->NeedsTimedUpdate())
+        m_timedSessions.insert(session);
+    else
+        m_timedSessions.erase(session);
+
+    SOCK sock = session->m_socket;
+    uint32_t flags = (sock != INVALID_SOCKET) ? session->GetPollFlags() : 0;
+
+    // socket changed - forget the old one
+    if (session->m_registeredSocket != INVALID_SOCKET && session->m_registeredSocket != sock)
+        RemoveRegistration(session);
+
+    if (sock == INVALID_SOCKET || (session->m_registeredSocket == sock && session->m_registeredFlags == flags))
+        return;
+
+    // epoll reports hangup and errors even with empty event mask, so the socket with nothing to wait for (i.e. paused
+    // receiving) is left out, until the session wants something again
+    if (flags == 0)
+    {
+        RemoveRegistration(session);
+        return;
+    }
+
+#ifndef _WIN32
+    epoll_event ev;
+    memset(&ev, 0, sizeof(epoll_event));
+    ev.events = ((flags & SESSION_POLL_READ) ? (uint32_t)EPOLLIN : 0) | ((flags & SESSION_POLL_WRITE) ? (uint32_t)EPOLLOUT : 0);
+    ev.data.ptr = session;
+
+    if (epoll_ctl(m_epoll, (session->m_registeredSocket == sock) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, sock, &ev) != 0)
+    {
+        sLog->Error("epoll_ctl(): error %u", LASTERROR());
+        return;
+    }
+#endif
+
+    session->m_registeredSocket = sock;
+    session->m_registeredFlags = flags;
+}
+
+void NetworkEventLoop::RemoveRegistration(NetworkSession* session)
+{
+    if (session->m_registeredSocket == INVALID_SOCKET)
+        return;
+
+#ifndef _WIN32
+    // closed sockets are removed from epoll automatically, so the failure does not matter
+    epoll_event ev;
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, session->m_registeredSocket, &ev);
+#endif
+
+    session->m_registeredSocket = INVALID_SOCKET;
+    session->m_registeredFlags = 0;
+}
+
+void NetworkEventLoop::PollSessions(uint32_t timeout)
+{
+#ifdef _WIN32
+    // select() is limited to FD_SETSIZE sockets, AddSession does not allow more sessions
+    fd_set rdset, wrset, exset;
+    timeval tv;
+    SOCK maxfd = m_wakeupRecv;
+
+    FD_ZERO(&rdset);
+    FD_ZERO(&wrset);
+    FD_ZERO(&exset);
+    FD_SET(m_wakeupRecv, &rdset);
+
+    if (m_listenSocket != INVALID_SOCKET)
+    {
+        FD_SET(m_listenSocket, &rdset);
+        maxfd = num_max(maxfd, m_listenSocket);
+    }
+
+    for (NetworkSession* session : m_sessions)
+    {
+        if (session->m_registeredSocket == INVALID_SOCKET)
+            continue;
+
+        if (session->m_registeredFlags & SESSION_POLL_READ)
+            FD_SET(session->m_registeredSocket, &rdset);
+        if (session->m_registeredFlags & SESSION_POLL_WRITE)
+        {
+            FD_SET(session->m_registeredSocket, &wrset);
+            // Windows reports failed connection attempt in exception set
+            FD_SET(session->m_registeredSocket, &exset);
+        }
+
+        maxfd = num_max(maxfd, session->m_registeredSocket);
+    }
+
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    int res = select((int)maxfd + 1, &rdset, &wrset, &exset, &tv);
+    if (res < 0)
+    {
+        sLog->Error("select(): error %u", LASTERROR());
+        return;
+    }
+
+    if (res == 0)
+        return;
+
+    if (FD_ISSET(m_wakeupRecv, &rdset))
+        DrainWakeup();
+
+    if (m_listenSocket != INVALID_SOCKET && FD_ISSET(m_listenSocket, &rdset))
+        AcceptConnections();
+
+    // handlers may change the session set, so work on copy
+    std::vector<NetworkSession*> sessions(m_sessions.begin(), m_sessions.end());
+    for (NetworkSession* session : sessions)
+    {
+        SOCK sock = session->m_registeredSocket;
+        if (sock == INVALID_SOCKET)
+            continue;
+
+        if (FD_ISSET(sock, &wrset) || FD_ISSET(sock, &exset))
+            session->OnWritable();
+        if (session->m_socket == sock && FD_ISSET(sock, &rdset))
+            session->OnReadable();
+
+        UpdateRegistration(session);
+    }
+#else
+    epoll_event events[NETWORK_MAX_EVENTS];
+
+    int res = epoll_wait(m_epoll, events, NETWORK_MAX_EVENTS, (int)timeout);
+    if (res < 0)
+    {
+        if (LASTERROR() != EINTR)
+            sLog->Error("epoll_wait(): error %u", LASTERROR());
+        return;
+    }
+
+    for (int i = 0; i < res; i++)
+    {
+        NetworkSession* session = (NetworkSession*)events[i].data.ptr;
+
+        // somebody wants us to process requests or stop
+        if (!session)
+        {
+            DrainWakeup();
+            continue;
+        }
+
+        // new connections
+        if (events[i].data.ptr == &m_listenSocket)
+        {
+            AcceptConnections();
+            continue;
+        }
+
+        SOCK sock = session->m_socket;
+
+        // errors are discovered by the operation itself
+        if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+            session->OnWritable();
+        if (session->m_socket == sock && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+            session->OnReadable();
+
+        UpdateRegistration(session);
+    }
+#endif
+}
+
+void NetworkEventLoop::AcceptConnections()
+{
+    sockaddr_in addr;
+    ADDRLEN addrlen;
+    SOCK sock;
+
+    while (true)
+    {
+        addrlen = sizeof(sockaddr_in);
+        sock = accept(m_listenSocket, (sockaddr*)&addr, &addrlen);
+        if (sock == INVALID_SOCKET)
+            break;
+
+        m_acceptCallback(sock);
+    }
+}
+
+bool NetworkEventLoop::SetNonBlocking(SOCK sock)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return (ioctlsocket(sock, FIONBIO, &mode) == 0);
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0)
+        return false;
+
+    return (fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0);
+#endif
+}
+
+bool NetworkEventLoop::InitWakeup()
+{
+#ifdef _WIN32
+    // Windows select() works just with sockets, so we use UDP socket connected to itself over loopback
+    sockaddr_in addr;
+    ADDRLEN addrlen = sizeof(sockaddr_in);
+
+    memset(&addr, 0, sizeof(sockaddr_in));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    m_wakeupRecv = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (m_wakeupRecv == INVALID_SOCKET)
+        return false;
+
+    if (bind(m_wakeupRecv, (sockaddr*)&addr, sizeof(sockaddr_in)) != 0
+        || getsockname(m_wakeupRecv, (sockaddr*)&addr, &addrlen) != 0)
+    {
+        CLOSESOCKET(m_wakeupRecv);
+        m_wakeupRecv = INVALID_SOCKET;
+        return false;
+    }
+
+    m_wakeupSend = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (m_wakeupSend == INVALID_SOCKET || connect(m_wakeupSend, (sockaddr*)&addr, sizeof(sockaddr_in)) != 0)
+    {
+        CLOSESOCKET(m_wakeupRecv);
+        m_wakeupRecv = INVALID_SOCKET;
+        if (m_wakeupSend != INVALID_SOCKET)
+            CLOSESOCKET(m_wakeupSend);
+        m_wakeupSend = INVALID_SOCKET;
+        return false;
+    }
+#else
+    int fds[2];
+    if (pipe(fds) != 0)
+        return false;
+
+    m_wakeupRecv = fds[0];
+    m_wakeupSend = fds[1];
+#endif
+
+    // neither end should ever block
+    SetNonBlocking(m_wakeupRecv);
+    SetNonBlocking(m_wakeupSend);
+
+    return true;
+}
+
+void NetworkEventLoop::Wakeup()
+{
+    // one signal is enough, the loop reacts on requests, not on signal count
+    if (m_wakeupPending.exchange(true))
+        return;
+
+    char sig = 1;
+#ifdef _WIN32
+    if (send(m_wakeupSend, &sig, 1, 0) < 0)
+#else
+    if (write(m_wakeupSend, &sig, 1) < 0)
+#endif
+        m_wakeupPending = false;
+}
+
+void NetworkEventLoop::DrainWakeup()
+{
+    char buf[64];
+
+    // clear flag first, so the signal sent while draining is not lost
+    m_wakeupPending = false;
+
+#ifdef _WIN32
+    while (recv(m_wakeupRecv, buf, sizeof(buf), 0) > 0)
+        ;
+#else
+    while (read(m_wakeupRecv, buf, sizeof(buf)) > 0)
+        ;
+#endif
+}
@@ -0,0 +1,173 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_NETWORKEVENTLOOP_H
+#define BW_NETWORKEVENTLOOP_H
+
+#include <atomic>
+
+// platform-dependent defines and includes
+#ifdef _WIN32
+#define SOCK SOCKET
+#define ADDRLEN int
+
+#define SOCKETWOULDBLOCK WSAEWOULDBLOCK
+#define SOCKETCONNRESET  WSAECONNRESET
+#define SOCKETCONNABORT  WSAECONNABORTED
+#define SOCKETINPROGRESS WSAEINPROGRESS
+#define LASTERROR() WSAGetLastError()
+#define INET_PTON(fam,addrptr,buff) InetPtonA(fam,addrptr,buff)
+#define INET_NTOP(fam,addrptr,buff,socksize) InetNtopA(fam,addrptr,buff,socksize)
+#define CLOSESOCKET closesocket
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string>
+#include <netdb.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+
+#define SOCK int
+#define ADDRLEN socklen_t
+
+#define INVALID_SOCKET -1
+
+#define SOCKETWOULDBLOCK EAGAIN
+#define SOCKETCONNABORT ECONNABORTED
+#define SOCKETCONNRESET ECONNRESET
+#define SOCKETINPROGRESS EINPROGRESS
+#define LASTERROR() errno
+#define INET_PTON(fam,addrptr,buff) inet_pton(fam,addrptr,buff)
+#define INET_NTOP(fam,addrptr,buff,socksize) inet_ntop(fam,addrptr,buff,socksize)
+#define CLOSESOCKET close
+#endif
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+// the longest time the event loop sleeps, when nobody wakes it up (ms)
+#define NETWORK_IDLE_TIMEOUT    1000
+// step of waiting for sessions resolving hostname or connecting, so the timeouts are checked (ms)
+#define RESOLVE_WAIT_STEP       50
+// maximum count of socket events retrieved at once
+#define NETWORK_MAX_EVENTS      256
+
+class NetworkSession;
+
+// callback for connections accepted on listening socket; called from event loop thread
+typedef std::function<void(SOCK)> AcceptCallback;
+
+/*
+ * Class maintaining sockets of any count of network sessions in one thread; uses epoll on Linux and select
+ * on Windows; sessions are registered from any thread, but their sockets are touched only by the loop thread
+ */
+class NetworkEventLoop
+{
+    friend class NetworkSession;
+    public:
+        NetworkEventLoop();
+        ~NetworkEventLoop();
+
+        // creates poller and wakeup channel
+        bool Init();
+        // starts accepting connections on listening socket, accepted sockets are passed to callback; call before running the loop
+        bool SetListenSocket(SOCK sock, AcceptCallback callback);
+        // closes poller and wakeup channel; the loop must not be running anymore
+        void Close();
+
+        // adds session to be served by this loop; fails, if the loop is not able to serve more sessions
+        bool AddSession(NetworkSession* session);
+        // removes session from this loop; the session is closed and could be deleted after the loop processes the removal
+        void RemoveSession(NetworkSession* session);
+        // requests session to be processed in next loop iteration (pending requests, outgoing data, ..)
+        void MarkDirty(NetworkSession* session);
+
+        // performs one iteration - waits for socket events at most for specified time (ms) and processes them
+        void RunOnce(uint32_t timeout);
+        // runs loop until stopped
+        void Run();
+        // stops running loop
+        void Stop();
+        // is the loop still supposed to run?
+        bool IsRunning();
+        // wakes loop up from waiting
+        void Wakeup();
+
+        // retrieves count of served sessions
+        uint32_t GetSessionCount();
+
+        // sets socket to non-blocking mode
+        static bool SetNonBlocking(SOCK sock);
+
+    protected:
+        // creates wakeup channel
+        bool InitWakeup();
+        // reads all pending wakeup signals
+        void DrainWakeup();
+        // processes added, removed and dirty sessions
+        void ProcessSessionChanges();
+        // synchronizes socket and event mask of session with poller
+        void UpdateRegistration(NetworkSession* session);
+        // removes session socket from poller
+        void RemoveRegistration(NetworkSession* session);
+        // waits for socket events and dispatches them to sessions
+        void PollSessions(uint32_t timeout);
+        // accepts all connections waiting on listening socket
+        void AcceptConnections();
+
+    private:
+        // is supposed to run?
+        std::atomic<bool> m_running;
+        // served sessions; accessed only by loop thread
+        std::set<NetworkSession*> m_sessions;
+        // sessions waiting for timeout checks (resolving hostname, connecting); accessed only by loop thread
+        std::set<NetworkSession*> m_timedSessions;
+        // mutex guarding change lists below
+        std::mutex m_changesMtx;
+        // sessions to be added
+        std::vector<NetworkSession*> m_addedSessions;
+        // sessions to be removed
+        std::vector<NetworkSession*> m_removedSessions;
+        // sessions to be processed
+        std::vector<NetworkSession*> m_dirtySessions;
+        // count of served sessions including the ones to be added; guarded by change list mutex
+        uint32_t m_sessionCount;
+
+#ifndef _WIN32
+        // epoll instance
+        int m_epoll;
+#endif
+        // read end of wakeup channel (pipe on Linux, loopback UDP socket on Windows)
+        SOCK m_wakeupRecv;
+        // write end of wakeup channel
+        SOCK m_wakeupSend;
+        // is there a wakeup signal not yet consumed? prevents filling the wakeup channel
+        std::atomic<bool> m_wakeupPending;
+        // listening socket; owned by the caller
+        SOCK m_listenSocket;
+        // callback for accepted connections
+        AcceptCallback m_acceptCallback;
+};
+
+#endif
@@ -22,14 +22,29 @@
 #include "NetworkManager.h"
 #include "PacketHandlers.h"
 #include "Log.h"
+#include "Config.h"
+#include "Gameplay.h"
 
 #include <sstream>
 
 NetworkManager::NetworkManager()
 {
-    m_connected = false;
-    m_disconnectFlag = false;
+    m_networkThread = nullptr;
+    m_session = nullptr;
+    m_connectionState = CONNECTION_STATE_NONE;
+    m_disconnectRequested = false;
     m_running = false;
+    m_connectRequested = false;
+    m_disconnectFlag = false;
+    m_dispatchBudget = 0;
+    m_dispatchSequence = 0;
+    m_handledPacketArrival = 0;
+    m_protocolCapabilities = PROTOCOL_CAP_NONE;
+    m_connectionLost = false;
+    m_replayMode = false;
+    m_replayRealTime = true;
+
+    memset(m_dispatchStats, 0, sizeof(m_dispatchStats));
 }
 
 NetworkManager::~NetworkManager()
@@ -51,9 +66,40 @@ bool NetworkManager::Init()
 #endif
 
     // reset flags
-    m_connected = false;
     m_running = true;
     m_disconnectFlag = false;
+    m_connectRequested = false;
+
+    if (!m_eventLoop.Init())
+    {
+        sLog->Error("Unable to create network event loop");
+        return false;
+    }
+
+    m_dispatchBudget = (uint32_t)sConfig->GetIntValue(CONFIG_INT_NETWORK_DISPATCH_BUDGET);
+    m_clockSync.SetPingInterval((uint32_t)sConfig->GetIntValue(CONFIG_INT_NETWORK_PING_INTERVAL));
+
+    m_loadGenerator.Configure((uint32_t)sConfig->GetIntValue(CONFIG_INT_LOADGEN_OBJECTS), (uint32_t)sConfig->GetIntValue(CONFIG_INT_LOADGEN_HEARTBEAT_RATE),
+        (uint32_t)sConfig->GetIntValue(CONFIG_INT_LOADGEN_CHAT_RATE), (uint32_t)sConfig->GetIntValue(CONFIG_INT_LOADGEN_DURATION),
+        (uint32_t)sConfig->GetIntValue(CONFIG_INT_LOADGEN_OBJECT_IMAGE));
+    m_loadGenerator.SetPacketCallback([this](SmartPacket &pkt) { HandleGeneratedPacket(pkt); });
+
+    // replay mode takes precedence, there's nothing to capture when replaying
+    m_replayFile = sConfig->GetStringValue(CONFIG_STRING_NETWORK_REPLAY_FILE);
+    m_replayMode = !m_replayFile.empty();
+    m_replayRealTime = (sConfig->GetIntValue(CONFIG_INT_NETWORK_REPLAY_REALTIME) != 0);
+    m_telemetryFile = sConfig->GetStringValue(CONFIG_STRING_NETWORK_TELEMETRY_FILE);
+
+    // interactive client uses just one session
+    m_session = new NetworkSession(&m_eventLoop);
+    m_session->SetConnectTimeout((uint32_t)sConfig->GetIntValue(CONFIG_INT_CONNECT_TIMEOUT));
+    if (!m_replayMode)
+        m_session->SetCaptureFile(sConfig->GetStringValue(CONFIG_STRING_NETWORK_CAPTURE_FILE));
+    m_session->SetEventCallback([this](NetworkSession*, SessionEvent ev) {
+        OnSessionEvent(ev);
+    });
+    if (!m_eventLoop.AddSession(m_session))
+        return false;
 
     // spawn networking thread
     m_networkThread = new std::thread(&NetworkManager::Update, this);
@@ -65,231 +111,475 @@ bool NetworkManager::Init()
 
 void NetworkManager::Update()
 {
-    fd_set rdset;
-    // we will read just packet header, and then packet data if any
-    struct
+    // the session is served by event loop until shutdown
+    if (!m_replayMode)
     {
-        uint16_t opcode;
-        uint16_t size;
-    } recvHeader;
-    // buffer
-    uint8_t recvDataBuffer[RECV_DATA_BUFFER_SIZE];
-
-    int res;
-
-    // set timeout to 1s
-    timeval tv;
-    tv.tv_sec = 1;
-    tv.tv_usec = 1;
+        m_eventLoop.Run();
+        return;
+    }
 
-    // main networking loop
     while (m_running)
     {
-        // while not connected, perform connection routine
-        while (!m_connected)
+        // at first, wait on condition - thread is signaled when user clicks on "login"
         {
-            // at first, wait on condition - thread is signaled when user clicks on "login"
             std::unique_lock<std::mutex> lck(m_connectionMtx);
-            m_connectionCond.wait(lck);
+            m_connectionCond.wait(lck, [this] { return m_connectRequested || !m_running; });
+            m_connectRequested = false;
+        }
 
-            // broadcast about connection
-            sApplication->SignalGlobalEvent(GA_CONNECTION_START);
+        if (!m_running)
+            break;
 
-            // init socket
-            m_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        // pretend we are connected; no socket is involved at all
+        m_session->GetTelemetry().Reset();
+        OnSessionEvent(SESSION_EVENT_CONNECTING);
+        OnSessionEvent(SESSION_EVENT_CONNECTED);
 
-            m_sockAddr.sin_family = AF_INET;
-            m_sockAddr.sin_port = htons(m_port);
+        ReplayCapture();
 
-            // resolve remote address
-            if (INET_PTON(AF_INET, m_host.c_str(), &m_sockAddr.sin_addr.s_addr) != 1)
-            {
-                sLog->Error("Unable to resolve remote address");
-                sApplication->SignalGlobalEvent(GA_CONNECTION_UNABLE_TO_CONNECT);
-                m_connected = false;
-                continue;
-            }
-
-            // connect
-            if (connect(m_socket, (sockaddr*)&m_sockAddr, sizeof(sockaddr_in)) < 0)
-            {
-                sLog->Error("Unable to connect to server");
-                sApplication->SignalGlobalEvent(GA_CONNECTION_UNABLE_TO_CONNECT);
-                m_connected = false;
-                continue;
-            }
+        // keep replayed world as it is, until disconnection is requested
+        while (m_running && !m_disconnectFlag)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        if (m_running)
+            OnSessionEvent(SESSION_EVENT_DISCONNECTED);
+    }
+}
 
-            // yay! we are connected, set connection state and broadcast event
-            m_connected = true;
+void NetworkManager::OnSessionEvent(SessionEvent ev)
+{
+    switch (ev)
+    {
+        // broadcast about connection
+        case SESSION_EVENT_CONNECTING:
+            sApplication->SignalGlobalEvent(GA_CONNECTION_START);
+            break;
+        // yay! we are connected, set connection state and broadcast event
+        case SESSION_EVENT_CONNECTED:
             SetConnectionState(CONNECTION_STATE_AUTH);
             sApplication->SignalGlobalEvent(GA_CONNECTION_CONNECTED);
+            break;
+        case SESSION_EVENT_CONNECT_FAILED:
+            sApplication->SignalGlobalEvent(GA_CONNECTION_UNABLE_TO_CONNECT);
+            break;
+        // clear state, store telemetry and broadcast event
+        case SESSION_EVENT_DISCONNECTED:
+            SetConnectionState(CONNECTION_STATE_NONE);
+            m_connectionLost = true;
+            if (!m_telemetryFile.empty())
+                m_session->GetTelemetry().DumpToFile(m_telemetryFile.c_str());
+            sApplication->SignalGlobalEvent(GA_CONNECTION_DISCONNECTED);
+            break;
+    }
+}
+
+void NetworkManager::ReplayCapture()
+{
+    PacketCaptureReader reader;
+    PacketCaptureFrameHeader header;
+    PendingPacket* pp;
+    uint32_t frameCount = 0;
+    uint64_t byteCount = 0;
+
+    if (!reader.Open(m_replayFile.c_str()))
+        return;
+
+    sLog->Info("Replaying captured network traffic from %s (%s)", m_replayFile.c_str(), m_replayRealTime ? "real time" : "as fast as possible");
+
+    uint32_t startTime = getMSTime();
+
+    while (m_running && !m_disconnectFlag && reader.ReadFrameHeader(header))
+    {
+        if (header.size > PACKET_MAX_SIZE)
+        {
+            sLog->Error("Packet capture file contains bigger packet than expected, stopping replay");
+            break;
         }
 
-        // connected loop - select() on socket, process data if any, loop until ending is requested
-        while (m_running && !m_disconnectFlag)
+        // outgoing packets are not handled, except the ones standing in for user action
+        if (header.direction == CAPTURE_DIRECTION_OUTBOUND && header.opcode != CP_ENTER_WORLD)
         {
-            FD_ZERO(&rdset);
-            FD_SET(m_socket, &rdset);
-            tv.tv_sec = 1;
-            tv.tv_usec = 1;
-
-            res = select((int)m_socket + 1, &rdset, nullptr, nullptr, &tv);
-            // error
-            if (res < 0)
-            {
-                sLog->Error("select(): error %u", LASTERROR());
-            }
-            // something's on input
-            else if (res > 0)
-            {
-                if (FD_ISSET(m_socket, &rdset))
-                {
-                    // read initial bytes (header)
-                    res = recv(m_socket, (char*)&recvHeader, SmartPacket::HeaderSize, 0);
-                    // sanitize length
-                    if (res < SmartPacket::HeaderSize)
-                    {
-                        sLog->Error("recv(): error, received malformed packet");
-                        // unrecoverable error, disconnect
-                        m_disconnectFlag = true;
-                        continue;
-                    }
-                    else
-                    {
-                        // retrieve opcode and size
-                        recvHeader.opcode = ntohs(recvHeader.opcode);
-                        recvHeader.size = ntohs(recvHeader.size);
-
-                        if (recvHeader.size > 0 && recvHeader.size < RECV_DATA_BUFFER_SIZE)
-                        {
-                            int recbytes = 0;
-
-                            // while there's something to read..
-                            while (recbytes != recvHeader.size)
-                            {
-                                // retrieve next bunch
-                                res = recv(m_socket, (char*)(recvDataBuffer + recbytes), recvHeader.size - recbytes, 0);
-                                if (res <= 0)
-                                {
-                                    if (LASTERROR() == SOCKETWOULDBLOCK)
-                                        continue;
-                                    sLog->Error("recv(): error, received packet with different size than expected");
-                                    recbytes = -1;
-                                    break;
-                                }
-                                recbytes += res;
-                            }
-
-                            if (recbytes == -1)
-                                continue;
-                        }
-                        else if (recvHeader.size >= RECV_DATA_BUFFER_SIZE)
-                        {
-                            sLog->Error("recv(): error, received bigger packet than expected, exiting to avoid overflow");
-                            // unrecoverable error, disconnect
-                            m_disconnectFlag = true;
-                            continue;
-                        }
-
-                        // queue it
-
-                        std::unique_lock<std::mutex> lck(m_packetQueueMtx);
-
-                        // build packet
-                        PendingPacket* pp = new PendingPacket();
-                        pp->pkt = new SmartPacket(recvHeader.opcode, recvHeader.size);
-                        pp->pkt->SetData(recvDataBuffer, recvHeader.size);
-                        pp->timeArrived = getMSTime();
-
-                        // put it into queue
-                        m_packetQueue.push(pp);
-                    }
-                }
-            }
+            if (!reader.SkipFrameContents(header.size))
+                break;
+            continue;
         }
 
-        // if still supposed to run, and disconnection was requested, clear state, broadcast event and start again
-        if (m_running && m_disconnectFlag)
+        // wait for the moment the packet originally arrived
+        if (m_replayRealTime)
         {
-            std::unique_lock<std::mutex> lck(m_connectionMtx);
+            while (m_running && !m_disconnectFlag && getMSTimeDiff(startTime, getMSTime()) < header.time)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
 
-            SetConnectionState(CONNECTION_STATE_NONE);
-            m_connected = false;
-            sApplication->SignalGlobalEvent(GA_CONNECTION_DISCONNECTED);
-            continue;
+        // wait for main thread to make some room in queue
+        while (m_running && !m_disconnectFlag && m_session->GetPacketQueueDepth() >= m_session->GetPacketQueueCapacity())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        if (!m_running || m_disconnectFlag)
+            break;
+
+        pp = m_session->AcquirePacket(header.opcode, header.size);
+        if (!reader.ReadFrameContents(pp->pkt->GetData(), header.size))
+        {
+            sLog->Error("Packet capture file is truncated, stopping replay");
+            m_session->DiscardPacket(pp);
+            break;
         }
+
+        pp->timeArrived = getMSTime();
+        m_session->QueuePacket(pp);
+
+        if (header.direction == CAPTURE_DIRECTION_INBOUND)
+            m_session->GetTelemetry().RecordInbound(header.opcode, header.size);
+
+        frameCount++;
+        byteCount += header.size;
     }
+
+    reader.Close();
+
+    uint32_t feedTime = getMSTimeDiff(startTime, getMSTime());
+
+    // wait for main thread to take everything, so we could tell the real throughput
+    while (m_running && !m_disconnectFlag && m_session->GetPacketQueueDepth() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    uint32_t totalTime = getMSTimeDiff(startTime, getMSTime());
+
+    sLog->Info("Replay finished: %u packets (%llu bytes) fed in %u ms, taken by main thread in %u ms (%.1f packets/s)",
+        frameCount, (unsigned long long)byteCount, feedTime, totalTime, (totalTime > 0) ? (frameCount * 1000.0f / (float)totalTime) : 0.0f);
+}
+
+void NetworkManager::HandleReplayedOutboundPacket(SmartPacket &pkt)
+{
+    // the character was chosen in lobby
+    if (pkt.GetOpcode() == CP_ENTER_WORLD)
+        sGameplay->EnterWorld(pkt.ReadUInt32());
 }
 
 void NetworkManager::Connect(const char* host, uint16_t port)
 {
+    // estimates of previous session are no longer valid
+    m_clockSync.Reset();
+    m_disconnectRequested = false;
+
+    // disconnection could have been signaled after this frame's packet processing
+    if (m_connectionLost.exchange(false))
+        DiscardPending();
+
+    if (!m_replayMode)
+    {
+        m_session->Connect(host, port);
+        return;
+    }
+
     std::unique_lock<std::mutex> lck(m_connectionMtx);
 
     m_disconnectFlag = false;
 
-    m_host = host;
-    m_port = port;
-
-    // notify networking thread to perform connection routine
+    // notify networking thread to start replay
+    m_connectRequested = true;
     m_connectionCond.notify_all();
 }
 
 void NetworkManager::Disconnect()
 {
+    m_disconnectRequested = true;
+
+    if (!m_replayMode)
+    {
+        // the socket itself is closed by network thread
+        m_session->Disconnect();
+        return;
+    }
+
     m_disconnectFlag = true;
+}
 
-    // to immediatelly cut select()
-#ifdef _WIN32
-    closesocket(m_socket);
-#else
-    close(m_socket);
-#endif
+void NetworkManager::Shutdown()
+{
+    if (!m_networkThread)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lck(m_connectionMtx);
+        m_running = false;
+        m_connectionCond.notify_all();
+    }
+
+    m_eventLoop.Stop();
+
+    m_networkThread->join();
+    delete m_networkThread;
+    m_networkThread = nullptr;
+
+    // the loop closes removed session, and then the session could be deleted
+    m_eventLoop.RemoveSession(m_session);
+    m_eventLoop.Close();
+    delete m_session;
+    m_session = nullptr;
 }
 
-void NetworkManager::SendPacket(SmartPacket& pkt)
+bool NetworkManager::SendPacket(SmartPacket& pkt)
 {
-    uint16_t op, sz;
-    uint8_t* tosend = new uint8_t[SmartPacket::HeaderSize + pkt.GetSize()];
+    // there's no server to send anything to when replaying; the captured replies come anyway
+    if (m_replayMode)
+        return true;
 
-    op = htons(pkt.GetOpcode());
-    sz = htons(pkt.GetSize());
+    // server not confirming extended frames would not understand it
+    if (pkt.GetSize() >= PACKET_EXTENDED_SIZE_MARKER && !(m_protocolCapabilities & PROTOCOL_CAP_LARGE_FRAMES))
+    {
+        sLog->Error("Packet %u is too large (%u bytes) for server without extended frames support, dropping it", pkt.GetOpcode(), pkt.GetSize());
+        return false;
+    }
 
-    // write opcode
-    memcpy(tosend, &op, 2);
-    // write contents size
-    memcpy(tosend + 2, &sz, 2);
-    // write contents
-    memcpy(tosend + 4, pkt.GetData(), pkt.GetSize());
+    return m_session->SendPacket(pkt);
+}
 
-    // send response
-    send(m_socket, (const char*)tosend, pkt.GetSize() + SmartPacket::HeaderSize, MSG_NOSIGNAL);
+void NetworkManager::FlushSendBuffer()
+{
+    // the data are sent by network thread, so the caller never waits for socket
+    m_session->Flush();
 }
 
 void NetworkManager::ProcessPending()
 {
     PendingPacket* pp;
-    std::unique_lock<std::mutex> lck(m_packetQueueMtx);
+    DispatchEntry entry;
+    uint32_t i, waiting;
+    uint32_t startTime = getMSTime();
+    bool handledAny = false;
+
+    // packets of lost connection must not be handled after the session gets resumed on a new one
+    if (m_connectionLost.exchange(false))
+        DiscardPending();
+
+    // count packets left from previous frames
+    waiting = 0;
+    for (i = 0; i < MAX_PACKET_PRIORITY; i++)
+        waiting += m_dispatchQueues[i].GetSize();
+
+    // sort received packets by priority class; keep the amount limited, so the network thread still
+    // gets backpressure, when we are not keeping up (this also guarantees no class queue overflows)
+    while (waiting < PACKET_QUEUE_SIZE && m_session->PopPacket(pp))
+    {
+        entry.pp = pp;
+        entry.sequence = m_dispatchSequence++;
+
+        if (pp->pkt->GetOpcode() < MAX_OPCODES)
+            m_dispatchQueues[PacketHandlerTable[pp->pkt->GetOpcode()].priority].Push(entry);
+        else
+            m_dispatchQueues[PACKET_PRIORITY_NORMAL].Push(entry);
+        waiting++;
+    }
+
+    // handle packets from the most important class to the least important one, until we run out of time
+    for (i = 0; i < MAX_PACKET_PRIORITY; i++)
+    {
+        DispatchQueue &queue = m_dispatchQueues[i];
+
+        while (!queue.IsEmpty())
+        {
+            // always handle at least one packet, so we keep moving even with very low budget
+            if (handledAny && m_dispatchBudget > 0 && getMSTimeDiff(startTime, getMSTime()) >= m_dispatchBudget)
+                break;
+
+            entry = queue.Front();
+            queue.PopFront();
+
+            // barrier must not overtake anything received before it (i.e. chat of object being destroyed)
+            if (entry.pp->pkt->GetOpcode() < MAX_OPCODES && (PacketHandlerTable[entry.pp->pkt->GetOpcode()].dispatchFlags & PACKET_DISPATCH_BARRIER))
+                DispatchOlderPackets(i, entry.sequence);
+
+            DispatchPacket(i, entry.pp);
+            handledAny = true;
+        }
+    }
+
+    for (i = 0; i < MAX_PACKET_PRIORITY; i++)
+        m_dispatchStats[i].waiting = m_dispatchQueues[i].GetSize();
+
+    UpdateClockSync();
+
+    // synthetic traffic goes after the real one, so it does not steal its budget
+    m_loadGenerator.Update();
+}
+
+void NetworkManager::DiscardPending()
+{
+    PendingPacket* pp;
+    uint32_t i;
 
-    // work while there's something to process
-    while (!m_packetQueue.empty())
+    for (i = 0; i < MAX_PACKET_PRIORITY; i++)
     {
-        // pop packet
-        pp = m_packetQueue.front();
-        m_packetQueue.pop();
+        while (!m_dispatchQueues[i].IsEmpty())
+        {
+            m_session->ReleasePacket(m_dispatchQueues[i].Front().pp);
+            m_dispatchQueues[i].PopFront();
+        }
+        m_dispatchStats[i].waiting = 0;
+    }
+
+    // popping also lets paused receiving continue
+    while (m_session->PopPacket(pp))
+        m_session->ReleasePacket(pp);
+}
+
+void NetworkManager::HandleGeneratedPacket(SmartPacket &pkt)
+{
+    uint64_t handlerStart = getUSTime();
+
+    m_session->GetTelemetry().RecordInbound(pkt.GetOpcode(), pkt.GetSize());
+    m_handledPacketArrival = getMSTime();
+    HandlePacket(pkt);
+
+    m_session->GetTelemetry().RecordHandled(pkt.GetOpcode(), (uint32_t)num_min(getUSTime() - handlerStart, (uint64_t)UINT32_MAX), 0);
+}
+
+void NetworkManager::DispatchPacket(uint32_t priority, PendingPacket* pp)
+{
+    uint32_t now = getMSTime();
+    uint32_t latency = getMSTimeDiff(pp->timeArrived, now);
+
+    m_dispatchStats[priority].handled++;
+    m_dispatchStats[priority].totalLatency += latency;
+    if (latency > m_dispatchStats[priority].maxLatency)
+        m_dispatchStats[priority].maxLatency = latency;
 
-        // handle
-        HandlePacket(*pp->pkt);
+    // handle
+    uint64_t handlerStart = getUSTime();
+    m_handledPacketArrival = pp->timeArrived;
+    HandlePacket(*pp->pkt);
 
-        // cleanup
-        delete pp;
+    m_session->GetTelemetry().RecordHandled(pp->pkt->GetOpcode(), (uint32_t)num_min(getUSTime() - handlerStart, (uint64_t)UINT32_MAX), latency);
+
+    // return packet to pool for reuse
+    m_session->ReleasePacket(pp);
+}
+
+void NetworkManager::DispatchOlderPackets(uint32_t priority, uint32_t sequence)
+{
+    uint32_t i, oldest;
+
+    // merge lower classes by reception order; every class queue is ordered already, so looking at fronts is enough
+    while (true)
+    {
+        oldest = MAX_PACKET_PRIORITY;
+        for (i = priority + 1; i < MAX_PACKET_PRIORITY; i++)
+        {
+            if (m_dispatchQueues[i].IsEmpty() || (int32_t)(m_dispatchQueues[i].Front().sequence - sequence) >= 0)
+                continue;
+            if (oldest == MAX_PACKET_PRIORITY || (int32_t)(m_dispatchQueues[i].Front().sequence - m_dispatchQueues[oldest].Front().sequence) < 0)
+                oldest = i;
+        }
+
+        if (oldest == MAX_PACKET_PRIORITY)
+            break;
+
+        PendingPacket* pp = m_dispatchQueues[oldest].Front().pp;
+        m_dispatchQueues[oldest].PopFront();
+        DispatchPacket(oldest, pp);
     }
 }
 
+void NetworkManager::UpdateClockSync()
+{
+    // captured traffic already contains pongs of recorded session; ping only verified connection to server, which knows it
+    if (m_replayMode || (m_connectionState != CONNECTION_STATE_LOBBY && m_connectionState != CONNECTION_STATE_INGAME))
+        return;
+
+    if (!(m_protocolCapabilities & PROTOCOL_CAP_PING))
+        return;
+
+    uint32_t now = getMSTime();
+    if (!m_clockSync.IsPingDue(now))
+        return;
+
+    SmartPacket pkt(CP_PING);
+    pkt.WriteUInt32(now);
+    SendPacket(pkt);
+
+    m_clockSync.OnPingSent(now);
+}
+
+void NetworkManager::HandleClockSample(uint32_t clientTime, uint32_t serverTime)
+{
+    // use arrival time measured by network thread, so the time spent in queue is not counted
+    int32_t rtt = m_clockSync.AddSample(clientTime, serverTime, m_handledPacketArrival);
+    if (rtt < 0)
+        return;
+
+    m_session->GetTelemetry().RecordClockSample((uint32_t)rtt, m_clockSync.GetRTT(), m_clockSync.GetJitter(), m_clockSync.GetClockOffset());
+}
+
+ClockSync& NetworkManager::GetClockSync()
+{
+    return m_clockSync;
+}
+
+ClockTelemetry NetworkManager::GetClockTelemetry()
+{
+    return m_session->GetTelemetry().GetClockTelemetry();
+}
+
 void NetworkManager::SetConnectionState(ConnectionState state)
 {
     m_connectionState = state;
 }
 
+ConnectionState NetworkManager::GetConnectionState()
+{
+    return m_connectionState;
+}
+
+bool NetworkManager::IsDisconnectRequested()
+{
+    return m_disconnectRequested;
+}
+
+PacketPoolStats NetworkManager::GetPacketPoolStats()
+{
+    return m_session->GetPacketPoolStats();
+}
+
+uint32_t NetworkManager::GetHandledPacketArrivalTime()
+{
+    return m_handledPacketArrival;
+}
+
+void NetworkManager::SetProtocolCapabilities(uint32_t capabilities)
+{
+    m_protocolCapabilities = capabilities;
+
+    // the server sends extended frames just in reply to requests made after confirming them
+    m_session->SetExtendedFramesEnabled((capabilities & PROTOCOL_CAP_LARGE_FRAMES) != 0);
+}
+
+uint32_t NetworkManager::GetProtocolCapabilities()
+{
+    return m_protocolCapabilities;
+}
+
+uint32_t NetworkManager::GetPacketQueueDepth()
+{
+    return m_session->GetPacketQueueDepth();
+}
+
+uint32_t NetworkManager::GetPacketQueueHighWaterMark()
+{
+    return m_session->GetPacketQueueHighWaterMark();
+}
+
+OpcodeTelemetry NetworkManager::GetOpcodeTelemetry(uint16_t opcode)
+{
+    return m_session->GetTelemetry().GetOpcodeTelemetry(opcode);
+}
+
+PacketDispatchStats NetworkManager::GetDispatchStats(PacketPriority priority)
+{
+    return m_dispatchStats[priority];
+}
+
 void NetworkManager::HandlePacket(SmartPacket &packet)
 {
     // do not handle opcodes higher than maximum
@@ -302,6 +592,13 @@ void NetworkManager::HandlePacket(SmartPacket &packet)
     // packet handlers might throw exception about trying to reach out of packet data range
     try
     {
+        // replayed outgoing packet
+        if (m_replayMode && PacketHandlerTable[packet.GetOpcode()].handler == &PacketHandlers::Handle_ServerSide)
+        {
+            HandleReplayedOutboundPacket(packet);
+            return;
+        }
+
         // verify the state of client connection
         if ((PacketHandlerTable[packet.GetOpcode()].stateRestriction & (1 << (int)m_connectionState)) == 0)
         {
@@ -311,9 +608,17 @@ void NetworkManager::HandlePacket(SmartPacket &packet)
 
         // look handler up in handler table and call it
         PacketHandlerTable[packet.GetOpcode()].handler(packet);
+
+        // fixed-size blocks do not throw, they just stop the handler
+        if (packet.HasReadError())
+        {
+            m_session->GetTelemetry().RecordParseError(packet.GetOpcode());
+            sLog->Error("Read error during executing handler for opcode %u - packet is shorter than its layout (real size %u bytes)", packet.GetOpcode(), packet.GetSize());
+        }
     }
     catch (PacketReadException &ex)
     {
+        m_session->GetTelemetry().RecordParseError(packet.GetOpcode());
         sLog->Error("Read error during executing handler for opcode %u - attempt to read %u bytes at offset %u (real size %u bytes)", packet.GetOpcode(), ex.GetAttemptSize(), ex.GetPosition(), packet.GetSize());
     }
 }
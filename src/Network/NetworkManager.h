@@ -21,66 +21,43 @@
 #define BW_NETWORKMANAGER_H
 
 #include "Singleton.h"
-#include "SmartPacket.h"
+#include "NetworkSession.h"
+#include "PacketHandlers.h"
+#include "RingQueue.h"
+#include "ClockSync.h"
+#include "LoadGenerator.h"
 
-// platform-dependent defines and includes
-#ifdef _WIN32
-#define SOCK SOCKET
-#define ADDRLEN int
-
-#define SOCKETWOULDBLOCK WSAEWOULDBLOCK
-#define SOCKETCONNRESET  WSAECONNRESET
-#define SOCKETCONNABORT  WSAECONNABORTED
-#define SOCKETINPROGRESS WSAEINPROGRESS
-#define LASTERROR() WSAGetLastError()
-#define INET_PTON(fam,addrptr,buff) InetPtonA(fam,addrptr,buff)
-#define INET_NTOP(fam,addrptr,buff,socksize) InetNtopA(fam,addrptr,buff,socksize)
-#define CLOSESOCKET closesocket
-#else
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <string>
-#include <netdb.h>
-#include <fcntl.h>
-
-#define SOCK int
-#define ADDRLEN socklen_t
-
-#define INVALID_SOCKET -1
-
-#define SOCKETWOULDBLOCK EAGAIN
-#define SOCKETCONNABORT ECONNABORTED
-#define SOCKETCONNRESET ECONNRESET
-#define SOCKETINPROGRESS EINPROGRESS
-#define LASTERROR() errno
-#define INET_PTON(fam,addrptr,buff) inet_pton(fam,addrptr,buff)
-#define INET_NTOP(fam,addrptr,buff,socksize) inet_ntop(fam,addrptr,buff,socksize)
-#define CLOSESOCKET close
-#endif
-
-#ifndef MSG_NOSIGNAL
-# define MSG_NOSIGNAL 0
-#endif
+/*
+ * Structure of received packet waiting in dispatch queue
+ */
+struct DispatchEntry
+{
+    // received packet
+    PendingPacket* pp;
+    // order of reception, used to respect ordering barriers across priority classes
+    uint32_t sequence;
+};
 
-// 64kB receive buffer
-#define RECV_DATA_BUFFER_SIZE   64*1024
+typedef RingQueue<DispatchEntry, PACKET_QUEUE_SIZE> DispatchQueue;
 
 /*
- * Pending packet structure
+ * Structure containing dispatch counters of one packet priority class
  */
-struct PendingPacket
+struct PacketDispatchStats
 {
-    // received packet
-    SmartPacket *pkt;
-    // time of its arrival
-    uint32_t timeArrived;
+    // count of handled packets
+    uint64_t handled;
+    // sum of times between packet arrival and its handling
+    uint64_t totalLatency;
+    // the longest time between packet arrival and its handling
+    uint32_t maxLatency;
+    // count of packets waiting for next frame
+    uint32_t waiting;
 };
 
 /*
- * Singleton class maintaining network communication
+ * Singleton class maintaining network communication of interactive client; uses single network session served
+ * by event loop in separate thread
  */
 class NetworkManager
 {
@@ -90,55 +67,122 @@ class NetworkManager
 
         // initialize networking
         bool Init();
-        // update method is called from separate thread
+        // update method is called from separate thread - runs event loop, or feeds replayed packets
         void Update();
-        // ProcessPending is method called from main thread - processes received packets
+        // ProcessPending is method called from main thread - processes received packets within frame time budget
         void ProcessPending();
 
         // connect to server
         void Connect(const char* host, uint16_t port);
         // disconnect from server
         void Disconnect();
-        // send packet to server
-        void SendPacket(SmartPacket &pkt);
+        // queue packet to be sent to server with next flush; fails, if the packet was dropped
+        bool SendPacket(SmartPacket &pkt);
+        // wakes network thread to send all queued outgoing data to server
+        void FlushSendBuffer();
+        // stops network thread and closes all sockets
+        void Shutdown();
         // set connection state (security and sanity reasons)
         void SetConnectionState(ConnectionState state);
+        // retrieves connection state
+        ConnectionState GetConnectionState();
+        // was the last disconnection requested by client (and not caused by lost connection)?
+        bool IsDisconnectRequested();
+        // retrieves received packet pool counters
+        PacketPoolStats GetPacketPoolStats();
+        // retrieves count of received packets waiting for processing
+        uint32_t GetPacketQueueDepth();
+        // retrieves the highest count of received packets ever waiting for processing
+        uint32_t GetPacketQueueHighWaterMark();
+        // retrieves dispatch counters of specified priority class
+        PacketDispatchStats GetDispatchStats(PacketPriority priority);
+        // retrieves traffic and handling telemetry of specified opcode in current session
+        OpcodeTelemetry GetOpcodeTelemetry(uint16_t opcode);
+        // retrieves arrival time (mstime) of packet currently being handled
+        uint32_t GetHandledPacketArrivalTime();
+        // sets protocol capabilities confirmed by server
+        void SetProtocolCapabilities(uint32_t capabilities);
+        // retrieves protocol capabilities confirmed by server
+        uint32_t GetProtocolCapabilities();
+        // processes ping/pong sample of currently handled pong packet
+        void HandleClockSample(uint32_t clientTime, uint32_t serverTime);
+        // retrieves round-trip time and server clock estimator; main thread only
+        ClockSync& GetClockSync();
+        // retrieves round-trip time and clock synchronization summary of current session
+        ClockTelemetry GetClockTelemetry();
 
     protected:
         // protected singleton constructor
         NetworkManager();
         // handles incoming packet and puts it into queue
         void HandlePacket(SmartPacket &pkt);
+        // handles packet made up by load generator, as if it was just received
+        void HandleGeneratedPacket(SmartPacket &pkt);
+        // handles packet taken from dispatch queue of specified priority class and returns it to pool
+        void DispatchPacket(uint32_t priority, PendingPacket* pp);
+        // handles packets of lower priority classes than specified, that were received before the given sequence
+        void DispatchOlderPackets(uint32_t priority, uint32_t sequence);
+        // sends ping to server, if it's time to do so
+        void UpdateClockSync();
+        // reacts on event of network session (called from network thread)
+        void OnSessionEvent(SessionEvent ev);
+        // returns all received packets, that were not handled yet, to pool without handling them; main thread only
+        void DiscardPending();
+
+        // feeds packets from capture file to packet queue instead of receiving them from server
+        void ReplayCapture();
+        // performs action of user, that led to captured outgoing packet
+        void HandleReplayedOutboundPacket(SmartPacket &pkt);
 
     private:
         // network thread handle pointer
         std::thread* m_networkThread;
-        // mutex for packet queue
-        std::mutex m_packetQueueMtx;
-        // mutex for connection monitor operations
-        std::mutex m_connectionMtx;
-        // packet queue to be processed
-        std::queue<PendingPacket*> m_packetQueue;
-        // connection monitor condition variable
-        std::condition_variable m_connectionCond;
-
-        // host to connect to
-        std::string m_host;
-        // port to connect to
-        uint16_t m_port;
-        // is connected to host?
-        bool m_connected;
-        // is still supposed to run?
-        bool m_running;
-        // did we request disconnection?
-        bool m_disconnectFlag;
+        // event loop serving network session
+        NetworkEventLoop m_eventLoop;
+        // session of connection to server
+        NetworkSession* m_session;
+        // received packets sorted by priority class, waiting for handling; accessed only from main thread
+        DispatchQueue m_dispatchQueues[MAX_PACKET_PRIORITY];
+        // sequence number of the next packet put to dispatch queue
+        uint32_t m_dispatchSequence;
+        // dispatch counters of priority classes
+        PacketDispatchStats m_dispatchStats[MAX_PACKET_PRIORITY];
+        // time budget for packet handling in one frame (ms); 0 means unlimited
+        uint32_t m_dispatchBudget;
+        // arrival time of packet currently being handled
+        uint32_t m_handledPacketArrival;
         // current connection state
         ConnectionState m_connectionState;
-
-        // client socket
-        SOCK m_socket;
-        // socket addr struct
-        sockaddr_in m_sockAddr;
+        // was disconnection requested since the last connection attempt?
+        bool m_disconnectRequested;
+        // protocol capabilities confirmed by server in current session
+        uint32_t m_protocolCapabilities;
+        // was the connection lost since the main thread last discarded packets of previous connection?
+        std::atomic<bool> m_connectionLost;
+        // round-trip time and server clock estimator; accessed only from main thread
+        ClockSync m_clockSync;
+        // synthetic server traffic generator; accessed only from main thread
+        LoadGenerator m_loadGenerator;
+
+        // mutex for replay connection monitor operations
+        std::mutex m_connectionMtx;
+        // replay connection monitor condition variable
+        std::condition_variable m_connectionCond;
+        // is still supposed to run? (polled by network thread during replay)
+        std::atomic<bool> m_running;
+        // is there a replay request waiting for network thread?
+        bool m_connectRequested;
+        // did we request end of replay? (polled by network thread during replay)
+        std::atomic<bool> m_disconnectFlag;
+
+        // are we replaying captured traffic instead of connecting to server?
+        bool m_replayMode;
+        // replayed capture file path
+        std::string m_replayFile;
+        // replay with original timing?
+        bool m_replayRealTime;
+        // file, where the telemetry is written after disconnecting; empty when disabled
+        std::string m_telemetryFile;
 };
 
 #define sNetwork Singleton<NetworkManager>::getInstance()
@@ -0,0 +1,828 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "NetworkSession.h"
+#include "Log.h"
+
+NetworkSession::NetworkSession(NetworkEventLoop* loop, uint32_t recvBufferSize, uint32_t sendBufferSize, uint32_t packetQueueSize, uint32_t packetPoolSize,
+    uint32_t packetReturnQueueSize) : m_recvBuffer(recvBufferSize), m_sendBuffer(sendBufferSize), m_packetQueue(packetQueueSize),
+    m_packetPool(packetPoolSize, packetReturnQueueSize)
+{
+    m_loop = loop;
+    m_connectRequested = false;
+    m_disconnectRequested = false;
+    m_requestedPort = 0;
+    m_requestedSocket = INVALID_SOCKET;
+    m_state = SESSION_STATE_IDLE;
+    m_connected = false;
+    m_dirty = false;
+    m_port = 0;
+    m_addressIndex = 0;
+    m_connectStart = 0;
+    m_connectTimeout = 5000;
+    m_socket = INVALID_SOCKET;
+    m_registeredSocket = INVALID_SOCKET;
+    m_registeredFlags = 0;
+    m_receivePaused = false;
+    m_extendedFrames = false;
+    m_partialPacket = nullptr;
+    m_partialReceived = 0;
+
+    memset(&m_sockAddr, 0, sizeof(sockaddr_in));
+}
+
+NetworkSession::~NetworkSession()
+{
+    if (m_requestedSocket != INVALID_SOCKET)
+        CLOSESOCKET(m_requestedSocket);
+
+    CloseSocket();
+    DiscardPartialPacket();
+    m_capture.Close();
+}
+
+void NetworkSession::SetConnectTimeout(uint32_t timeout)
+{
+    m_connectTimeout = timeout;
+}
+
+void NetworkSession::SetCaptureFile(const char* path)
+{
+    m_captureFile = path ? path : "";
+}
+
+void NetworkSession::SetEventCallback(SessionEventCallback callback)
+{
+    m_eventCallback = callback;
+}
+
+void NetworkSession::SetExtendedFramesEnabled(bool enabled)
+{
+    m_extendedFrames = enabled;
+}
+
+void NetworkSession::Connect(const char* host, uint16_t port)
+{
+    {
+        std::unique_lock<std::mutex> lck(m_requestMtx);
+        m_connectRequested = true;
+        m_requestedHost = host;
+        m_requestedPort = port;
+    }
+
+    m_loop->MarkDirty(this);
+}
+
+void NetworkSession::Disconnect()
+{
+    {
+        std::unique_lock<std::mutex> lck(m_requestMtx);
+        m_disconnectRequested = true;
+        m_connectRequested = false;
+    }
+
+    m_loop->MarkDirty(this);
+}
+
+void NetworkSession::Attach(SOCK sock)
+{
+    {
+        std::unique_lock<std::mutex> lck(m_requestMtx);
+        if (m_requestedSocket != INVALID_SOCKET)
+            CLOSESOCKET(m_requestedSocket);
+        m_requestedSocket = sock;
+    }
+
+    m_loop->MarkDirty(this);
+}
+
+void NetworkSession::Update(uint32_t now)
+{
+    bool connectRequested, disconnectRequested;
+    std::string host;
+    uint16_t port;
+    SOCK attachSocket;
+
+    {
+        std::unique_lock<std::mutex> lck(m_requestMtx);
+        connectRequested = m_connectRequested;
+        disconnectRequested = m_disconnectRequested;
+        host = m_requestedHost;
+        port = m_requestedPort;
+        attachSocket = m_requestedSocket;
+        m_connectRequested = false;
+        m_disconnectRequested = false;
+        m_requestedSocket = INVALID_SOCKET;
+    }
+
+    // disconnection goes first, so the disconnect+connect pair results in reconnection
+    if (disconnectRequested && m_state != SESSION_STATE_IDLE)
+        Close((m_state == SESSION_STATE_CONNECTED) ? SESSION_EVENT_DISCONNECTED : SESSION_EVENT_CONNECT_FAILED);
+
+    if (connectRequested && m_state == SESSION_STATE_IDLE)
+        StartConnect(host, port, now);
+
+    // the session serves just one socket at a time
+    if (attachSocket != INVALID_SOCKET)
+    {
+        if (m_state == SESSION_STATE_IDLE)
+            AttachSocket(attachSocket);
+        else
+            CLOSESOCKET(attachSocket);
+    }
+
+    switch (m_state)
+    {
+        case SESSION_STATE_RESOLVING:
+        {
+            bool finished;
+            {
+                std::unique_lock<std::mutex> lck(m_resolveRequest->mtx);
+                finished = m_resolveRequest->finished;
+                if (finished)
+                    m_addresses.swap(m_resolveRequest->addresses);
+            }
+
+            if (finished)
+            {
+                m_resolveRequest.reset();
+
+                if (m_addresses.empty())
+                {
+                    sLog->Error("Unable to resolve remote address %s", m_host.c_str());
+                    Close(SESSION_EVENT_CONNECT_FAILED);
+                    return;
+                }
+
+                m_addressIndex = 0;
+                ConnectNextAddress();
+            }
+            else if (getMSTimeDiff(m_connectStart, now) >= m_connectTimeout)
+            {
+                // the resolver thread could not be cancelled, it finishes on its own with shared request
+                sLog->Error("Unable to resolve remote address %s", m_host.c_str());
+                Close(SESSION_EVENT_CONNECT_FAILED);
+            }
+            break;
+        }
+        case SESSION_STATE_CONNECTING:
+            if (getMSTimeDiff(m_connectStart, now) >= m_connectTimeout)
+            {
+                sLog->Error("connect(): timed out");
+                Close(SESSION_EVENT_CONNECT_FAILED);
+            }
+            break;
+        case SESSION_STATE_CONNECTED:
+            // consumer made some room, continue with data left in receive buffer
+            if (m_receivePaused && !ParseReceivedPackets())
+            {
+                Close(SESSION_EVENT_DISCONNECTED);
+                return;
+            }
+
+            // send whatever was queued since last time
+            {
+                std::unique_lock<std::mutex> sendLck(m_sendMtx);
+                if (FlushSendBuffer_internal())
+                    break;
+            }
+            Close(SESSION_EVENT_DISCONNECTED);
+            break;
+        default:
+            break;
+    }
+}
+
+bool NetworkSession::NeedsTimedUpdate()
+{
+    return (m_state == SESSION_STATE_RESOLVING || m_state == SESSION_STATE_CONNECTING);
+}
+
+uint32_t NetworkSession::GetPollFlags()
+{
+    // connect() result is reported as writability
+    if (m_state == SESSION_STATE_CONNECTING)
+        return SESSION_POLL_WRITE;
+
+    if (m_state != SESSION_STATE_CONNECTED)
+        return 0;
+
+    uint32_t flags = 0;
+
+    // do not read anything, when the consumer does not keep up; TCP flow control slows the server down
+    if (!m_receivePaused)
+        flags |= SESSION_POLL_READ;
+
+    // wait for socket to accept more data just when we have something to send
+    if (HasPendingSendData())
+        flags |= SESSION_POLL_WRITE;
+
+    return flags;
+}
+
+void NetworkSession::OnReadable()
+{
+    // paused receiving is resumed by Update, once the consumer makes some room
+    if (m_state != SESSION_STATE_CONNECTED || m_receivePaused)
+        return;
+
+    // retrieve everything available and split it to packets; any failure here is unrecoverable
+    if (!ReceiveData() || !ParseReceivedPackets())
+        Close(SESSION_EVENT_DISCONNECTED);
+}
+
+void NetworkSession::OnWritable()
+{
+    if (m_state == SESSION_STATE_CONNECTING)
+    {
+        FinishConnect();
+        return;
+    }
+
+    if (m_state != SESSION_STATE_CONNECTED)
+        return;
+
+    bool ok;
+    {
+        std::unique_lock<std::mutex> sendLck(m_sendMtx);
+        ok = FlushSendBuffer_internal();
+    }
+
+    if (!ok)
+        Close(SESSION_EVENT_DISCONNECTED);
+}
+
+void NetworkSession::StartConnect(const std::string &host, uint16_t port, uint32_t now)
+{
+    m_host = host;
+    m_port = port;
+    m_connectStart = now;
+    m_addresses.clear();
+    m_addressIndex = 0;
+
+    // every connection is measured separately
+    m_telemetry.Reset();
+
+    m_state = SESSION_STATE_RESOLVING;
+    if (m_eventCallback)
+        m_eventCallback(this, SESSION_EVENT_CONNECTING);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(sockaddr_in));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(m_port);
+
+    // numeric address does not need any lookup
+    if (INET_PTON(AF_INET, m_host.c_str(), &addr.sin_addr.s_addr) == 1)
+    {
+        m_addresses.push_back(addr);
+        ConnectNextAddress();
+        return;
+    }
+
+    // getaddrinfo could block for a long time and could not be cancelled, so it's done in separate thread;
+    // the request is shared, so the thread could safely finish even after we gave up waiting
+    std::shared_ptr<AddressResolveRequest> request = std::make_shared<AddressResolveRequest>();
+    request->host = m_host;
+    request->port = m_port;
+    m_resolveRequest = request;
+
+    std::thread resolver([request]() {
+        addrinfo hints;
+        addrinfo* result = nullptr;
+        std::vector<sockaddr_in> resolved;
+
+        memset(&hints, 0, sizeof(addrinfo));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+
+        if (getaddrinfo(request->host.c_str(), nullptr, &hints, &result) == 0)
+        {
+            for (addrinfo* ai = result; ai != nullptr; ai = ai->ai_next)
+            {
+                if (ai->ai_family != AF_INET || ai->ai_addrlen < sizeof(sockaddr_in))
+                    continue;
+
+                sockaddr_in sa = *((sockaddr_in*)ai->ai_addr);
+                sa.sin_port = htons(request->port);
+                resolved.push_back(sa);
+            }
+            freeaddrinfo(result);
+        }
+
+        // the event loop picks the result up in its next periodic update
+        std::unique_lock<std::mutex> lck(request->mtx);
+        request->addresses.swap(resolved);
+        request->finished = true;
+    });
+    resolver.detach();
+}
+
+void NetworkSession::AttachSocket(SOCK sock)
+{
+    m_socket = sock;
+    m_addresses.clear();
+    m_telemetry.Reset();
+
+    if (!NetworkEventLoop::SetNonBlocking(m_socket))
+    {
+        sLog->Error("Unable to set socket to non-blocking mode");
+        Close(SESSION_EVENT_CONNECT_FAILED);
+        return;
+    }
+
+    OnConnected();
+}
+
+void NetworkSession::ConnectNextAddress()
+{
+    int err;
+
+    // try every address the host resolved to, until the time runs out
+    for (; m_addressIndex < m_addresses.size(); m_addressIndex++)
+    {
+        if (getMSTimeDiff(m_connectStart, getMSTime()) >= m_connectTimeout)
+            break;
+
+        // init socket
+        m_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (m_socket == INVALID_SOCKET)
+        {
+            sLog->Error("socket(): error %u", LASTERROR());
+            break;
+        }
+
+        // the socket stays non-blocking for the whole session
+        if (!NetworkEventLoop::SetNonBlocking(m_socket))
+        {
+            sLog->Error("Unable to set socket to non-blocking mode");
+            CloseSocket();
+            break;
+        }
+
+        m_sockAddr = m_addresses[m_addressIndex];
+
+        // start connecting
+        if (connect(m_socket, (sockaddr*)&m_sockAddr, sizeof(sockaddr_in)) == 0)
+        {
+            OnConnected();
+            return;
+        }
+
+        err = LASTERROR();
+        if (err == SOCKETINPROGRESS || err == SOCKETWOULDBLOCK)
+        {
+            // wait for the event loop to report the result
+            m_state = SESSION_STATE_CONNECTING;
+            return;
+        }
+
+        sLog->Error("connect(): error %u", err);
+        CloseSocket();
+    }
+
+    sLog->Error("Unable to connect to server");
+    Close(SESSION_EVENT_CONNECT_FAILED);
+}
+
+void NetworkSession::FinishConnect()
+{
+    // the socket is done connecting, find out, how it ended
+    int err = 0;
+    ADDRLEN errlen = sizeof(err);
+    if (getsockopt(m_socket, SOL_SOCKET, SO_ERROR, (char*)&err, &errlen) < 0)
+        err = LASTERROR();
+
+    if (err == 0)
+    {
+        OnConnected();
+        return;
+    }
+
+    // try another address
+    sLog->Error("connect(): error %u", err);
+    CloseSocket();
+    m_addressIndex++;
+    ConnectNextAddress();
+}
+
+void NetworkSession::OnConnected()
+{
+    // drop any leftovers from previous connection
+    m_recvBuffer.Reset();
+    DiscardPartialPacket();
+    {
+        std::unique_lock<std::mutex> sendLck(m_sendMtx);
+        m_sendBuffer.Reset();
+    }
+    m_receivePaused = false;
+    m_extendedFrames = false;
+
+    // every connection is captured to its own file
+    if (!m_captureFile.empty())
+        m_capture.Open(m_captureFile.c_str());
+
+    // yay! we are connected
+    m_state = SESSION_STATE_CONNECTED;
+    m_connected = true;
+
+    if (m_eventCallback)
+        m_eventCallback(this, SESSION_EVENT_CONNECTED);
+}
+
+void NetworkSession::Close(SessionEvent ev)
+{
+    CloseSocket();
+    DiscardPartialPacket();
+    m_capture.Close();
+    m_resolveRequest.reset();
+    m_addresses.clear();
+    m_receivePaused = false;
+    m_connected = false;
+    m_state = SESSION_STATE_IDLE;
+
+    if (m_eventCallback)
+        m_eventCallback(this, ev);
+}
+
+void NetworkSession::CloseSocket()
+{
+    if (m_socket == INVALID_SOCKET)
+        return;
+
+    // the same descriptor number could be given to next socket, so the poller has to forget it now
+    if (m_registeredSocket == m_socket)
+        m_loop->RemoveRegistration(this);
+
+    // sending is done under send lock, so nobody writes into descriptor, that is being closed
+    std::unique_lock<std::mutex> sendLck(m_sendMtx);
+    CLOSESOCKET(m_socket);
+    m_socket = INVALID_SOCKET;
+}
+
+void NetworkSession::DiscardPartialPacket()
+{
+    if (!m_partialPacket)
+        return;
+
+    m_packetPool.Discard(m_partialPacket);
+    m_partialPacket = nullptr;
+    m_partialReceived = 0;
+}
+
+bool NetworkSession::SendPacket(SmartPacket& pkt)
+{
+    uint16_t header[2];
+    uint32_t extendedSize;
+    bool extended = (pkt.GetSize() >= PACKET_EXTENDED_SIZE_MARKER);
+    uint32_t totalSize = (extended ? SmartPacket::ExtendedHeaderSize : SmartPacket::HeaderSize) + pkt.GetSize();
+
+    if (pkt.GetSize() > PACKET_MAX_SIZE)
+    {
+        sLog->Error("send(): error, outgoing packet %u is too large (%u bytes), dropping it", pkt.GetOpcode(), pkt.GetSize());
+        return false;
+    }
+
+    if (m_capture.IsOpen())
+        m_capture.WriteFrame(CAPTURE_DIRECTION_OUTBOUND, pkt.GetOpcode(), pkt.GetSize(), pkt.GetData(), getMSTime());
+
+    std::unique_lock<std::mutex> lck(m_sendMtx);
+
+    // not enough space for this packet; the socket is written only by event loop, so just make it send what we have
+    if (m_sendBuffer.GetFreeSize() < totalSize)
+    {
+        lck.unlock();
+        m_loop->MarkDirty(this);
+
+        sLog->Error("send(): error, send buffer full, unable to queue outgoing packet %u, dropping it", pkt.GetOpcode());
+        return false;
+    }
+
+    // write opcode and contents size; size not fitting into header is replaced by marker and follows as 32bit value
+    header[0] = htons(pkt.GetOpcode());
+    header[1] = htons(extended ? (uint16_t)PACKET_EXTENDED_SIZE_MARKER : (uint16_t)pkt.GetSize());
+    m_sendBuffer.Write(header, SmartPacket::HeaderSize);
+
+    if (extended)
+    {
+        extendedSize = htonl(pkt.GetSize());
+        m_sendBuffer.Write(&extendedSize, sizeof(uint32_t));
+    }
+
+    // write contents
+    if (pkt.GetSize() > 0)
+        m_sendBuffer.Write(pkt.GetData(), pkt.GetSize());
+
+    m_telemetry.RecordOutbound(pkt.GetOpcode(), pkt.GetSize());
+
+    return true;
+}
+
+void NetworkSession::Flush()
+{
+    // the data are sent by event loop, so the caller never waits for socket
+    if (HasPendingSendData())
+        m_loop->MarkDirty(this);
+}
+
+bool NetworkSession::HasPendingSendData()
+{
+    std::unique_lock<std::mutex> lck(m_sendMtx);
+
+    return (m_sendBuffer.GetUsedSize() > 0);
+}
+
+uint32_t NetworkSession::GetSendBufferFreeSize()
+{
+    std::unique_lock<std::mutex> lck(m_sendMtx);
+
+    return m_sendBuffer.GetFreeSize();
+}
+
+bool NetworkSession::FlushSendBuffer_internal()
+{
+    const uint8_t* segments[2];
+    uint32_t segmentSizes[2];
+    uint32_t segmentCount;
+    int res;
+
+    // nobody to send it to
+    if (!m_connected)
+    {
+        m_sendBuffer.Reset();
+        return true;
+    }
+
+    while (m_sendBuffer.GetUsedSize() > 0)
+    {
+        // send both parts of wrapped buffer in one call
+        segmentCount = m_sendBuffer.GetReadSegments(segments[0], segmentSizes[0], segments[1], segmentSizes[1]);
+
+#ifdef _WIN32
+        WSABUF bufs[2];
+        DWORD sent = 0;
+        for (uint32_t i = 0; i < segmentCount; i++)
+        {
+            bufs[i].buf = (CHAR*)segments[i];
+            bufs[i].len = segmentSizes[i];
+        }
+
+        if (WSASend(m_socket, bufs, segmentCount, &sent, 0, nullptr, nullptr) == SOCKET_ERROR)
+            res = -1;
+        else
+            res = (int)sent;
+#else
+        iovec bufs[2];
+        msghdr msg;
+        for (uint32_t i = 0; i < segmentCount; i++)
+        {
+            bufs[i].iov_base = (void*)segments[i];
+            bufs[i].iov_len = segmentSizes[i];
+        }
+
+        memset(&msg, 0, sizeof(msghdr));
+        msg.msg_iov = bufs;
+        msg.msg_iovlen = segmentCount;
+
+        // sendmsg is writev with flags, so we could suppress SIGPIPE
+        res = (int)sendmsg(m_socket, &msg, MSG_NOSIGNAL);
+#endif
+
+        if (res < 0)
+        {
+            // socket buffer is full, the rest stays queued for next flush
+            if (LASTERROR() == SOCKETWOULDBLOCK)
+                return true;
+
+            sLog->Error("send(): error %u", LASTERROR());
+            return false;
+        }
+
+        // consume just what was really sent, partial writes are continued in next iteration
+        m_sendBuffer.Skip((uint32_t)res);
+    }
+
+    return true;
+}
+
+bool NetworkSession::ReceiveData()
+{
+    uint32_t freeSize;
+    uint8_t* dst = m_recvBuffer.GetWritePointer(freeSize);
+
+    // this should never happen - the buffer is drained down to one incomplete packet, unless the receiving
+    // is paused, and nothing is received while paused
+    if (freeSize == 0)
+    {
+        sLog->Error("recv(): error, receive buffer is full");
+        return false;
+    }
+
+    // take as much as the kernel has for us, the packets are split later
+    int res = recv(m_socket, (char*)dst, (int)freeSize, 0);
+    if (res == 0)
+    {
+        sLog->Error("recv(): connection closed by remote host");
+        return false;
+    }
+    else if (res < 0)
+    {
+        // nothing to read yet, try again later
+        if (LASTERROR() == SOCKETWOULDBLOCK)
+            return true;
+
+        sLog->Error("recv(): error %u", LASTERROR());
+        return false;
+    }
+
+    m_recvBuffer.CommitWrite((uint32_t)res);
+
+    return true;
+}
+
+bool NetworkSession::ParseReceivedPackets()
+{
+    // we will read just packet header, and then packet data if any
+    struct
+    {
+        uint16_t opcode;
+        uint16_t size;
+    } recvHeader;
+    uint32_t size, extendedSize, chunk;
+    bool extended;
+
+    m_receivePaused = false;
+
+    while (true)
+    {
+        // contents of packet in extended frame are moved to its packet object as they arrive, so the packet
+        // does not need to fit into receive buffer
+        if (m_partialPacket)
+        {
+            chunk = num_min(m_recvBuffer.GetUsedSize(), m_partialPacket->pkt->GetSize() - m_partialReceived);
+            if (chunk > 0)
+                m_recvBuffer.Read(m_partialPacket->pkt->GetData() + m_partialReceived, chunk);
+            m_partialReceived += chunk;
+
+            // incomplete packet, wait for the rest
+            if (m_partialReceived < m_partialPacket->pkt->GetSize())
+                break;
+
+            QueueReceivedPacket(m_partialPacket);
+            m_partialPacket = nullptr;
+            continue;
+        }
+
+        if (!m_recvBuffer.Peek(&recvHeader, SmartPacket::HeaderSize))
+            break;
+
+        // retrieve opcode and size
+        recvHeader.opcode = ntohs(recvHeader.opcode);
+        size = ntohs(recvHeader.size);
+        extended = (size == PACKET_EXTENDED_SIZE_MARKER && m_extendedFrames);
+
+        // size marker means extended frame, real size follows; peers not using them send it as regular size
+        if (extended)
+        {
+            if (!m_recvBuffer.Peek(&extendedSize, sizeof(uint32_t), SmartPacket::HeaderSize))
+                break;
+
+            size = ntohl(extendedSize);
+            if (size > PACKET_MAX_SIZE)
+            {
+                sLog->Error("recv(): error, received bigger packet than expected, exiting to avoid overflow");
+                return false;
+            }
+        }
+        // incomplete packet, wait for the rest
+        else if (m_recvBuffer.GetUsedSize() < (uint32_t)SmartPacket::HeaderSize + size)
+            break;
+
+        // consumer is not keeping up - stop reading instead of dropping anything; the data stays in buffers,
+        // and the consumer wakes us up after making some room
+        if (m_packetQueue.GetSize() >= m_packetQueue.GetCapacity())
+        {
+            m_receivePaused = true;
+            break;
+        }
+
+        // retrieve recycled packet
+        PendingPacket* pp = m_packetPool.Acquire(recvHeader.opcode, size);
+
+        // extended frame contents are reassembled above
+        if (extended)
+        {
+            m_recvBuffer.Skip(SmartPacket::ExtendedHeaderSize);
+            m_partialPacket = pp;
+            m_partialReceived = 0;
+            continue;
+        }
+
+        // copy contents directly from receive buffer
+        m_recvBuffer.Skip(SmartPacket::HeaderSize);
+        if (size > 0)
+            m_recvBuffer.Read(pp->pkt->GetData(), size);
+
+        QueueReceivedPacket(pp);
+    }
+
+    return true;
+}
+
+void NetworkSession::QueueReceivedPacket(PendingPacket* pp)
+{
+    pp->timeArrived = getMSTime();
+
+    if (m_capture.IsOpen())
+        m_capture.WriteFrame(CAPTURE_DIRECTION_INBOUND, pp->pkt->GetOpcode(), pp->pkt->GetSize(), pp->pkt->GetData(), pp->timeArrived);
+
+    m_telemetry.RecordInbound(pp->pkt->GetOpcode(), pp->pkt->GetSize());
+
+    // queue it; there is always free space, as we are the only producer and the space was checked before acquiring
+    m_packetQueue.Push(pp);
+}
+
+bool NetworkSession::PopPacket(PendingPacket* &pp)
+{
+    if (!m_packetQueue.Pop(pp))
+        return false;
+
+    // receiving was paused, and there's enough room again
+    if (m_receivePaused && m_packetQueue.GetSize() <= m_packetQueue.GetCapacity() / 2)
+        m_loop->MarkDirty(this);
+
+    return true;
+}
+
+void NetworkSession::ReleasePacket(PendingPacket* pp)
+{
+    m_packetPool.Release(pp);
+}
+
+PendingPacket* NetworkSession::AcquirePacket(uint16_t opcode, uint32_t size)
+{
+    return m_packetPool.Acquire(opcode, size);
+}
+
+bool NetworkSession::QueuePacket(PendingPacket* pp)
+{
+    return m_packetQueue.Push(pp);
+}
+
+void NetworkSession::DiscardPacket(PendingPacket* pp)
+{
+    m_packetPool.Discard(pp);
+}
+
+bool NetworkSession::IsConnected()
+{
+    return m_connected;
+}
+
+SessionState NetworkSession::GetState()
+{
+    return m_state;
+}
+
+NetworkTelemetry& NetworkSession::GetTelemetry()
+{
+    return m_telemetry;
+}
+
+PacketPoolStats NetworkSession::GetPacketPoolStats()
+{
+    return m_packetPool.GetStats();
+}
+
+uint32_t NetworkSession::GetPacketQueueDepth()
+{
+    return m_packetQueue.GetSize();
+}
+
+uint32_t NetworkSession::GetPacketQueueCapacity()
+{
+    return m_packetQueue.GetCapacity();
+}
+
+uint32_t NetworkSession::GetPacketQueueHighWaterMark()
+{
+    return m_packetQueue.GetHighWaterMark();
+}
@@ -0,0 +1,270 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_NETWORKSESSION_H
+#define BW_NETWORKSESSION_H
+
+#include "NetworkEventLoop.h"
+#include "SmartPacket.h"
+#include "RingBuffer.h"
+#include "PacketPool.h"
+#include "SPSCQueue.h"
+#include "PacketCapture.h"
+#include "NetworkTelemetry.h"
+
+// 256kB socket receive ring buffer; has to be able to hold at least one maximum-sized regular frame with header;
+// packets in extended frames are reassembled outside of it
+#define RECV_RING_BUFFER_SIZE   256*1024
+// default capacity of queue between event loop and packet consumer
+#define PACKET_QUEUE_SIZE       4096
+// 256kB outbound buffer; packets are serialized into it and sent in batches
+#define SEND_RING_BUFFER_SIZE   256*1024
+
+// packets could wait in packet queue and in dispatch queues of consumer (also limited to PACKET_QUEUE_SIZE) at once;
+// sessions created with other sizes have to keep the same relation
+static_assert(PACKET_POOL_RETURN_QUEUE_SIZE >= 2 * PACKET_QUEUE_SIZE + 2, "Packet pool return queue cannot hold all packets in use");
+
+/*
+ * Structure of hostname resolving request, shared between event loop and resolver thread
+ */
+struct AddressResolveRequest
+{
+    AddressResolveRequest() : port(0), finished(false) { };
+
+    // host to be resolved
+    std::string host;
+    // port to be set to resolved addresses
+    uint16_t port;
+    // mutex guarding result
+    std::mutex mtx;
+    // has the resolver finished?
+    bool finished;
+    // resolved addresses; empty on failure
+    std::vector<sockaddr_in> addresses;
+};
+
+// state of network session
+enum SessionState
+{
+    SESSION_STATE_IDLE = 0,             // not connected, nothing in progress
+    SESSION_STATE_RESOLVING = 1,        // waiting for hostname resolver
+    SESSION_STATE_CONNECTING = 2,       // waiting for connect() to finish
+    SESSION_STATE_CONNECTED = 3         // connected, exchanging data
+};
+
+// events reported by network session
+enum SessionEvent
+{
+    SESSION_EVENT_CONNECTING = 0,       // connection attempt started
+    SESSION_EVENT_CONNECTED = 1,        // connection established
+    SESSION_EVENT_CONNECT_FAILED = 2,   // connection attempt failed or was cancelled
+    SESSION_EVENT_DISCONNECTED = 3      // established connection was closed
+};
+
+// socket events the session is interested in
+enum SessionPollFlags
+{
+    SESSION_POLL_READ = 1,
+    SESSION_POLL_WRITE = 2
+};
+
+class NetworkSession;
+
+// session event callback; called from event loop thread
+typedef std::function<void(NetworkSession*, SessionEvent)> SessionEventCallback;
+
+/*
+ * Class representing one connection to server - socket, buffers and received packet queue; the socket work is done
+ * by event loop thread, packets are sent and received packets consumed by another single thread (or the loop thread itself)
+ */
+class NetworkSession
+{
+    friend class NetworkEventLoop;
+    public:
+        // packet pool return queue has to be able to hold every packet the consumer could hold at once, see above
+        NetworkSession(NetworkEventLoop* loop, uint32_t recvBufferSize = RECV_RING_BUFFER_SIZE, uint32_t sendBufferSize = SEND_RING_BUFFER_SIZE,
+            uint32_t packetQueueSize = PACKET_QUEUE_SIZE, uint32_t packetPoolSize = PACKET_POOL_INITIAL_COUNT, uint32_t packetReturnQueueSize = PACKET_POOL_RETURN_QUEUE_SIZE);
+        ~NetworkSession();
+
+        // sets time for resolving host and establishing connection (ms)
+        void SetConnectTimeout(uint32_t timeout);
+        // sets file to capture traffic of every connection into; empty or nullptr disables capture
+        void SetCaptureFile(const char* path);
+        // sets callback for session events
+        void SetEventCallback(SessionEventCallback callback);
+        // enables receiving of extended frames, once the other side confirms them; reset with every connection
+        void SetExtendedFramesEnabled(bool enabled);
+
+        // requests connection to server
+        void Connect(const char* host, uint16_t port);
+        // requests disconnection from server
+        void Disconnect();
+        // requests serving of already connected socket (i.e. accepted by server); the session takes ownership of it
+        void Attach(SOCK sock);
+
+        // queues packet to be sent to server with next flush; fails, if the send buffer is full
+        bool SendPacket(SmartPacket &pkt);
+        // requests event loop to send all queued outgoing data
+        void Flush();
+        // is there any outgoing data waiting to be sent?
+        bool HasPendingSendData();
+        // retrieves space left in outbound buffer
+        uint32_t GetSendBufferFreeSize();
+
+        // retrieves received packet; fails, if there's none (consumer thread only)
+        bool PopPacket(PendingPacket* &pp);
+        // returns handled packet to pool (consumer thread only)
+        void ReleasePacket(PendingPacket* pp);
+        // retrieves packet object from pool, to be filled and queued by other producer than socket (i.e. capture replay)
+        PendingPacket* AcquirePacket(uint16_t opcode, uint32_t size);
+        // queues packet filled by other producer than socket; fails, if the queue is full
+        bool QueuePacket(PendingPacket* pp);
+        // returns acquired, but not queued packet to pool
+        void DiscardPacket(PendingPacket* pp);
+
+        // is the session connected?
+        bool IsConnected();
+        // retrieves session state
+        SessionState GetState();
+        // retrieves per-opcode telemetry of current connection
+        NetworkTelemetry& GetTelemetry();
+        // retrieves received packet pool counters
+        PacketPoolStats GetPacketPoolStats();
+        // retrieves count of received packets waiting for processing
+        uint32_t GetPacketQueueDepth();
+        // retrieves capacity of received packet queue
+        uint32_t GetPacketQueueCapacity();
+        // retrieves the highest count of received packets ever waiting for processing
+        uint32_t GetPacketQueueHighWaterMark();
+
+    protected:
+        // processes connection requests, resolver progress, timeouts and outgoing data (loop thread only)
+        void Update(uint32_t now);
+        // does the session need to be updated periodically, even without any event?
+        bool NeedsTimedUpdate();
+        // retrieves socket events the session waits for
+        uint32_t GetPollFlags();
+        // called by event loop when the socket has data to read, or failed
+        void OnReadable();
+        // called by event loop when the socket is able to send data, or finished connecting
+        void OnWritable();
+
+        // starts resolving host and connecting
+        void StartConnect(const std::string &host, uint16_t port, uint32_t now);
+        // starts serving already connected socket
+        void AttachSocket(SOCK sock);
+        // starts connecting to next resolved address; fails the attempt, if there's none left
+        void ConnectNextAddress();
+        // finishes connecting after the socket became writable
+        void FinishConnect();
+        // marks the session connected and reports it
+        void OnConnected();
+        // closes socket and resets state; reports supplied event
+        void Close(SessionEvent ev);
+        // closes socket, if opened
+        void CloseSocket();
+
+        // receives all available data from socket into receive buffer; returns false on unrecoverable error
+        bool ReceiveData();
+        // parses all complete packets from receive buffer and puts them into queue; returns false on unrecoverable error
+        bool ParseReceivedPackets();
+        // puts received packet into queue, records it to capture and telemetry
+        void QueueReceivedPacket(PendingPacket* pp);
+        // returns packet being reassembled from extended frame to pool
+        void DiscardPartialPacket();
+        // sends queued outgoing data, send mutex has to be locked (loop thread only); returns false on unrecoverable error
+        bool FlushSendBuffer_internal();
+
+    private:
+        // event loop serving this session
+        NetworkEventLoop* m_loop;
+        // event callback
+        SessionEventCallback m_eventCallback;
+
+        // mutex guarding requests from other threads
+        std::mutex m_requestMtx;
+        // is there a connection request waiting for event loop?
+        bool m_connectRequested;
+        // is there a disconnection request waiting for event loop?
+        bool m_disconnectRequested;
+        // requested host
+        std::string m_requestedHost;
+        // requested port
+        uint16_t m_requestedPort;
+        // connected socket waiting to be served; INVALID_SOCKET if none
+        SOCK m_requestedSocket;
+
+        // current state; changed only by event loop thread
+        SessionState m_state;
+        // is connected? readable from any thread
+        std::atomic<bool> m_connected;
+        // is the session waiting for event loop processing?
+        std::atomic<bool> m_dirty;
+        // host to connect to
+        std::string m_host;
+        // port to connect to
+        uint16_t m_port;
+        // pending hostname resolving request
+        std::shared_ptr<AddressResolveRequest> m_resolveRequest;
+        // resolved addresses
+        std::vector<sockaddr_in> m_addresses;
+        // index of address currently being connected to
+        uint32_t m_addressIndex;
+        // time of connection attempt start
+        uint32_t m_connectStart;
+        // connection timeout (ms)
+        uint32_t m_connectTimeout;
+
+        // client socket
+        SOCK m_socket;
+        // socket addr struct
+        sockaddr_in m_sockAddr;
+        // socket registered in event loop poller
+        SOCK m_registeredSocket;
+        // socket events registered in event loop poller
+        uint32_t m_registeredFlags;
+
+        // mutex for outbound buffer
+        std::mutex m_sendMtx;
+        // buffer for received, but not yet parsed data
+        RingBuffer m_recvBuffer;
+        // buffer for serialized, but not yet sent packets
+        RingBuffer m_sendBuffer;
+        // packet queue to be processed; filled by event loop, consumed by packet consumer
+        SPSCQueue<PendingPacket*> m_packetQueue;
+        // pool of recycled packet objects
+        PacketPool m_packetPool;
+        // is receiving paused, because the consumer does not keep up?
+        std::atomic<bool> m_receivePaused;
+        // is size marker in received header treated as extended frame? until then, it's just regular size
+        std::atomic<bool> m_extendedFrames;
+        // packet of extended frame being reassembled; owned by event loop thread
+        PendingPacket* m_partialPacket;
+        // count of contents bytes of partial packet received so far
+        uint32_t m_partialReceived;
+
+        // capture file path; empty when disabled
+        std::string m_captureFile;
+        // traffic capture writer
+        PacketCaptureWriter m_capture;
+        // per-opcode telemetry of current connection
+        NetworkTelemetry m_telemetry;
+};
+
+#endif
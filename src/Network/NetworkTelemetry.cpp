@@ -0,0 +1,240 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "NetworkTelemetry.h"
+#include "Log.h"
+
+NetworkTelemetry::NetworkTelemetry()
+{
+    Reset();
+}
+
+void NetworkTelemetry::Reset()
+{
+    std::unique_lock<std::mutex> lck(m_countersMtx);
+
+    memset(m_counters, 0, sizeof(m_counters));
+    for (uint32_t i = 0; i < MAX_OPCODES; i++)
+        m_counters[i].handlerTimeMin = UINT32_MAX;
+
+    memset(&m_clock, 0, sizeof(m_clock));
+
+    m_startTime = getMSTime();
+}
+
+void NetworkTelemetry::RecordInbound(uint16_t opcode, uint32_t size)
+{
+    if (opcode >= MAX_OPCODES)
+        return;
+
+    std::unique_lock<std::mutex> lck(m_countersMtx);
+
+    m_counters[opcode].inPackets++;
+    m_counters[opcode].inBytes += size;
+}
+
+void NetworkTelemetry::RecordOutbound(uint16_t opcode, uint32_t size)
+{
+    if (opcode >= MAX_OPCODES)
+        return;
+
+    std::unique_lock<std::mutex> lck(m_countersMtx);
+
+    m_counters[opcode].outPackets++;
+    m_counters[opcode].outBytes += size;
+}
+
+void NetworkTelemetry::RecordHandled(uint16_t opcode, uint32_t handlerTime, uint32_t queueWait)
+{
+    if (opcode >= MAX_OPCODES)
+        return;
+
+    // find histogram bucket - position of highest set bit
+    uint32_t bucket = 0;
+    while (bucket < TELEMETRY_HISTOGRAM_BUCKETS - 1 && (handlerTime >> bucket) != 0)
+        bucket++;
+
+    std::unique_lock<std::mutex> lck(m_countersMtx);
+
+    OpcodeCounters &cnt = m_counters[opcode];
+
+    cnt.handled++;
+    cnt.handlerTimeTotal += handlerTime;
+    if (handlerTime < cnt.handlerTimeMin)
+        cnt.handlerTimeMin = handlerTime;
+    if (handlerTime > cnt.handlerTimeMax)
+        cnt.handlerTimeMax = handlerTime;
+    cnt.handlerTimeHistogram[bucket]++;
+
+    cnt.queueWaitTotal += queueWait;
+    if (queueWait > cnt.queueWaitMax)
+        cnt.queueWaitMax = queueWait;
+}
+
+void NetworkTelemetry::RecordParseError(uint16_t opcode)
+{
+    if (opcode >= MAX_OPCODES)
+        return;
+
+    std::unique_lock<std::mutex> lck(m_countersMtx);
+
+    m_counters[opcode].parseErrors++;
+}
+
+void NetworkTelemetry::RecordClockSample(uint32_t rtt, uint32_t smoothedRtt, uint32_t jitter, int32_t clockOffset)
+{
+    std::unique_lock<std::mutex> lck(m_countersMtx);
+
+    if (m_clock.samples == 0 || rtt < m_clock.rttMin)
+        m_clock.rttMin = rtt;
+    if (rtt > m_clock.rttMax)
+        m_clock.rttMax = rtt;
+
+    m_clock.samples++;
+    m_clock.rttSmoothed = smoothedRtt;
+    m_clock.jitter = jitter;
+    m_clock.clockOffset = clockOffset;
+}
+
+uint32_t NetworkTelemetry::GetHistogramPercentile(const uint32_t* histogram, uint64_t count, float percentile)
+{
+    if (count == 0)
+        return 0;
+
+    // rank of the value we are looking for
+    uint64_t rank = (uint64_t)((double)count * percentile);
+    if (rank >= count)
+        rank = count - 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < TELEMETRY_HISTOGRAM_BUCKETS; i++)
+    {
+        if (seen + histogram[i] > rank)
+        {
+            // bucket 0 holds just zero
+            if (i == 0)
+                return 0;
+
+            // interpolate within bucket range <2^(i-1), 2^i)
+            uint32_t low = 1 << (i - 1);
+            return low + (uint32_t)((uint64_t)low * (rank - seen) / histogram[i]);
+        }
+        seen += histogram[i];
+    }
+
+    return UINT32_MAX;
+}
+
+OpcodeTelemetry NetworkTelemetry::Summarize(const OpcodeCounters &counters)
+{
+    OpcodeTelemetry tel;
+
+    tel.inPackets = counters.inPackets;
+    tel.inBytes = counters.inBytes;
+    tel.outPackets = counters.outPackets;
+    tel.outBytes = counters.outBytes;
+    tel.handled = counters.handled;
+    tel.parseErrors = counters.parseErrors;
+
+    if (counters.handled > 0)
+    {
+        tel.handlerTimeMin = counters.handlerTimeMin;
+        tel.handlerTimeMean = (uint32_t)(counters.handlerTimeTotal / counters.handled);
+        // histogram only estimates the value, do not exceed really measured maximum
+        tel.handlerTimeP99 = num_min(GetHistogramPercentile(counters.handlerTimeHistogram, counters.handled, 0.99f), counters.handlerTimeMax);
+        tel.handlerTimeMax = counters.handlerTimeMax;
+        tel.queueWaitMean = (uint32_t)(counters.queueWaitTotal / counters.handled);
+        tel.queueWaitMax = counters.queueWaitMax;
+    }
+    else
+    {
+        tel.handlerTimeMin = 0;
+        tel.handlerTimeMean = 0;
+        tel.handlerTimeP99 = 0;
+        tel.handlerTimeMax = 0;
+        tel.queueWaitMean = 0;
+        tel.queueWaitMax = 0;
+    }
+
+    return tel;
+}
+
+OpcodeTelemetry NetworkTelemetry::GetOpcodeTelemetry(uint16_t opcode)
+{
+    if (opcode >= MAX_OPCODES)
+    {
+        OpcodeCounters empty;
+        memset(&empty, 0, sizeof(OpcodeCounters));
+        return Summarize(empty);
+    }
+
+    std::unique_lock<std::mutex> lck(m_countersMtx);
+
+    return Summarize(m_counters[opcode]);
+}
+
+ClockTelemetry NetworkTelemetry::GetClockTelemetry()
+{
+    std::unique_lock<std::mutex> lck(m_countersMtx);
+
+    return m_clock;
+}
+
+bool NetworkTelemetry::DumpToFile(const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        sLog->Error("Unable to open network telemetry file %s for writing", path);
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lck(m_countersMtx);
+
+    fprintf(f, "Network telemetry, measured for %u ms\n", getMSTimeDiff(m_startTime, getMSTime()));
+    fprintf(f, "handler times in microseconds, queue wait times in milliseconds\n\n");
+
+    if (m_clock.samples > 0)
+    {
+        fprintf(f, "round trip: %llu samples, min %u ms, max %u ms, smoothed %u ms, jitter %u ms, server clock offset %d ms\n\n",
+            (unsigned long long)m_clock.samples, m_clock.rttMin, m_clock.rttMax, m_clock.rttSmoothed, m_clock.jitter, m_clock.clockOffset);
+    }
+
+    fprintf(f, "%6s %10s %12s %10s %12s %10s %8s %8s %8s %8s %8s %8s %8s\n",
+        "opcode", "in pkts", "in bytes", "out pkts", "out bytes", "handled", "h.min", "h.mean", "h.p99", "h.max", "w.mean", "w.max", "errors");
+
+    for (uint32_t i = 0; i < MAX_OPCODES; i++)
+    {
+        OpcodeCounters &cnt = m_counters[i];
+        if (cnt.inPackets == 0 && cnt.outPackets == 0 && cnt.handled == 0 && cnt.parseErrors == 0)
+            continue;
+
+        OpcodeTelemetry tel = Summarize(cnt);
+
+        fprintf(f, "%6u %10llu %12llu %10llu %12llu %10llu %8u %8u %8u %8u %8u %8u %8llu\n", i,
+            (unsigned long long)tel.inPackets, (unsigned long long)tel.inBytes, (unsigned long long)tel.outPackets, (unsigned long long)tel.outBytes,
+            (unsigned long long)tel.handled, tel.handlerTimeMin, tel.handlerTimeMean, tel.handlerTimeP99, tel.handlerTimeMax,
+            tel.queueWaitMean, tel.queueWaitMax, (unsigned long long)tel.parseErrors);
+    }
+
+    fclose(f);
+
+    return true;
+}
@@ -0,0 +1,155 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_NETWORKTELEMETRY_H
+#define BW_NETWORKTELEMETRY_H
+
+#include "Opcodes.h"
+
+// count of handler time histogram buckets; bucket N holds times in range <2^(N-1), 2^N) microseconds
+#define TELEMETRY_HISTOGRAM_BUCKETS     32
+
+/*
+ * Structure containing raw telemetry counters of one opcode
+ */
+struct OpcodeCounters
+{
+    // count of received packets
+    uint64_t inPackets;
+    // count of received contents bytes
+    uint64_t inBytes;
+    // count of sent packets
+    uint64_t outPackets;
+    // count of sent contents bytes
+    uint64_t outBytes;
+    // count of handled packets
+    uint64_t handled;
+    // sum of handler times (us)
+    uint64_t handlerTimeTotal;
+    // the shortest handler time (us)
+    uint32_t handlerTimeMin;
+    // the longest handler time (us)
+    uint32_t handlerTimeMax;
+    // handler time histogram
+    uint32_t handlerTimeHistogram[TELEMETRY_HISTOGRAM_BUCKETS];
+    // sum of times between arrival and handling (ms)
+    uint64_t queueWaitTotal;
+    // the longest time between arrival and handling (ms)
+    uint32_t queueWaitMax;
+    // count of packets, which could not be parsed
+    uint64_t parseErrors;
+};
+
+/*
+ * Structure containing telemetry summary of one opcode
+ */
+struct OpcodeTelemetry
+{
+    // count of received packets
+    uint64_t inPackets;
+    // count of received contents bytes
+    uint64_t inBytes;
+    // count of sent packets
+    uint64_t outPackets;
+    // count of sent contents bytes
+    uint64_t outBytes;
+    // count of handled packets
+    uint64_t handled;
+    // count of packets, which could not be parsed
+    uint64_t parseErrors;
+    // the shortest handler time (us)
+    uint32_t handlerTimeMin;
+    // mean handler time (us)
+    uint32_t handlerTimeMean;
+    // 99th percentile of handler time (us), estimated from histogram
+    uint32_t handlerTimeP99;
+    // the longest handler time (us)
+    uint32_t handlerTimeMax;
+    // mean time between arrival and handling (ms)
+    uint32_t queueWaitMean;
+    // the longest time between arrival and handling (ms)
+    uint32_t queueWaitMax;
+};
+
+/*
+ * Structure containing round-trip time and clock synchronization summary
+ */
+struct ClockTelemetry
+{
+    // count of ping/pong samples
+    uint64_t samples;
+    // the shortest round-trip time (ms)
+    uint32_t rttMin;
+    // the longest round-trip time (ms)
+    uint32_t rttMax;
+    // current smoothed round-trip time (ms)
+    uint32_t rttSmoothed;
+    // current round-trip time jitter (ms)
+    uint32_t jitter;
+    // current server clock offset estimate (ms)
+    int32_t clockOffset;
+};
+
+/*
+ * Class collecting per-opcode network counters
+ */
+class NetworkTelemetry
+{
+    public:
+        NetworkTelemetry();
+
+        // resets all counters and starts new measurement period
+        void Reset();
+
+        // records received packet
+        void RecordInbound(uint16_t opcode, uint32_t size);
+        // records sent packet
+        void RecordOutbound(uint16_t opcode, uint32_t size);
+        // records handled packet with its handler time and time spent waiting in queue
+        void RecordHandled(uint16_t opcode, uint32_t handlerTime, uint32_t queueWait);
+        // records packet, which could not be parsed
+        void RecordParseError(uint16_t opcode);
+        // records ping/pong sample with current estimates
+        void RecordClockSample(uint32_t rtt, uint32_t smoothedRtt, uint32_t jitter, int32_t clockOffset);
+
+        // retrieves telemetry summary of specified opcode
+        OpcodeTelemetry GetOpcodeTelemetry(uint16_t opcode);
+        // retrieves round-trip time and clock synchronization summary
+        ClockTelemetry GetClockTelemetry();
+        // writes summary of all opcodes with any traffic to file
+        bool DumpToFile(const char* path);
+
+    protected:
+        // computes summary from raw counters; counters mutex has to be locked
+        OpcodeTelemetry Summarize(const OpcodeCounters &counters);
+        // estimates percentile value from histogram
+        static uint32_t GetHistogramPercentile(const uint32_t* histogram, uint64_t count, float percentile);
+
+    private:
+        // mutex for counters; inbound packets are recorded by network thread, the rest by main thread
+        std::mutex m_countersMtx;
+        // counters of all opcodes
+        OpcodeCounters m_counters[MAX_OPCODES];
+        // round-trip time and clock counters
+        ClockTelemetry m_clock;
+        // start of measurement period
+        uint32_t m_startTime;
+};
+
+#endif
@@ -84,6 +84,12 @@ enum Opcodes
     CP_INVENTORY_REMOVE_ITEM                    = 48,
     SP_ITEM_OPERATION_INFO                      = 49,
     SP_UPDATE_INVENTORY_SLOT                    = 50,
+    SP_CREATE_OBJECT_COMPACT                    = 51,
+    SP_UPDATE_OBJECT_COMPACT                    = 52,
+    CP_PING                                     = 53,
+    SP_PONG                                     = 54,
+    CP_RESUME_SESSION                           = 55,
+    SP_RESUME_SESSION_RESULT                    = 56,
     MAX_OPCODES
 };
 
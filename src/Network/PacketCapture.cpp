@@ -0,0 +1,197 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "PacketCapture.h"
+#include "Log.h"
+
+PacketCaptureWriter::PacketCaptureWriter()
+{
+    m_file = nullptr;
+    m_startTime = 0;
+    m_frameCount = 0;
+}
+
+PacketCaptureWriter::~PacketCaptureWriter()
+{
+    Close();
+}
+
+bool PacketCaptureWriter::Open(const char* path)
+{
+    std::unique_lock<std::mutex> lck(m_fileMtx);
+
+    if (m_file)
+        fclose(m_file);
+
+    m_file = fopen(path, "wb");
+    if (!m_file)
+    {
+        sLog->Error("Unable to open packet capture file %s for writing", path);
+        return false;
+    }
+
+    PacketCaptureFileHeader header;
+    header.magic = PACKET_CAPTURE_MAGIC;
+    header.version = PACKET_CAPTURE_VERSION;
+    fwrite(&header, sizeof(PacketCaptureFileHeader), 1, m_file);
+
+    m_startTime = getMSTime();
+    m_frameCount = 0;
+
+    sLog->Info("Capturing network traffic to %s", path);
+
+    return true;
+}
+
+void PacketCaptureWriter::Close()
+{
+    std::unique_lock<std::mutex> lck(m_fileMtx);
+
+    if (!m_file)
+        return;
+
+    fclose(m_file);
+    m_file = nullptr;
+
+    sLog->Info("Network traffic capture finished, %u frames written", m_frameCount);
+}
+
+bool PacketCaptureWriter::IsOpen()
+{
+    std::unique_lock<std::mutex> lck(m_fileMtx);
+
+    return (m_file != nullptr);
+}
+
+void PacketCaptureWriter::WriteFrame(PacketCaptureDirection direction, uint16_t opcode, uint32_t size, const uint8_t* data, uint32_t msTime)
+{
+    std::unique_lock<std::mutex> lck(m_fileMtx);
+
+    if (!m_file)
+        return;
+
+    PacketCaptureFrameHeader header;
+    header.time = getMSTimeDiff(m_startTime, msTime);
+    header.direction = (uint8_t)direction;
+    header.opcode = opcode;
+    header.size = size;
+
+    fwrite(&header, sizeof(PacketCaptureFrameHeader), 1, m_file);
+    if (size > 0)
+        fwrite(data, 1, size, m_file);
+
+    m_frameCount++;
+}
+
+uint32_t PacketCaptureWriter::GetFrameCount()
+{
+    std::unique_lock<std::mutex> lck(m_fileMtx);
+
+    return m_frameCount;
+}
+
+PacketCaptureReader::PacketCaptureReader()
+{
+    m_file = nullptr;
+    m_version = 0;
+}
+
+PacketCaptureReader::~PacketCaptureReader()
+{
+    Close();
+}
+
+bool PacketCaptureReader::Open(const char* path)
+{
+    Close();
+
+    m_file = fopen(path, "rb");
+    if (!m_file)
+    {
+        sLog->Error("Unable to open packet capture file %s for reading", path);
+        return false;
+    }
+
+    PacketCaptureFileHeader header;
+    if (fread(&header, sizeof(PacketCaptureFileHeader), 1, m_file) != 1 || header.magic != PACKET_CAPTURE_MAGIC)
+    {
+        sLog->Error("File %s is not valid packet capture file", path);
+        Close();
+        return false;
+    }
+
+    if (header.version != PACKET_CAPTURE_VERSION && header.version != PACKET_CAPTURE_VERSION_V1)
+    {
+        sLog->Error("Packet capture file %s has unsupported version %u", path, header.version);
+        Close();
+        return false;
+    }
+
+    m_version = header.version;
+
+    return true;
+}
+
+void PacketCaptureReader::Close()
+{
+    if (m_file)
+        fclose(m_file);
+    m_file = nullptr;
+}
+
+bool PacketCaptureReader::ReadFrameHeader(PacketCaptureFrameHeader &header)
+{
+    if (!m_file)
+        return false;
+
+    if (m_version == PACKET_CAPTURE_VERSION_V1)
+    {
+        PacketCaptureFrameHeaderV1 oldHeader;
+        if (fread(&oldHeader, sizeof(PacketCaptureFrameHeaderV1), 1, m_file) != 1)
+            return false;
+
+        header.time = oldHeader.time;
+        header.direction = oldHeader.direction;
+        header.opcode = oldHeader.opcode;
+        header.size = oldHeader.size;
+        return true;
+    }
+
+    return (fread(&header, sizeof(PacketCaptureFrameHeader), 1, m_file) == 1);
+}
+
+bool PacketCaptureReader::ReadFrameContents(uint8_t* dst, uint32_t size)
+{
+    if (!m_file)
+        return false;
+
+    if (size == 0)
+        return true;
+
+    return (fread(dst, 1, size, m_file) == size);
+}
+
+bool PacketCaptureReader::SkipFrameContents(uint32_t size)
+{
+    if (!m_file)
+        return false;
+
+    return (fseek(m_file, size, SEEK_CUR) == 0);
+}
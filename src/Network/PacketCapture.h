@@ -0,0 +1,146 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_PACKETCAPTURE_H
+#define BW_PACKETCAPTURE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <mutex>
+
+// capture file magic ("BWPC")
+#define PACKET_CAPTURE_MAGIC        0x43505742
+// capture file format version
+#define PACKET_CAPTURE_VERSION      2
+// capture file format version with 16bit frame contents size
+#define PACKET_CAPTURE_VERSION_V1   1
+
+// direction of captured frame
+enum PacketCaptureDirection
+{
+    CAPTURE_DIRECTION_INBOUND       = 0,
+    CAPTURE_DIRECTION_OUTBOUND      = 1,
+};
+
+// force alignment to 1 byte, the structures are stored to file as they are
+#if defined(__GNUC__)
+#pragma pack(1)
+#else
+#pragma pack(push,1)
+#endif
+
+/*
+ * Capture file header structure
+ */
+struct PacketCaptureFileHeader
+{
+    uint32_t magic;                         // magic identifier
+    uint32_t version;                       // file format version
+};
+
+/*
+ * Captured frame header structure, the frame contents follow
+ */
+struct PacketCaptureFrameHeader
+{
+    uint32_t time;                          // time since capture start (ms)
+    uint8_t direction;                      // frame direction (PacketCaptureDirection)
+    uint16_t opcode;                        // packet opcode
+    uint32_t size;                          // packet contents size
+};
+
+/*
+ * Captured frame header structure of version 1 files
+ */
+struct PacketCaptureFrameHeaderV1
+{
+    uint32_t time;                          // time since capture start (ms)
+    uint8_t direction;                      // frame direction (PacketCaptureDirection)
+    uint16_t opcode;                        // packet opcode
+    uint16_t size;                          // packet contents size
+};
+
+#if defined(__GNUC__)
+#pragma pack()
+#else
+#pragma pack(pop)
+#endif
+
+/*
+ * Class writing packet stream to capture file
+ */
+class PacketCaptureWriter
+{
+    public:
+        PacketCaptureWriter();
+        ~PacketCaptureWriter();
+
+        // opens (and truncates) capture file; capture time starts now
+        bool Open(const char* path);
+        // closes capture file
+        void Close();
+        // is capture file opened?
+        bool IsOpen();
+
+        // stores frame to capture file; may be called from any thread
+        void WriteFrame(PacketCaptureDirection direction, uint16_t opcode, uint32_t size, const uint8_t* data, uint32_t msTime);
+
+        // retrieves count of frames written to current file
+        uint32_t GetFrameCount();
+
+    private:
+        // mutex for file operations, inbound and outbound frames are written from different threads
+        std::mutex m_fileMtx;
+        // capture file
+        FILE* m_file;
+        // capture start time
+        uint32_t m_startTime;
+        // count of frames written
+        uint32_t m_frameCount;
+};
+
+/*
+ * Class reading packet stream from capture file
+ */
+class PacketCaptureReader
+{
+    public:
+        PacketCaptureReader();
+        ~PacketCaptureReader();
+
+        // opens capture file and validates its header; version 1 files are accepted as well
+        bool Open(const char* path);
+        // closes capture file
+        void Close();
+
+        // reads header of next frame; fails at the end of file
+        bool ReadFrameHeader(PacketCaptureFrameHeader &header);
+        // reads contents of frame, which header was read last
+        bool ReadFrameContents(uint8_t* dst, uint32_t size);
+        // skips contents of frame, which header was read last
+        bool SkipFrameContents(uint32_t size);
+
+    private:
+        // capture file
+        FILE* m_file;
+        // format version of opened file
+        uint32_t m_version;
+};
+
+#endif
@@ -36,6 +36,8 @@
 #include "Player.h"
 #include "Drawing.h"
 #include "ItemCacheStorage.h"
+#include "PacketStructures.h"
+#include "CompactObjectUpdate.h"
 
 #include <sstream>
 #include <iomanip>
@@ -52,15 +54,28 @@ void PacketHandlers::Handle_ServerSide(SmartPacket& packet)
 
 void PacketHandlers::HandleLoginResponse(SmartPacket& packet)
 {
-    uint8_t authState = packet.ReadUInt8();
+    StatusBlock authState;
+    if (!packet.Decode<StatusLayout>(authState))
+        return;
 
-    switch (authState)
+    switch (authState.status)
     {
         // everything OK, signal user and retrieve character list
         case AUTH_STATUS_OK:
+        {
+            // newer servers append content epoch; while it stays the same, verified content does not need verifying again
+            uint32_t contentEpoch = (packet.GetRemainingSize() >= sizeof(uint32_t)) ? packet.ReadUInt32() : 0;
+            sVerificationStorage->SetContentEpoch(contentEpoch);
+
+            // followed by protocol capabilities the server confirmed from our offer
+            uint32_t capabilities = (packet.GetRemainingSize() >= sizeof(uint32_t)) ? packet.ReadUInt32() : (uint32_t)PROTOCOL_CAP_NONE;
+            sNetwork->SetProtocolCapabilities(capabilities);
+            sLog->Debug("Server confirmed protocol capabilities 0x%X", capabilities);
+
             sNetwork->SetConnectionState(CONNECTION_STATE_LOBBY);
             sApplication->SignalGlobalEvent(GA_CONNECTION_FETCHING);
             break;
+        }
         // unknown user
         case AUTH_STATUS_UNKNOWN_USER:
             sNetwork->Disconnect();
@@ -87,20 +102,29 @@ void PacketHandlers::HandleLoginResponse(SmartPacket& packet)
 void PacketHandlers::HandleCharacterList(SmartPacket& packet)
 {
     CharacterListRecord* lrec;
+    CountBlock characters;
+    CharacterListGuidBlock guid;
+    CharacterListLevelBlock level;
 
-    uint8_t count = packet.ReadUInt8();
+    if (!packet.Decode<CountLayout>(characters))
+        return;
 
     // clear existing records
     sGameplay->ClearCharacterList();
 
     // read character list and put it into our list
-    for (size_t i = 0; i < count; i++)
+    for (uint32_t i = 0; i < characters.count; i++)
     {
-        lrec = new CharacterListRecord;
+        if (!packet.Decode<CharacterListGuidLayout>(guid))
+            return;
+        std::string name = packet.ReadString();
+        if (!packet.Decode<CharacterListLevelLayout>(level))
+            return;
 
-        lrec->guid = packet.ReadUInt32();
-        lrec->name = UTF8ToWString(packet.ReadString());
-        lrec->level = packet.ReadUInt16();
+        lrec = new CharacterListRecord;
+        lrec->guid = guid.guid;
+        lrec->name = UTF8ToWString(name);
+        lrec->level = level.level;
 
         sGameplay->AddCharacterToList(lrec);
     }
@@ -111,18 +135,24 @@ void PacketHandlers::HandleCharacterList(SmartPacket& packet)
 
 void PacketHandlers::HandleResourceSendStart(SmartPacket& packet)
 {
+    ResourceIdentifierBlock resource;
+
     std::string filename = packet.ReadString();
-    ResourceType type = (ResourceType)packet.ReadUInt8();
-    uint32_t id = packet.ReadUInt32();
+    if (!packet.Decode<ResourceIdentifierLayout>(resource))
+        return;
 
     // create resource stream and await further packets
-    sResourceStreamManager->CreateResourceStream(filename.c_str(), type, id);
+    sResourceStreamManager->CreateResourceStream(filename.c_str(), (ResourceType)resource.type, resource.id);
 }
 
 void PacketHandlers::HandleResourceSendFinished(SmartPacket& packet)
 {
-    ResourceType type = (ResourceType)packet.ReadUInt8();
-    uint32_t id = packet.ReadUInt32();
+    ResourceIdentifierBlock resource;
+    if (!packet.Decode<ResourceIdentifierLayout>(resource))
+        return;
+
+    ResourceType type = (ResourceType)resource.type;
+    uint32_t id = resource.id;
 
     sResourceStreamManager->FinishResourceStream(type, id);
 
@@ -134,45 +164,72 @@ void PacketHandlers::HandleResourceSendFinished(SmartPacket& packet)
 
 void PacketHandlers::HandleResourceData(SmartPacket& packet)
 {
-    ResourceType type = (ResourceType)packet.ReadUInt8();
-    uint32_t id = packet.ReadUInt32();
-    uint16_t size = packet.ReadUInt16();
-    uint8_t* data = new uint8_t[size];
+    ResourceDataLargeHeaderBlock header;
+    PacketSpan data;
 
-    // read bytes belonging to resource stream
-    for (size_t i = 0; i < size; i++)
-        data[i] = packet.ReadUInt8();
+    // with extended frames, the portion size is 32bit, so the whole resource could arrive at once
+    if (sNetwork->GetProtocolCapabilities() & PROTOCOL_CAP_LARGE_FRAMES)
+    {
+        if (!packet.Decode<ResourceDataLargeHeaderLayout>(header))
+            return;
+    }
+    else
+    {
+        ResourceDataHeaderBlock smallHeader;
+        if (!packet.Decode<ResourceDataHeaderLayout>(smallHeader))
+            return;
 
-    sResourceStreamManager->WriteToResourceStream(type, id, size, data);
+        header.type = smallHeader.type;
+        header.id = smallHeader.id;
+        header.size = smallHeader.size;
+    }
 
-    delete data;
+    // bytes belonging to resource stream are written straight from packet
+    if (!packet.ReadSpan(data, header.size))
+        return;
+
+    sResourceStreamManager->WriteToResourceStream((ResourceType)header.type, header.id, header.size, data.data);
 }
 
 void PacketHandlers::HandleResourceChecksumVerify(SmartPacket& packet)
 {
-    ResourceType type;
-    uint32_t id;
+    ResourceChecksumBatchBlock batch;
+    ResourceChecksumVerifyHeaderBlock header;
+    ResourceIdentifierBlock resource;
+    uint64_t pos;
+    std::set<uint64_t> failed;
+
+    // servers supporting it tell us, which batch is this; older ones reply in order of requests
+    batch.batchId = 0;
+    if ((sNetwork->GetProtocolCapabilities() & PROTOCOL_CAP_CHECKSUM_BATCH_ID) && !packet.Decode<ResourceChecksumBatchLayout>(batch))
+        return;
 
     // count of failed checksums
-    uint16_t failed_count = packet.ReadUInt16();
+    if (!packet.Decode<ResourceChecksumVerifyHeaderLayout>(header))
+        return;
 
-    for (int i = 0; i < failed_count; i++)
+    for (uint32_t i = 0; i < header.failedCount; i++)
     {
-        type = (ResourceType)packet.ReadUInt8();
-        id = packet.ReadUInt32();
+        if (!packet.Decode<ResourceIdentifierLayout>(resource))
+            return;
 
-        sLog->Debug("Checksum verify for resource type %u, id %u failed", type, id);
+        sLog->Debug("Checksum verify for resource type %u, id %u failed", (uint32_t)resource.type, resource.id);
 
-        // re-request resource if checksum does not match
-        sResourceManager->RequestResource(type, id);
+        pos = MAKE_RES_PAIR(resource.id, resource.type);
+        failed.insert(pos);
     }
+
+    // the rest of the verified batch is valid; failed resources are re-requested
+    sResourceStreamManager->SignalChecksumsVerified(batch.batchId, failed);
 }
 
 void PacketHandlers::HandleEnterWorldResult(SmartPacket& packet)
 {
-    uint8_t status = packet.ReadUInt8();
+    StatusBlock result;
+    if (!packet.Decode<StatusLayout>(result))
+        return;
 
-    if (status != ENTER_WORLD_OK)
+    if (result.status != ENTER_WORLD_OK)
     {
         // TODO: error message; this should not happen at all
         sApplication->SetStageType(STAGE_MENU);
@@ -180,59 +237,77 @@ void PacketHandlers::HandleEnterWorldResult(SmartPacket& packet)
     }
 
     // retrieve position
-    uint32_t mapId = packet.ReadUInt32();
-    float posX = packet.ReadFloat();
-    float posY = packet.ReadFloat();
+    EnterWorldPositionBlock position;
+    if (!packet.Decode<EnterWorldPositionLayout>(position))
+        return;
+
+    // servers supporting session resume append token, which lets us return to this session after losing connection
+    uint64_t resumeToken = 0;
+    if ((sNetwork->GetProtocolCapabilities() & PROTOCOL_CAP_SESSION_RESUME) && packet.GetRemainingSize() >= sizeof(uint64_t))
+        resumeToken = packet.ReadUInt64();
+    sGameplay->SetResumeToken(resumeToken);
 
     // create local player object
-    sGameplay->CreatePlayer(mapId, posX, posY);
+    sGameplay->CreatePlayer(position.mapId, position.posX, position.posY);
 }
 
 void PacketHandlers::HandleCreateObject(SmartPacket& packet)
 {
-    uint64_t guid;
+    CountBlock objects;
+    CreateObjectHeaderBlock header;
+    CreateObjectPositionBlock position;
+    CreateObjectMovementBlock movement;
+    PacketSpan fieldData;
     uint32_t fieldCount;
-    uint8_t count = packet.ReadUInt8();
+
+    // updatefields buffer is reused between packets, handlers are called only from main thread
+    static std::vector<uint32_t> tmpFields;
+
+    if (!packet.Decode<CountLayout>(objects))
+        return;
 
     WorldObject* obj;
 
     // read objects from packet
-    for (uint32_t i = 0; i < count; i++)
+    for (uint32_t i = 0; i < objects.count; i++)
     {
-        // GUID
-        guid = packet.ReadUInt64();
-        // count of updatefields
-        fieldCount = packet.ReadUInt32();
+        // GUID and count of updatefields
+        if (!packet.Decode<CreateObjectHeaderLayout>(header))
+            return;
+
+        // validate the count against packet contents before allocating anything for it
+        if (!packet.ReadSpan(fieldData, (uint32_t)num_min((uint64_t)header.fieldCount * sizeof(uint32_t), (uint64_t)UINT32_MAX)))
+            return;
 
-        // allocate and retrieve fields
-        uint32_t* tmpFields = new uint32_t[fieldCount];
+        if (header.fieldCount > tmpFields.size())
+            tmpFields.resize(header.fieldCount);
 
-        for (uint32_t j = 0; j < fieldCount; j++)
-            tmpFields[j] = packet.ReadUInt32();
+        for (uint32_t f = 0; f < header.fieldCount; f++)
+            tmpFields[f] = PacketFieldCodec<uint32_t>::Decode(fieldData.data + f * sizeof(uint32_t));
+
+        // read position
+        if (!packet.Decode<CreateObjectPositionLayout>(position))
+            return;
 
         // if the create block does not identify local player...
-        if (guid != sGameplay->GetPlayer()->GetGUID())
+        if (header.guid != sGameplay->GetPlayer()->GetGUID())
         {
             // create object
-            obj = sGameplay->CreateForeignObject(guid);
-            // apply updatefields
-            obj->ApplyValueSet((uint8_t*)tmpFields, fieldCount * sizeof(uint32_t));
+            obj = sGameplay->CreateForeignObject(header.guid);
+            // apply updatefields; fields unknown to this object type are ignored
+            fieldCount = num_min(header.fieldCount, obj->GetUpdateFieldCount());
+            obj->ApplyValueSet((uint8_t*)tmpFields.data(), fieldCount * sizeof(uint32_t));
+            obj->ProcessFieldChanges();
 
-            // read position
-            float x = packet.ReadFloat();
-            float y = packet.ReadFloat();
             // set position
-            obj->SetPosition(x, y);
+            obj->SetPosition(position.x, position.y);
 
             // if it's creature or player
             if (obj->GetType() == OTYPE_CREATURE || obj->GetType() == OTYPE_PLAYER)
             {
-                // read movement info
-                uint8_t moveMask = packet.ReadUInt8();
-                // apply movement info
-                for (uint8_t i = 0; i <= 3; i++)
-                    if (((1 << i) & moveMask) != 0)
-                        obj->ToUnit()->StartMovementInDirection((MoveDirectionElement)(1 << i));
+                // read movement info and start interpolating from this point
+                if (packet.Decode<CreateObjectMovementLayout>(movement))
+                    obj->ToUnit()->AddMovementSnapshot(sNetwork->GetHandledPacketArrivalTime(), position.x, position.y, movement.moveMask);
             }
 
             // add to map
@@ -241,49 +316,126 @@ void PacketHandlers::HandleCreateObject(SmartPacket& packet)
         else
         {
             // dummy read
-            packet.ReadFloat();
-            packet.ReadFloat();
-            packet.ReadUInt8();
+            packet.Decode<CreateObjectMovementLayout>(movement);
 
             // apply updatefields
-            sGameplay->GetPlayer()->ApplyValueSet((uint8_t*)tmpFields, fieldCount * sizeof(uint32_t));
+            fieldCount = num_min(header.fieldCount, sGameplay->GetPlayer()->GetUpdateFieldCount());
+            sGameplay->GetPlayer()->ApplyValueSet((uint8_t*)tmpFields.data(), fieldCount * sizeof(uint32_t));
+            sGameplay->GetPlayer()->ProcessFieldChanges();
         }
 
         sDrawing->SetCanvasRedrawFlag();
 
-        delete tmpFields;
+        // the rest of packet would be misaligned
+        if (packet.HasReadError())
+            return;
     }
 }
 
 void PacketHandlers::HandleUpdateObject(SmartPacket& packet)
 {
-    uint64_t guid = packet.ReadUInt64();
+    UpdateObjectHeaderBlock header;
+    UpdateObjectFieldBlock fields[UINT8_MAX];
+
+    if (!packet.Decode<UpdateObjectHeaderLayout>(header))
+        return;
+
     // find object
-    WorldObject* obj = sGameplay->GetForeignObject(guid);
+    WorldObject* obj = sGameplay->GetForeignObject(header.guid);
     if (!obj)
         return;
 
-    uint32_t field, value;
-
-    uint8_t count = packet.ReadUInt8();
+    // read all fields at once
+    if (!packet.DecodeRepeated<UpdateObjectFieldLayout>(fields, header.count))
+        return;
 
     // update every field server sent
-    for (uint8_t pos = 0; pos < count; pos++)
+    for (uint8_t pos = 0; pos < header.count; pos++)
+        obj->SetUInt32Value(fields[pos].field, fields[pos].value);
+
+    // refresh derived values and redraw only if something visible changed
+    if (obj->ProcessFieldChanges())
+        sDrawing->SetCanvasRedrawFlag();
+}
+
+void PacketHandlers::HandleCreateObjectCompact(SmartPacket& packet)
+{
+    CountBlock objects;
+    CreateObjectCompactHeaderBlock header;
+    float x, y;
+
+    if (!packet.Decode<CountLayout>(objects))
+        return;
+
+    WorldObject* obj;
+
+    for (uint32_t i = 0; i < objects.count; i++)
     {
-        field = packet.ReadUInt32();
-        value = packet.ReadUInt32();
+        // GUID, movement mask and position
+        if (!packet.Decode<CreateObjectCompactHeaderLayout>(header) || !CompactObjectUpdate::ReadPosition(packet, x, y))
+            return;
 
-        obj->SetUInt32Value(field, value);
+        // local player gets only its updatefields refreshed
+        if (header.guid == sGameplay->GetPlayer()->GetGUID())
+        {
+            if (!CompactObjectUpdate::ReadFields(packet, sGameplay->GetPlayer(), false))
+                return;
+
+            sGameplay->GetPlayer()->ProcessFieldChanges();
+            sDrawing->SetCanvasRedrawFlag();
+            continue;
+        }
+
+        // fields are decoded straight to the new object
+        obj = sGameplay->CreateForeignObject(header.guid);
+        if (!CompactObjectUpdate::ReadFields(packet, obj, false))
+        {
+            delete obj;
+            return;
+        }
+        obj->ProcessFieldChanges();
+
+        obj->SetPosition(x, y);
+
+        // start interpolating movement of creatures and players from this point
+        if (obj->GetType() == OTYPE_CREATURE || obj->GetType() == OTYPE_PLAYER)
+            obj->ToUnit()->AddMovementSnapshot(sNetwork->GetHandledPacketArrivalTime(), x, y, header.moveMask);
+
+        sGameplay->GetMap()->AddWorldObject(obj);
+
+        sDrawing->SetCanvasRedrawFlag();
     }
+}
 
-    // most likely something happened that would need redraw
-    sDrawing->SetCanvasRedrawFlag();
+void PacketHandlers::HandleUpdateObjectCompact(SmartPacket& packet)
+{
+    CountBlock objects;
+    UpdateObjectCompactHeaderBlock header;
+    WorldObject* obj;
+
+    if (!packet.Decode<CountLayout>(objects))
+        return;
+
+    for (uint32_t i = 0; i < objects.count; i++)
+    {
+        if (!packet.Decode<UpdateObjectCompactHeaderLayout>(header))
+            return;
+
+        // differences of unknown object are skipped, so the rest of packet stays aligned
+        obj = sGameplay->GetForeignObject(header.guid);
+        if (!CompactObjectUpdate::ReadFields(packet, obj, true))
+            return;
+
+        // refresh derived values and redraw only if something visible changed
+        if (obj && obj->ProcessFieldChanges())
+            sDrawing->SetCanvasRedrawFlag();
+    }
 }
 
 void PacketHandlers::HandleDestroyObject(SmartPacket& packet)
 {
-    uint8_t count = packet.ReadUInt8();
-    uint64_t guid;
+    CountBlock objects;
+    DestroyObjectBlock destroyed[UINT8_MAX];
 
     WorldObject* obj;
     // map has to to exist
@@ -292,14 +444,15 @@ void PacketHandlers::HandleDestroyObject(SmartPacket& packet)
         return;
 
     // read objects to be destroyed
-    for (uint8_t i = 0; i < count; i++)
+    if (!packet.Decode<CountLayout>(objects) || !packet.DecodeRepeated<DestroyObjectLayout>(destroyed, objects.count))
+        return;
+
+    for (uint8_t i = 0; i < objects.count; i++)
     {
-        // read guid and destroy it from map
-        guid = packet.ReadUInt64();
-        obj = sGameplay->GetForeignObject(guid);
+        obj = sGameplay->GetForeignObject(destroyed[i].guid);
 
         // remove from map
-        map->RemoveWorldObject(guid);
+        map->RemoveWorldObject(destroyed[i].guid);
 
         // cleanup
         if (obj)
@@ -312,36 +465,44 @@ void PacketHandlers::HandleDestroyObject(SmartPacket& packet)
 void PacketHandlers::HandleMapMetadata(SmartPacket& packet)
 {
     std::string name, filename;
+    StatusBlock result;
+    MapMetadataHeaderBlock header;
+    MapMetadataFieldsBlock fields;
 
     // create an nullify map header structure
     MapHeader mh;
     memset(&mh, 0, sizeof(MapHeader));
 
     // read status
-    uint8_t status = packet.ReadUInt8();
+    if (!packet.Decode<StatusLayout>(result))
+        return;
     // has to be OK, otherwise we can't load map
-    if (status != GENERIC_STATUS_OK)
+    if (result.status != GENERIC_STATUS_OK)
         return;
 
+    // read basic info
+    if (!packet.Decode<MapMetadataHeaderLayout>(header))
+        return;
+    name = packet.ReadString();
+    if (!packet.Decode<MapMetadataFieldsLayout>(fields))
+        return;
+    filename = packet.ReadString();
+
     // set map header magic
     mh.mapVersionMagic = MAP_VERSION_MAGIC;
-    // read basic info
-    mh.mapId = packet.ReadUInt32();
-    mh.sizeX = packet.ReadUInt32();
-    mh.sizeY = packet.ReadUInt32();
+    mh.mapId = header.mapId;
+    mh.sizeX = header.sizeX;
+    mh.sizeY = header.sizeY;
 
-    name = packet.ReadString();
     memset(mh.name, 0, MAP_NAME_LENGTH);
-    for (int i = 0; i < name.length() && i < MAP_NAME_LENGTH; i++)
+    for (size_t i = 0; i < name.length() && i < MAP_NAME_LENGTH; i++)
         mh.name[i] = name.at(i);
 
-    mh.entryX = packet.ReadUInt32();
-    mh.entryY = packet.ReadUInt32();
-    mh.defaultFieldType = packet.ReadUInt16();
-    mh.defaultFieldTexture = packet.ReadUInt32();
-    mh.defaultFieldFlags = packet.ReadUInt32();
-
-    filename = packet.ReadString();
+    mh.entryX = fields.entryX;
+    mh.entryY = fields.entryY;
+    mh.defaultFieldType = fields.defaultFieldType;
+    mh.defaultFieldTexture = fields.defaultFieldTexture;
+    mh.defaultFieldFlags = fields.defaultFieldFlags;
 
     // get header CRC32 checksum
     uint32_t crc = CRC32_Bytes((uint8_t*)&mh, sizeof(MapHeader));
@@ -360,12 +521,14 @@ void PacketHandlers::HandleMapMetadata(SmartPacket& packet)
 
 void PacketHandlers::HandleMapChunk(SmartPacket& packet)
 {
-    uint8_t status;
-    uint32_t mapId, startX, startY, sizeX, sizeY;
+    StatusBlock result;
+    MapChunkHeaderBlock header;
+
+    if (!packet.Decode<StatusLayout>(result))
+        return;
 
-    status = packet.ReadUInt8();
     // status has to be OK, otherwise chunk does not exist and we cannot load it
-    if (status != GENERIC_STATUS_OK)
+    if (result.status != GENERIC_STATUS_OK)
     {
         sLog->Error("Could not load requested map chunk");
         // TODO: some intelligent behaviour
@@ -373,15 +536,21 @@ void PacketHandlers::HandleMapChunk(SmartPacket& packet)
     }
 
     // load metadata
-    mapId = packet.ReadUInt32();
-    startX = packet.ReadUInt32();
-    startY = packet.ReadUInt32();
-    sizeX = packet.ReadUInt32();
-    sizeY = packet.ReadUInt32();
+    if (!packet.Decode<MapChunkHeaderLayout>(header))
+        return;
+
+    uint32_t mapId = header.mapId, startX = header.startX, startY = header.startY, sizeX = header.sizeX, sizeY = header.sizeY;
 
     Map* map = sGameplay->GetMap();
     MapField mf;
+    MapChunkFieldBlock field;
+    PacketSpan fields;
 
+    // all fields are validated at once and decoded straight from packet
+    if (!packet.ReadSpan(fields, (uint32_t)num_min((uint64_t)sizeX * sizeY * MapChunkFieldLayout::Size, (uint64_t)UINT32_MAX)))
+        return;
+
+    const uint8_t* src = fields.data;
     uint32_t crc = 0;
 
     // read fields
@@ -389,11 +558,14 @@ void PacketHandlers::HandleMapChunk(SmartPacket& packet)
     {
         for (uint32_t j = 0; j < sizeY; j++)
         {
+            MapChunkFieldLayout::DecodeFields(field, src);
+            src += MapChunkFieldLayout::Size;
+
             // nullify structure (due to padding, it also counts to CRC)
             memset(&mf, 0, sizeof(MapField));
-            mf.type = packet.ReadUInt16();
-            mf.texture = packet.ReadUInt32();
-            mf.flags = packet.ReadUInt32();
+            mf.type = field.type;
+            mf.texture = field.texture;
+            mf.flags = field.flags;
 
             // calculate CRC32
             crc = CRC32_Bytes_Continuous((uint8_t*)&mf, sizeof(MapField), crc);
@@ -420,38 +592,41 @@ void PacketHandlers::HandleMapChunk(SmartPacket& packet)
 
 void PacketHandlers::HandleMapMetaChecksumVerify(SmartPacket& packet)
 {
-    uint8_t status = packet.ReadUInt8();
-    uint32_t mapId = packet.ReadUInt32();
+    MapMetaChecksumVerifyBlock result;
+    if (!packet.Decode<MapMetaChecksumVerifyLayout>(result))
+        return;
 
     // if map meta checksum OK, signal map load
-    if (status == GENERIC_STATUS_OK)
-        sGameplay->SignalMapLoaded(mapId);
+    if (result.status == GENERIC_STATUS_OK)
+        sGameplay->SignalMapLoaded(result.mapId);
     else // otherwise re-request map metadata
-        sGameplay->SendRequestMapMetadata(mapId);
+        sGameplay->SendRequestMapMetadata(result.mapId);
 }
 
 void PacketHandlers::HandleMapChunkChecksumVerify(SmartPacket& packet)
 {
-    uint8_t status = packet.ReadUInt8();
-    uint32_t mapId = packet.ReadUInt32();
-    uint32_t startX = packet.ReadUInt32();
-    uint32_t startY = packet.ReadUInt32();
+    MapChunkChecksumVerifyBlock result;
+    if (!packet.Decode<MapChunkChecksumVerifyLayout>(result))
+        return;
 
     // if chunk checksum OK, signal chunk load
-    if (status == GENERIC_STATUS_OK)
-        sGameplay->SignalChunkLoaded(startX, startY);
+    if (result.status == GENERIC_STATUS_OK)
+        sGameplay->SignalChunkLoaded(result.startX, result.startY);
     else // otherwise re-request chunk
-        sGameplay->SendRequestMapChunk(mapId, startX, startY);
+        sGameplay->SendRequestMapChunk(result.mapId, result.startX, result.startY);
 }
 
 void PacketHandlers::HandleImageMetadata(SmartPacket& packet)
 {
-    uint32_t id, sizeX, sizeY, baseCenterX, baseCenterY, collisionX1, collisionY1, collisionX2, collisionY2, animCount;
-    uint32_t animId, frameBegin, frameEnd, frameDelay;
+    StatusBlock result;
+    ImageMetadataBlock meta;
+    ImageAnimationBlock anim;
+
+    if (!packet.Decode<StatusLayout>(result))
+        return;
 
-    uint8_t status = packet.ReadUInt8();
     // status has to be OK, otherwise we cannot load it
-    if (status != GENERIC_STATUS_OK)
+    if (result.status != GENERIC_STATUS_OK)
     {
         sLog->Error("Could not load requested image metadata");
         // TODO: some intelligent behaviour
@@ -460,51 +635,39 @@ void PacketHandlers::HandleImageMetadata(SmartPacket& packet)
 
     uint32_t crc = 0;
 
-    // read meta
-    id = packet.ReadUInt32();
-    sizeX = packet.ReadUInt32();
-    sizeY = packet.ReadUInt32();
-    baseCenterX = packet.ReadUInt32();
-    baseCenterY = packet.ReadUInt32();
-    collisionX1 = packet.ReadUInt32();
-    collisionY1 = packet.ReadUInt32();
-    collisionX2 = packet.ReadUInt32();
-    collisionY2 = packet.ReadUInt32();
+    // read meta along with animation count
+    if (!packet.Decode<ImageMetadataLayout>(meta))
+        return;
 
     // perform checksum on metadata
-    crc = CRC32_Bytes_Continuous((uint8_t*)&id, sizeof(uint32_t), crc);
-    crc = CRC32_Bytes_Continuous((uint8_t*)&sizeX, sizeof(uint32_t), crc);
-    crc = CRC32_Bytes_Continuous((uint8_t*)&sizeY, sizeof(uint32_t), crc);
-    crc = CRC32_Bytes_Continuous((uint8_t*)&baseCenterX, sizeof(uint32_t), crc);
-    crc = CRC32_Bytes_Continuous((uint8_t*)&baseCenterY, sizeof(uint32_t), crc);
-    crc = CRC32_Bytes_Continuous((uint8_t*)&collisionX1, sizeof(uint32_t), crc);
-    crc = CRC32_Bytes_Continuous((uint8_t*)&collisionY1, sizeof(uint32_t), crc);
-    crc = CRC32_Bytes_Continuous((uint8_t*)&collisionX2, sizeof(uint32_t), crc);
-    crc = CRC32_Bytes_Continuous((uint8_t*)&collisionY2, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&meta.id, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&meta.sizeX, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&meta.sizeY, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&meta.baseCenterX, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&meta.baseCenterY, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&meta.collisionX1, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&meta.collisionY1, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&meta.collisionX2, sizeof(uint32_t), crc);
+    crc = CRC32_Bytes_Continuous((uint8_t*)&meta.collisionY2, sizeof(uint32_t), crc);
 
     // wipe existing metadata
-    sImageStorage->WipeImageMetadata(id);
-
-    // animation count
-    animCount = packet.ReadUInt32();
+    sImageStorage->WipeImageMetadata(meta.id);
 
     // read anim metadata
-    for (uint32_t i = 0; i < animCount; i++)
+    for (uint32_t i = 0; i < meta.animCount; i++)
     {
         // read data
-        animId = packet.ReadUInt32();
-        frameBegin = packet.ReadUInt32();
-        frameEnd = packet.ReadUInt32();
-        frameDelay = packet.ReadUInt32();
+        if (!packet.Decode<ImageAnimationLayout>(anim))
+            return;
 
         // perform checksum
-        crc = CRC32_Bytes_Continuous((uint8_t*)&animId, sizeof(uint32_t), crc);
-        crc = CRC32_Bytes_Continuous((uint8_t*)&frameBegin, sizeof(uint32_t), crc);
-        crc = CRC32_Bytes_Continuous((uint8_t*)&frameEnd, sizeof(uint32_t), crc);
-        crc = CRC32_Bytes_Continuous((uint8_t*)&frameDelay, sizeof(uint32_t), crc);
+        crc = CRC32_Bytes_Continuous((uint8_t*)&anim.animId, sizeof(uint32_t), crc);
+        crc = CRC32_Bytes_Continuous((uint8_t*)&anim.frameBegin, sizeof(uint32_t), crc);
+        crc = CRC32_Bytes_Continuous((uint8_t*)&anim.frameEnd, sizeof(uint32_t), crc);
+        crc = CRC32_Bytes_Continuous((uint8_t*)&anim.frameDelay, sizeof(uint32_t), crc);
 
         // insert animation record to local file storage
-        sImageStorage->InsertImageAnimationRecord(id, animId, frameBegin, frameEnd, frameDelay, (uint32_t)time(nullptr));
+        sImageStorage->InsertImageAnimationRecord(meta.id, anim.animId, anim.frameBegin, anim.frameEnd, anim.frameDelay, (uint32_t)time(nullptr));
     }
 
     // finalize CRC32 calculation
@@ -513,152 +676,157 @@ void PacketHandlers::HandleImageMetadata(SmartPacket& packet)
     std::string checksum = GetCRC32String(crc);
 
     // insert metadata parent record to local file database
-    sImageStorage->InsertImageMetadataRecord(id, sizeX, sizeY, baseCenterX, baseCenterY, collisionX1, collisionY1, collisionX2, collisionY2, checksum.c_str(), (uint32_t)time(nullptr));
+    sImageStorage->InsertImageMetadataRecord(meta.id, meta.sizeX, meta.sizeY, meta.baseCenterX, meta.baseCenterY, meta.collisionX1, meta.collisionY1,
+        meta.collisionX2, meta.collisionY2, checksum.c_str(), (uint32_t)time(nullptr));
 
     // send metadata checksum verify packet
-    sResourceStreamManager->SendVerifyMetadataChecksumPacket(RSTYPE_IMAGE, id, checksum.c_str());
+    sResourceStreamManager->SendVerifyMetadataChecksumPacket(RSTYPE_IMAGE, meta.id, checksum.c_str());
 }
 
 void PacketHandlers::HandleImageMetaChecksumVerify(SmartPacket& packet)
 {
-    uint8_t status = packet.ReadUInt8();
-    uint32_t id = packet.ReadUInt32();
+    ImageMetaChecksumVerifyBlock result;
+    if (!packet.Decode<ImageMetaChecksumVerifyLayout>(result))
+        return;
 
-    // if OK, signal resource metadata retrieval to allow loading
-    if (status == GENERIC_STATUS_OK)
-        sResourceManager->SignalResourceMetadataRetrieved(RSTYPE_IMAGE, id);
-    else // otherwise request again
-        sResourceManager->RequestResourceMetadata(RSTYPE_IMAGE, id);
+    // if OK, resource metadata loading is allowed, otherwise they are requested again
+    sResourceStreamManager->SignalMetadataChecksumVerified(RSTYPE_IMAGE, result.id, result.status == GENERIC_STATUS_OK);
 }
 
 void PacketHandlers::HandleNameQueryResponse(SmartPacket& packet)
 {
-    uint64_t guid = packet.ReadUInt64();
+    NameQueryResponseHeaderBlock header;
+    if (!packet.Decode<NameQueryResponseHeaderLayout>(header))
+        return;
+
     std::string name = packet.ReadString();
 
     // just pass the reply to gameplay class
-    sGameplay->SignalNameQueryResolved(guid, (name.length() == 0) ? L"???" : UTF8ToWString(name).c_str());
+    sGameplay->SignalNameQueryResolved(header.guid, (name.length() == 0) ? L"???" : UTF8ToWString(name).c_str());
 }
 
 void PacketHandlers::HandleMoveStartDir(SmartPacket& packet)
 {
-    uint64_t guid = packet.ReadUInt64();
-    uint8_t dir = packet.ReadUInt8();
+    MoveStartDirBlock move;
+    if (!packet.Decode<MoveStartDirLayout>(move))
+        return;
 
     // ignore updates about self, we handle it our way
-    if (sGameplay->GetPlayer()->GetGUID() == guid)
+    if (sGameplay->GetPlayer()->GetGUID() == move.guid)
         return;
 
     // retrieve foreign object
-    WorldObject* target = sGameplay->GetForeignObject(guid);
+    WorldObject* target = sGameplay->GetForeignObject(move.guid);
     if (!target || (target->GetType() != OTYPE_PLAYER && target->GetType() != OTYPE_CREATURE))
         return;
 
-    // pass the event
-    target->ToUnit()->StartMovementInDirection((MoveDirectionElement)dir);
+    // pass the event; position is extrapolated from the last known one
+    Unit* unit = target->ToUnit();
+    unit->AddMovementSnapshot(sNetwork->GetHandledPacketArrivalTime(), unit->GetLatestMoveMask() | move.dir);
 }
 
 void PacketHandlers::HandleMoveStopDir(SmartPacket& packet)
 {
-    uint64_t guid = packet.ReadUInt64();
-    uint8_t dir = packet.ReadUInt8();
-    float x = packet.ReadFloat();
-    float y = packet.ReadFloat();
+    MoveStopDirBlock move;
+    if (!packet.Decode<MoveStopDirLayout>(move))
+        return;
 
     // ignore updates about self, we handle it our way
-    if (sGameplay->GetPlayer()->GetGUID() == guid)
+    if (sGameplay->GetPlayer()->GetGUID() == move.guid)
         return;
 
     // retrieve foreign object
-    WorldObject* target = sGameplay->GetForeignObject(guid);
+    WorldObject* target = sGameplay->GetForeignObject(move.guid);
     if (!target || (target->GetType() != OTYPE_PLAYER && target->GetType() != OTYPE_CREATURE))
         return;
 
-    // update position and stop movement in that way
-    target->SetPosition(x, y);
-    target->ToUnit()->StopMovementInDirection((MoveDirectionElement)dir);
+    // store position and stop movement in that way
+    Unit* unit = target->ToUnit();
+    unit->AddMovementSnapshot(sNetwork->GetHandledPacketArrivalTime(), move.x, move.y, unit->GetLatestMoveMask() & ~move.dir);
 }
 
 void PacketHandlers::HandleMoveHeartbeat(SmartPacket& packet)
 {
-    uint64_t guid = packet.ReadUInt64();
-    uint8_t moveMask = packet.ReadUInt8();
-    float x = packet.ReadFloat();
-    float y = packet.ReadFloat();
+    MoveHeartbeatBlock move;
+    if (!packet.Decode<MoveHeartbeatLayout>(move))
+        return;
 
     // ignore updates about self, we handle it our way
-    if (sGameplay->GetPlayer()->GetGUID() == guid)
+    if (sGameplay->GetPlayer()->GetGUID() == move.guid)
         return;
 
     // retrieve foreign object
-    WorldObject* target = sGameplay->GetForeignObject(guid);
+    WorldObject* target = sGameplay->GetForeignObject(move.guid);
     if (!target || (target->GetType() != OTYPE_PLAYER && target->GetType() != OTYPE_CREATURE))
         return;
 
-    // update position
-    target->SetPosition(x, y);
-
-    // TODO: something with moveMask ?
+    // store position along with movement mask, which corrects possibly lost start/stop packets
+    target->ToUnit()->AddMovementSnapshot(sNetwork->GetHandledPacketArrivalTime(), move.x, move.y, move.moveMask);
 }
 
 void PacketHandlers::HandleChatMessage(SmartPacket& packet)
 {
-    uint8_t type = packet.ReadUInt8();
-    uint64_t guid = packet.ReadUInt64();
-    std::string msg = packet.ReadString();
+    ChatMessageHeaderBlock header;
+    if (!packet.Decode<ChatMessageHeaderLayout>(header))
+        return;
 
-    std::wstring wmsg = UTF8ToWString(msg);
+    TalkType type = (TalkType)header.type;
+    std::wstring wmsg = UTF8ToWString(packet.ReadString());
 
     // server messages have its own behaviour
     if (type != TALK_SERVER_MESSAGE)
     {
         // retrieve talk unit
-        WorldObject* talkunit = sGameplay->GetForeignObject(guid);
+        WorldObject* talkunit = sGameplay->GetForeignObject(header.guid);
         if (talkunit && (talkunit->GetType() == OTYPE_CREATURE || talkunit->GetType() == OTYPE_PLAYER))
         {
             // talk and add to history
-            talkunit->ToUnit()->Talk((TalkType)type, wmsg.c_str());
-            sGameplay->AddChatMessage((TalkType)type, talkunit->GetName(), wmsg.c_str());
+            talkunit->ToUnit()->Talk(type, wmsg.c_str());
+            sGameplay->AddChatMessage(type, talkunit->GetName(), wmsg.c_str());
         }
     }
     else
     {
-        sGameplay->AddChatMessage((TalkType)type, nullptr, wmsg.c_str());
+        sGameplay->AddChatMessage(type, nullptr, wmsg.c_str());
     }
 }
 
 void PacketHandlers::HandleDialogueData(SmartPacket& packet)
 {
-    uint64_t sourceGuid = packet.ReadUInt64();
-    uint8_t dialogueState = packet.ReadUInt8();
+    DialogueDataHeaderBlock header;
+    if (!packet.Decode<DialogueDataHeaderLayout>(header))
+        return;
 
     // "wait" means the server will signal us when something new happens
-    if (dialogueState == DIALOGUE_WAIT)
+    if (header.state == DIALOGUE_WAIT)
     {
-        sGameplay->StartOrResetDialogue(sourceGuid, L"Probh rozhovor...");
+        sGameplay->StartOrResetDialogue(header.sourceGuid, L"Probh rozhovor...");
     }
     // "decide" means we have to choose an alternative
-    else if (dialogueState == DIALOGUE_DECIDE)
+    else if (header.state == DIALOGUE_DECIDE)
     {
         std::string headerText = packet.ReadString();
         std::wstring wmsg = UTF8ToWString(headerText);
 
         // this will start a new dialogue or reuse old one
-        sGameplay->StartOrResetDialogue(sourceGuid, wmsg.c_str());
+        sGameplay->StartOrResetDialogue(header.sourceGuid, wmsg.c_str());
 
-        uint32_t id;
+        CountBlock decisions;
+        DialogueDecisionBlock decision;
         std::string decString;
 
         // read all received decisions
-        uint8_t count = packet.ReadUInt8();
-        for (uint8_t i = 0; i < count; i++)
+        if (!packet.Decode<CountLayout>(decisions))
+            return;
+        for (uint32_t i = 0; i < decisions.count; i++)
         {
-            id = packet.ReadUInt32();
+            if (!packet.Decode<DialogueDecisionLayout>(decision))
+                return;
             decString = packet.ReadString();
             wmsg = UTF8ToWString(decString);
 
             // and put them to dialogue
-            sGameplay->AddDialogueDecision(id, wmsg.c_str());
+            sGameplay->AddDialogueDecision(decision.id, wmsg.c_str());
         }
     }
 }
@@ -672,63 +840,112 @@ void PacketHandlers::HandleDialogueClose(SmartPacket& packet)
 
 void PacketHandlers::HandleInventory(SmartPacket& packet)
 {
-    uint32_t guid, id, stackcount;
+    InventoryItemGuidBlock item;
+    InventorySlotContentsBlock contents;
+
     sGameplay->ClearInventoryRecords();
 
     for (uint32_t i = 0; i < CHARACTER_INVENTORY_SLOTS; i++)
     {
-        guid = packet.ReadUInt32();
-        if (!guid)
+        if (!packet.Decode<InventoryItemGuidLayout>(item))
+            return;
+        if (!item.guid)
             continue;
 
-        id = packet.ReadUInt32();
-        stackcount = packet.ReadUInt32();
+        if (!packet.Decode<InventorySlotContentsLayout>(contents))
+            return;
 
-        sGameplay->SetInventorySlotContents(i, guid, id, stackcount);
+        sGameplay->SetInventorySlotContents(i, item.guid, contents.id, contents.count);
     }
 }
 
 void PacketHandlers::HandleItemQueryResponse(SmartPacket& packet)
 {
-    uint8_t status = packet.ReadUInt8();
-    if (status != GENERIC_STATUS_OK)
+    StatusBlock result;
+    ItemQueryHeaderBlock header;
+    ItemQueryPropertiesBlock properties;
+
+    if (!packet.Decode<StatusLayout>(result) || result.status != GENERIC_STATUS_OK)
         return;
 
-    uint32_t id = packet.ReadUInt32();
-    uint32_t imageId = packet.ReadUInt32();
+    if (!packet.Decode<ItemQueryHeaderLayout>(header))
+        return;
     std::wstring name = UTF8ToWString(packet.ReadString());
     std::wstring description = UTF8ToWString(packet.ReadString());
-    uint32_t stackSize = packet.ReadUInt32();
-    uint32_t rarity = packet.ReadUInt32();
+    if (!packet.Decode<ItemQueryPropertiesLayout>(properties))
+        return;
 
-    sItemCache->AddItemCacheEntry(id, imageId, name.c_str(), description.c_str(), stackSize, rarity, (uint32_t)time(nullptr));
+    sItemCache->AddItemCacheEntry(header.id, header.imageId, name.c_str(), description.c_str(), properties.stackSize, properties.rarity, (uint32_t)time(nullptr));
 
-    sGameplay->SignalItemCacheEntryLoaded(id);
+    sGameplay->SignalItemCacheEntryLoaded(header.id);
 }
 
 void PacketHandlers::HandleItemOperationInfo(SmartPacket& packet)
 {
-    uint8_t operation = packet.ReadUInt8();
-    uint32_t itemId = packet.ReadUInt32();
-    uint32_t count = packet.ReadUInt32();
+    ItemOperationInfoBlock info;
+    if (!packet.Decode<ItemOperationInfoLayout>(info))
+        return;
 
-    sGameplay->ReportItemOperation(itemId, (ItemInventoryOperation)operation, count);
+    sGameplay->ReportItemOperation(info.itemId, (ItemInventoryOperation)info.operation, info.count);
 }
 
 void PacketHandlers::HandleUpdateInventorySlot(SmartPacket& packet)
 {
-    uint32_t slot, guid, id, count;
+    InventorySlotHeaderBlock header;
+    InventorySlotContentsBlock contents;
+
+    if (!packet.Decode<InventorySlotHeaderLayout>(header))
+        return;
 
-    slot = packet.ReadUInt32();
-    guid = packet.ReadUInt32();
     // if guid equals zero, that means the slot is empty at all and no related data is appended
-    if (guid == 0)
-        sGameplay->SetInventorySlotContents(slot, 0, 0, 0);
+    if (header.guid == 0)
+        sGameplay->SetInventorySlotContents(header.slot, 0, 0, 0);
     else
     {
-        id = packet.ReadUInt32();
-        count = packet.ReadUInt32();
+        if (!packet.Decode<InventorySlotContentsLayout>(contents))
+            return;
 
-        sGameplay->SetInventorySlotContents(slot, guid, id, count);
+        sGameplay->SetInventorySlotContents(header.slot, header.guid, contents.id, contents.count);
     }
 }
+
+void PacketHandlers::HandlePong(SmartPacket& packet)
+{
+    PongBlock pong;
+    if (!packet.Decode<PongLayout>(pong))
+        return;
+
+    sNetwork->HandleClockSample(pong.clientTime, pong.serverTime);
+}
+
+void PacketHandlers::HandleResumeSessionResult(SmartPacket& packet)
+{
+    StatusBlock result;
+    if (!packet.Decode<StatusLayout>(result))
+        return;
+
+    if (result.status != RESUME_SESSION_OK)
+    {
+        sLog->Info("Server refused to resume session (%u)", (uint32_t)result.status);
+        sGameplay->AbandonSession();
+        sNetwork->Disconnect();
+        return;
+    }
+
+    ResumeSessionResultBlock resume;
+    if (!packet.Decode<ResumeSessionResultLayout>(resume))
+        return;
+
+    // kept map and verified content are valid only while the server content stays the same
+    if (resume.contentEpoch == 0 || resume.contentEpoch != sVerificationStorage->GetContentEpoch())
+    {
+        sLog->Info("Server content changed, session could not be resumed");
+        sGameplay->AbandonSession();
+        sNetwork->Disconnect();
+        return;
+    }
+
+    sNetwork->SetProtocolCapabilities(resume.capabilities);
+    sGameplay->SetResumeToken(resume.resumeToken);
+    sGameplay->SignalSessionResumed(resume.mapId, resume.posX, resume.posY);
+}
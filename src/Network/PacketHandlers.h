@@ -38,6 +38,23 @@ enum StateRestrictionMask
     STATE_RESTRICTION_VERIFIED      = 1 << CONNECTION_STATE_LOBBY | 1 << CONNECTION_STATE_INGAME,
 };
 
+// dispatch priority classes; packets of higher priority class are handled first within frame time budget, so packets
+// depending on each other have to share the class, or the later one has to be ordering barrier
+enum PacketPriority
+{
+    PACKET_PRIORITY_HIGH            = 0,    // session control, movement and object updates
+    PACKET_PRIORITY_NORMAL          = 1,    // chat, dialogues, inventory and other UI data
+    PACKET_PRIORITY_LOW             = 2,    // bulk resource and map data
+    MAX_PACKET_PRIORITY
+};
+
+// dispatch ordering flags
+enum PacketDispatchFlags
+{
+    PACKET_DISPATCH_NONE            = 0,
+    PACKET_DISPATCH_BARRIER         = 1,    // packets of lower priority classes received earlier are handled before this one
+};
+
 /*
  * Structure of packet handler record
  */
@@ -48,6 +65,12 @@ struct PacketHandlerStructure
 
     // state restriction
     StateRestrictionMask stateRestriction;
+
+    // dispatch priority class
+    PacketPriority priority;
+
+    // dispatch ordering flags
+    PacketDispatchFlags dispatchFlags;
 };
 
 // we wrap all packet handlers into namespace
@@ -83,61 +106,71 @@ namespace PacketHandlers
     PACKET_HANDLER(HandleItemQueryResponse);
     PACKET_HANDLER(HandleItemOperationInfo);
     PACKET_HANDLER(HandleUpdateInventorySlot);
+    PACKET_HANDLER(HandleCreateObjectCompact);
+    PACKET_HANDLER(HandleUpdateObjectCompact);
+    PACKET_HANDLER(HandlePong);
+    PACKET_HANDLER(HandleResumeSessionResult);
 };
 
 // table of packet handlers; the opcode is also an index here
 static PacketHandlerStructure PacketHandlerTable[] = {
-    { &PacketHandlers::Handle_NULL,             STATE_RESTRICTION_NEVER },      // OPCODE_NONE
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_LOGIN_REQUEST
-    { &PacketHandlers::HandleLoginResponse,     STATE_RESTRICTION_AUTH },       // SP_LOGIN_RESPONSE
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_CHARACTER_LIST_REQUEST
-    { &PacketHandlers::HandleCharacterList,     STATE_RESTRICTION_LOBBY },      // SP_CHARACTER_LIST
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_REQUEST_RESOURCE
-    { &PacketHandlers::HandleResourceSendStart, STATE_RESTRICTION_ANY   },      // SP_RESOURCE_SEND_START
-    { &PacketHandlers::HandleResourceSendFinished, STATE_RESTRICTION_ANY },     // SP_RESOURCE_SEND_FINISHED
-    { &PacketHandlers::HandleResourceData,      STATE_RESTRICTION_ANY   },      // SP_RESOURCE_DATA
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_RESOURCE_VERIFY_CHECKSUM
-    { &PacketHandlers::HandleResourceChecksumVerify, STATE_RESTRICTION_ANY },   // SP_RESOURCE_VERIFY_CHECKSUM
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_ENTER_WORLD
-    { &PacketHandlers::HandleEnterWorldResult,  STATE_RESTRICTION_LOBBY },      // SP_ENTER_WORLD_RESULT
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_WORLD_ENTER_COMPLETE
-    { &PacketHandlers::HandleCreateObject,      STATE_RESTRICTION_VERIFIED },   // SP_CREATE_OBJECT
-    { &PacketHandlers::HandleUpdateObject,      STATE_RESTRICTION_VERIFIED },   // SP_UPDATE_OBJECT
-    { &PacketHandlers::HandleDestroyObject,     STATE_RESTRICTION_VERIFIED },   // SP_DESTROY_OBJECT
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_GET_MAP_METADATA
-    { &PacketHandlers::HandleMapMetadata,       STATE_RESTRICTION_VERIFIED },   // SP_MAP_METADATA
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_GET_MAP_CHUNK
-    { &PacketHandlers::HandleMapChunk,          STATE_RESTRICTION_VERIFIED },   // SP_MAP_CHUNK
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_MAP_METADATA_VERIFY_CHECKSUM
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_MAP_CHUNK_VERIFY_CHECKSUM
-    { &PacketHandlers::HandleMapMetaChecksumVerify,     STATE_RESTRICTION_VERIFIED },   // SP_MAP_METADATA_VERIFY_CHECKSUM
-    { &PacketHandlers::HandleMapChunkChecksumVerify,    STATE_RESTRICTION_VERIFIED },   // SP_MAP_CHUNK_VERIFY_CHECKSUM
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_GET_IMAGE_METADATA
-    { &PacketHandlers::HandleImageMetadata,     STATE_RESTRICTION_VERIFIED },   // SP_IMAGE_METADATA
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_VERIFY_IMAGE_METADATA_CHECKSUM
-    { &PacketHandlers::HandleImageMetaChecksumVerify,   STATE_RESTRICTION_VERIFIED },   // SP_VERIFY_IMAGE_METADATA_CHECKSUM
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_NAME_QUERY
-    { &PacketHandlers::HandleNameQueryResponse, STATE_RESTRICTION_VERIFIED },   // SP_NAME_QUERY_RESPONSE
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_MOVE_START_DIRECTION
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_MOVE_STOP_DIRECTION
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_MOVE_HEARTBEAT
-    { &PacketHandlers::HandleMoveStartDir,      STATE_RESTRICTION_GAME  },      // SP_MOVE_START_DIRECTION
-    { &PacketHandlers::HandleMoveStopDir,       STATE_RESTRICTION_GAME  },      // SP_MOVE_STOP_DIRECTION
-    { &PacketHandlers::HandleMoveHeartbeat,     STATE_RESTRICTION_GAME  },      // SP_MOVE_HEARTBEAT
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_CHAT_MESSAGE
-    { &PacketHandlers::HandleChatMessage,       STATE_RESTRICTION_GAME },       // SP_CHAT_MESSAGE
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_INTERACTION_REQUEST
-    { &PacketHandlers::HandleDialogueData,      STATE_RESTRICTION_GAME  },      // SP_DIALOGUE_DATA
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_DIALOGUE_DECISION
-    { &PacketHandlers::HandleDialogueClose,     STATE_RESTRICTION_GAME  },      // SP_DIALOGUE_CLOSE
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_INVENTORY_QUERY
-    { &PacketHandlers::HandleInventory,         STATE_RESTRICTION_GAME  },      // SP_INVENTORY
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_ITEM_QUERY
-    { &PacketHandlers::HandleItemQueryResponse, STATE_RESTRICTION_GAME  },      // SP_ITEM_QUERY_RESPONSE
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_INVENTORY_MOVE_ITEM
-    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER },      // CP_INVENTORY_REMOVE_ITEM
-    { &PacketHandlers::HandleItemOperationInfo, STATE_RESTRICTION_GAME  },      // SP_ITEM_OPERATION_INFO
-    { &PacketHandlers::HandleUpdateInventorySlot,STATE_RESTRICTION_GAME },      // SP_UPDATE_INVENTORY_SLOT
+    { &PacketHandlers::Handle_NULL,             STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // OPCODE_NONE
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_LOGIN_REQUEST
+    { &PacketHandlers::HandleLoginResponse,     STATE_RESTRICTION_AUTH,     PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_LOGIN_RESPONSE
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_CHARACTER_LIST_REQUEST
+    { &PacketHandlers::HandleCharacterList,     STATE_RESTRICTION_LOBBY,    PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_CHARACTER_LIST
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_REQUEST_RESOURCE
+    { &PacketHandlers::HandleResourceSendStart, STATE_RESTRICTION_ANY,      PACKET_PRIORITY_LOW,    PACKET_DISPATCH_NONE     },   // SP_RESOURCE_SEND_START
+    { &PacketHandlers::HandleResourceSendFinished, STATE_RESTRICTION_ANY,      PACKET_PRIORITY_LOW,    PACKET_DISPATCH_NONE     },   // SP_RESOURCE_SEND_FINISHED
+    { &PacketHandlers::HandleResourceData,      STATE_RESTRICTION_ANY,      PACKET_PRIORITY_LOW,    PACKET_DISPATCH_NONE     },   // SP_RESOURCE_DATA
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_RESOURCE_VERIFY_CHECKSUM
+    { &PacketHandlers::HandleResourceChecksumVerify, STATE_RESTRICTION_ANY,      PACKET_PRIORITY_LOW,    PACKET_DISPATCH_NONE     },   // SP_RESOURCE_VERIFY_CHECKSUM
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // CP_ENTER_WORLD
+    { &PacketHandlers::HandleEnterWorldResult,  STATE_RESTRICTION_LOBBY,    PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_BARRIER  },   // SP_ENTER_WORLD_RESULT
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_WORLD_ENTER_COMPLETE
+    { &PacketHandlers::HandleCreateObject,      STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_CREATE_OBJECT
+    { &PacketHandlers::HandleUpdateObject,      STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_UPDATE_OBJECT
+    { &PacketHandlers::HandleDestroyObject,     STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_BARRIER  },   // SP_DESTROY_OBJECT
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_GET_MAP_METADATA
+    { &PacketHandlers::HandleMapMetadata,       STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_BARRIER  },   // SP_MAP_METADATA
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_GET_MAP_CHUNK
+    { &PacketHandlers::HandleMapChunk,          STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_LOW,    PACKET_DISPATCH_NONE     },   // SP_MAP_CHUNK
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_MAP_METADATA_VERIFY_CHECKSUM
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_MAP_CHUNK_VERIFY_CHECKSUM
+    { &PacketHandlers::HandleMapMetaChecksumVerify, STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_BARRIER  },   // SP_MAP_METADATA_VERIFY_CHECKSUM
+    { &PacketHandlers::HandleMapChunkChecksumVerify, STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_LOW,    PACKET_DISPATCH_NONE     },   // SP_MAP_CHUNK_VERIFY_CHECKSUM
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_GET_IMAGE_METADATA
+    { &PacketHandlers::HandleImageMetadata,     STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_LOW,    PACKET_DISPATCH_NONE     },   // SP_IMAGE_METADATA
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_VERIFY_IMAGE_METADATA_CHECKSUM
+    { &PacketHandlers::HandleImageMetaChecksumVerify, STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_LOW,    PACKET_DISPATCH_NONE     },   // SP_VERIFY_IMAGE_METADATA_CHECKSUM
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_NAME_QUERY
+    { &PacketHandlers::HandleNameQueryResponse, STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // SP_NAME_QUERY_RESPONSE
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_MOVE_START_DIRECTION
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_MOVE_STOP_DIRECTION
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_MOVE_HEARTBEAT
+    { &PacketHandlers::HandleMoveStartDir,      STATE_RESTRICTION_GAME,     PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_MOVE_START_DIRECTION
+    { &PacketHandlers::HandleMoveStopDir,       STATE_RESTRICTION_GAME,     PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_MOVE_STOP_DIRECTION
+    { &PacketHandlers::HandleMoveHeartbeat,     STATE_RESTRICTION_GAME,     PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_MOVE_HEARTBEAT
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_CHAT_MESSAGE
+    { &PacketHandlers::HandleChatMessage,       STATE_RESTRICTION_GAME,     PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // SP_CHAT_MESSAGE
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_INTERACTION_REQUEST
+    { &PacketHandlers::HandleDialogueData,      STATE_RESTRICTION_GAME,     PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // SP_DIALOGUE_DATA
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_DIALOGUE_DECISION
+    { &PacketHandlers::HandleDialogueClose,     STATE_RESTRICTION_GAME,     PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // SP_DIALOGUE_CLOSE
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_INVENTORY_QUERY
+    { &PacketHandlers::HandleInventory,         STATE_RESTRICTION_GAME,     PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // SP_INVENTORY
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_ITEM_QUERY
+    { &PacketHandlers::HandleItemQueryResponse, STATE_RESTRICTION_GAME,     PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // SP_ITEM_QUERY_RESPONSE
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_INVENTORY_MOVE_ITEM
+    { &PacketHandlers::Handle_ServerSide,       STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_INVENTORY_REMOVE_ITEM
+    { &PacketHandlers::HandleItemOperationInfo, STATE_RESTRICTION_GAME,     PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // SP_ITEM_OPERATION_INFO
+    { &PacketHandlers::HandleUpdateInventorySlot, STATE_RESTRICTION_GAME,     PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // SP_UPDATE_INVENTORY_SLOT
+    { &PacketHandlers::HandleCreateObjectCompact, STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_CREATE_OBJECT_COMPACT
+    { &PacketHandlers::HandleUpdateObjectCompact, STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_UPDATE_OBJECT_COMPACT
+    { &PacketHandlers::Handle_ServerSide,         STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_PING
+    { &PacketHandlers::HandlePong,                STATE_RESTRICTION_VERIFIED, PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_PONG
+    { &PacketHandlers::Handle_ServerSide,         STATE_RESTRICTION_NEVER,    PACKET_PRIORITY_NORMAL, PACKET_DISPATCH_NONE     },   // CP_RESUME_SESSION
+    { &PacketHandlers::HandleResumeSessionResult, STATE_RESTRICTION_AUTH,     PACKET_PRIORITY_HIGH,   PACKET_DISPATCH_NONE     },   // SP_RESUME_SESSION_RESULT
 };
 
 #endif
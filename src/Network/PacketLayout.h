@@ -0,0 +1,163 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_PACKETLAYOUT_H
+#define BW_PACKETLAYOUT_H
+
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Codec of single packet field type; decodes and encodes value stored in network byte order without any checks
+ */
+template<typename T>
+struct PacketFieldCodec;
+
+template<>
+struct PacketFieldCodec<uint8_t>
+{
+    static const uint32_t Size = 1;
+    static uint8_t Decode(const uint8_t* src) { return src[0]; }
+    static void Encode(uint8_t* dst, uint8_t val) { dst[0] = val; }
+};
+
+template<>
+struct PacketFieldCodec<int8_t>
+{
+    static const uint32_t Size = 1;
+    static int8_t Decode(const uint8_t* src) { return (int8_t)src[0]; }
+    static void Encode(uint8_t* dst, int8_t val) { dst[0] = (uint8_t)val; }
+};
+
+template<>
+struct PacketFieldCodec<uint16_t>
+{
+    static const uint32_t Size = 2;
+    static uint16_t Decode(const uint8_t* src) { return (uint16_t)(((uint16_t)src[0] << 8) | (uint16_t)src[1]); }
+    static void Encode(uint8_t* dst, uint16_t val) { dst[0] = (uint8_t)(val >> 8); dst[1] = (uint8_t)val; }
+};
+
+template<>
+struct PacketFieldCodec<int16_t>
+{
+    static const uint32_t Size = 2;
+    static int16_t Decode(const uint8_t* src) { return (int16_t)PacketFieldCodec<uint16_t>::Decode(src); }
+    static void Encode(uint8_t* dst, int16_t val) { PacketFieldCodec<uint16_t>::Encode(dst, (uint16_t)val); }
+};
+
+template<>
+struct PacketFieldCodec<uint32_t>
+{
+    static const uint32_t Size = 4;
+    static uint32_t Decode(const uint8_t* src) { return ((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8) | (uint32_t)src[3]; }
+    static void Encode(uint8_t* dst, uint32_t val) { dst[0] = (uint8_t)(val >> 24); dst[1] = (uint8_t)(val >> 16); dst[2] = (uint8_t)(val >> 8); dst[3] = (uint8_t)val; }
+};
+
+template<>
+struct PacketFieldCodec<int32_t>
+{
+    static const uint32_t Size = 4;
+    static int32_t Decode(const uint8_t* src) { return (int32_t)PacketFieldCodec<uint32_t>::Decode(src); }
+    static void Encode(uint8_t* dst, int32_t val) { PacketFieldCodec<uint32_t>::Encode(dst, (uint32_t)val); }
+};
+
+template<>
+struct PacketFieldCodec<uint64_t>
+{
+    static const uint32_t Size = 8;
+    static uint64_t Decode(const uint8_t* src) { return ((uint64_t)PacketFieldCodec<uint32_t>::Decode(src) << 32) | (uint64_t)PacketFieldCodec<uint32_t>::Decode(src + 4); }
+    static void Encode(uint8_t* dst, uint64_t val) { PacketFieldCodec<uint32_t>::Encode(dst, (uint32_t)(val >> 32)); PacketFieldCodec<uint32_t>::Encode(dst + 4, (uint32_t)val); }
+};
+
+template<>
+struct PacketFieldCodec<int64_t>
+{
+    static const uint32_t Size = 8;
+    static int64_t Decode(const uint8_t* src) { return (int64_t)PacketFieldCodec<uint64_t>::Decode(src); }
+    static void Encode(uint8_t* dst, int64_t val) { PacketFieldCodec<uint64_t>::Encode(dst, (uint64_t)val); }
+};
+
+template<>
+struct PacketFieldCodec<float>
+{
+    static const uint32_t Size = 4;
+    static float Decode(const uint8_t* src)
+    {
+        uint32_t raw = PacketFieldCodec<uint32_t>::Decode(src);
+        float val;
+        memcpy(&val, &raw, sizeof(float));
+        return val;
+    }
+    static void Encode(uint8_t* dst, float val)
+    {
+        uint32_t raw;
+        memcpy(&raw, &val, sizeof(float));
+        PacketFieldCodec<uint32_t>::Encode(dst, raw);
+    }
+};
+
+/*
+ * Single field of packet layout, bound to member of target structure
+ */
+template<class S, typename T, T S::*Member>
+struct PacketLayoutField
+{
+    static const uint32_t Size = PacketFieldCodec<T>::Size;
+
+    static void Decode(S &dst, const uint8_t* src)
+    {
+        dst.*Member = PacketFieldCodec<T>::Decode(src);
+    }
+};
+
+/*
+ * Fixed-size block of packet fields, decoded into structure S; fields are listed in order of their appearance in packet
+ */
+template<class S, class... Fields>
+struct PacketLayout;
+
+template<class S>
+struct PacketLayout<S>
+{
+    typedef S Structure;
+    static const uint32_t Size = 0;
+
+    static void DecodeFields(S &, const uint8_t*)
+    {
+        //
+    }
+};
+
+template<class S, class Field, class... Rest>
+struct PacketLayout<S, Field, Rest...>
+{
+    typedef S Structure;
+    static const uint32_t Size = Field::Size + PacketLayout<S, Rest...>::Size;
+
+    static void DecodeFields(S &dst, const uint8_t* src)
+    {
+        Field::Decode(dst, src);
+        PacketLayout<S, Rest...>::DecodeFields(dst, src + Field::Size);
+    }
+};
+
+// declares layout field bound to structure member
+#define PACKET_FIELD(s, member) PacketLayoutField<s, decltype(s::member), &s::member>
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "PacketPool.h"
+
+PacketPool::PacketPool(uint32_t initialCount, uint32_t returnQueueSize) : m_returnedPackets(returnQueueSize), m_largeRetained(0),
+    m_packetAllocations(0), m_bufferAllocations(0), m_acquired(0), m_reused(0), m_released(0)
+{
+    // allocate packets in advance, so we don't need to do it during first packets receiving
+    m_freePackets.reserve(initialCount);
+    for (uint32_t i = 0; i < initialCount; i++)
+        m_freePackets.push_back(AllocatePacket(PACKET_POOL_INITIAL_CAPACITY));
+}
+
+PacketPool::~PacketPool()
+{
+    PendingPacket* pp;
+
+    while (m_returnedPackets.Pop(pp))
+        m_freePackets.push_back(pp);
+
+    for (PendingPacket* pp : m_freePackets)
+    {
+        delete pp->pkt;
+        delete pp;
+    }
+}
+
+PendingPacket* PacketPool::AllocatePacket(uint32_t capacity)
+{
+    PendingPacket* pp = new PendingPacket();
+    pp->pkt = new SmartPacket();
+    pp->pkt->Reserve(capacity);
+    pp->timeArrived = 0;
+
+    m_packetAllocations++;
+
+    return pp;
+}
+
+PendingPacket* PacketPool::Acquire(uint16_t opcode, uint32_t size)
+{
+    PendingPacket* pp;
+
+    m_acquired++;
+
+    // prefer recently returned packets, then the ones allocated in advance
+    if (m_returnedPackets.Pop(pp))
+    {
+        if (pp->pkt->GetCapacity() >= PACKET_POOL_LARGE_CAPACITY)
+            m_largeRetained--;
+    }
+    else if (!m_freePackets.empty())
+    {
+        pp = m_freePackets.back();
+        m_freePackets.pop_back();
+    }
+    else
+    {
+        // pool exhausted - allocate new one, it will be returned to pool after use
+        pp = AllocatePacket(size);
+        pp->pkt->Initialize(opcode, size);
+        return pp;
+    }
+
+    if (pp->pkt->GetCapacity() >= size)
+        m_reused++;
+    else
+        m_bufferAllocations++;
+
+    pp->pkt->Initialize(opcode, size);
+
+    return pp;
+}
+
+void PacketPool::Release(PendingPacket* pp)
+{
+    m_released++;
+
+    // do not hold too much memory just because of some burst of large packets; the huge ones are never kept
+    if (pp->pkt->GetCapacity() > PACKET_POOL_MAX_RETAINED_CAPACITY)
+        pp->pkt->ReleaseData();
+    else if (pp->pkt->GetCapacity() >= PACKET_POOL_LARGE_CAPACITY)
+    {
+        if (m_largeRetained >= PACKET_POOL_MAX_LARGE_RETAINED)
+            pp->pkt->ReleaseData();
+        else
+            m_largeRetained++;
+    }
+
+    // this should not happen, as the return queue is large enough to hold every packet in use
+    if (!m_returnedPackets.Push(pp))
+    {
+        if (pp->pkt->GetCapacity() >= PACKET_POOL_LARGE_CAPACITY)
+            m_largeRetained--;
+
+        delete pp->pkt;
+        delete pp;
+    }
+}
+
+void PacketPool::Discard(PendingPacket* pp)
+{
+    m_acquired--;
+
+    m_freePackets.push_back(pp);
+}
+
+PacketPoolStats PacketPool::GetStats()
+{
+    PacketPoolStats stats;
+
+    stats.packetAllocations = m_packetAllocations.load(std::memory_order_relaxed);
+    stats.bufferAllocations = m_bufferAllocations.load(std::memory_order_relaxed);
+    stats.acquired = m_acquired.load(std::memory_order_relaxed);
+    stats.reused = m_reused.load(std::memory_order_relaxed);
+    stats.released = m_released.load(std::memory_order_relaxed);
+
+    return stats;
+}
@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_PACKETPOOL_H
+#define BW_PACKETPOOL_H
+
+#include "SmartPacket.h"
+#include "SPSCQueue.h"
+
+// default count of packets allocated in advance
+#define PACKET_POOL_INITIAL_COUNT           256
+// contents capacity reserved for every packet allocated in advance
+#define PACKET_POOL_INITIAL_CAPACITY        256
+// packets with larger contents capacity are considered large
+#define PACKET_POOL_LARGE_CAPACITY          4*1024
+// maximum number of large packets kept in pool; the rest releases its contents memory
+#define PACKET_POOL_MAX_LARGE_RETAINED      8
+// packets with larger contents capacity always release it before returning to pool (i.e. resources in extended frames)
+#define PACKET_POOL_MAX_RETAINED_CAPACITY   64*1024
+// default capacity of queue of packets returned from main thread; must not be lower than
+// the count of packets that could be in use at once (network packet queue size + packets parked in dispatch
+// queues, which is limited to network packet queue size too + partially received one + the one being handled)
+#define PACKET_POOL_RETURN_QUEUE_SIZE       16384
+
+/*
+ * Pending packet structure
+ */
+struct PendingPacket
+{
+    // received packet
+    SmartPacket *pkt;
+    // time of its arrival
+    uint32_t timeArrived;
+};
+
+/*
+ * Structure containing packet pool counters
+ */
+struct PacketPoolStats
+{
+    // count of packet objects allocated on heap
+    uint64_t packetAllocations;
+    // count of packet contents reallocations (growth beyond retained capacity)
+    uint64_t bufferAllocations;
+    // count of packets acquired from pool
+    uint64_t acquired;
+    // count of packets acquired without any heap allocation
+    uint64_t reused;
+    // count of packets returned to pool
+    uint64_t released;
+};
+
+/*
+ * Class maintaining recycled packet objects, so the receiving does not need to allocate memory in steady state;
+ * packets are acquired by network thread and released by main thread, no lock is involved
+ */
+class PacketPool
+{
+    public:
+        PacketPool(uint32_t initialCount = PACKET_POOL_INITIAL_COUNT, uint32_t returnQueueSize = PACKET_POOL_RETURN_QUEUE_SIZE);
+        ~PacketPool();
+
+        // retrieves packet from pool, prepared to contain specified opcode and contents size (network thread only)
+        PendingPacket* Acquire(uint16_t opcode, uint32_t size);
+        // returns packet to pool (main thread only)
+        void Release(PendingPacket* pp);
+        // returns acquired, but unused packet back to pool (network thread only)
+        void Discard(PendingPacket* pp);
+
+        // retrieves copy of pool counters
+        PacketPoolStats GetStats();
+
+    protected:
+        // allocates new packet object with reserved contents capacity
+        PendingPacket* AllocatePacket(uint32_t capacity);
+
+    private:
+        // packets allocated in advance, owned by acquiring thread
+        std::vector<PendingPacket*> m_freePackets;
+        // packets returned after use, waiting to be acquired again
+        SPSCQueue<PendingPacket*> m_returnedPackets;
+        // count of large packets waiting for reuse
+        std::atomic<uint32_t> m_largeRetained;
+
+        // count of packet objects allocated on heap
+        std::atomic<uint64_t> m_packetAllocations;
+        // count of packet contents reallocations
+        std::atomic<uint64_t> m_bufferAllocations;
+        // count of packets acquired from pool
+        std::atomic<uint64_t> m_acquired;
+        // count of packets acquired without any heap allocation
+        std::atomic<uint64_t> m_reused;
+        // count of packets returned to pool
+        std::atomic<uint64_t> m_released;
+};
+
+#endif
@@ -0,0 +1,515 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_PACKETSTRUCTURES_H
+#define BW_PACKETSTRUCTURES_H
+
+#include "PacketLayout.h"
+
+/*
+ * Fixed-size blocks of server packets, decoded at once with single bounds check
+ */
+
+// generic status byte, leading most of response packets
+struct StatusBlock
+{
+    uint8_t status;
+};
+typedef PacketLayout<StatusBlock, PACKET_FIELD(StatusBlock, status)> StatusLayout;
+
+// generic one byte count of following records
+struct CountBlock
+{
+    uint8_t count;
+};
+typedef PacketLayout<CountBlock, PACKET_FIELD(CountBlock, count)> CountLayout;
+
+// SP_CHARACTER_LIST, character GUID leading every record
+struct CharacterListGuidBlock
+{
+    uint32_t guid;
+};
+typedef PacketLayout<CharacterListGuidBlock, PACKET_FIELD(CharacterListGuidBlock, guid)> CharacterListGuidLayout;
+
+// SP_CHARACTER_LIST, character level following name
+struct CharacterListLevelBlock
+{
+    uint16_t level;
+};
+typedef PacketLayout<CharacterListLevelBlock, PACKET_FIELD(CharacterListLevelBlock, level)> CharacterListLevelLayout;
+
+// SP_RESOURCE_SEND_START (following filename), SP_RESOURCE_SEND_FINISHED, SP_RESOURCE_VERIFY_CHECKSUM records
+struct ResourceIdentifierBlock
+{
+    uint8_t type;
+    uint32_t id;
+};
+typedef PacketLayout<ResourceIdentifierBlock,
+    PACKET_FIELD(ResourceIdentifierBlock, type),
+    PACKET_FIELD(ResourceIdentifierBlock, id)> ResourceIdentifierLayout;
+
+// SP_RESOURCE_VERIFY_CHECKSUM, echoed ID of verified batch leading the packet, when negotiated
+struct ResourceChecksumBatchBlock
+{
+    uint32_t batchId;
+};
+typedef PacketLayout<ResourceChecksumBatchBlock, PACKET_FIELD(ResourceChecksumBatchBlock, batchId)> ResourceChecksumBatchLayout;
+
+// SP_RESOURCE_VERIFY_CHECKSUM, count of failed resources
+struct ResourceChecksumVerifyHeaderBlock
+{
+    uint16_t failedCount;
+};
+typedef PacketLayout<ResourceChecksumVerifyHeaderBlock, PACKET_FIELD(ResourceChecksumVerifyHeaderBlock, failedCount)> ResourceChecksumVerifyHeaderLayout;
+
+// SP_RESOURCE_DATA, header of resource data portion
+struct ResourceDataHeaderBlock
+{
+    uint8_t type;
+    uint32_t id;
+    uint16_t size;
+};
+typedef PacketLayout<ResourceDataHeaderBlock,
+    PACKET_FIELD(ResourceDataHeaderBlock, type),
+    PACKET_FIELD(ResourceDataHeaderBlock, id),
+    PACKET_FIELD(ResourceDataHeaderBlock, size)> ResourceDataHeaderLayout;
+
+// SP_RESOURCE_DATA, header of resource data portion when extended frames are confirmed
+struct ResourceDataLargeHeaderBlock
+{
+    uint8_t type;
+    uint32_t id;
+    uint32_t size;
+};
+typedef PacketLayout<ResourceDataLargeHeaderBlock,
+    PACKET_FIELD(ResourceDataLargeHeaderBlock, type),
+    PACKET_FIELD(ResourceDataLargeHeaderBlock, id),
+    PACKET_FIELD(ResourceDataLargeHeaderBlock, size)> ResourceDataLargeHeaderLayout;
+
+// SP_ENTER_WORLD_RESULT, following OK status
+struct EnterWorldPositionBlock
+{
+    uint32_t mapId;
+    float posX;
+    float posY;
+};
+typedef PacketLayout<EnterWorldPositionBlock,
+    PACKET_FIELD(EnterWorldPositionBlock, mapId),
+    PACKET_FIELD(EnterWorldPositionBlock, posX),
+    PACKET_FIELD(EnterWorldPositionBlock, posY)> EnterWorldPositionLayout;
+
+// SP_RESUME_SESSION_RESULT, following OK status
+struct ResumeSessionResultBlock
+{
+    uint32_t contentEpoch;
+    uint32_t capabilities;
+    uint64_t resumeToken;
+    uint32_t mapId;
+    float posX;
+    float posY;
+};
+typedef PacketLayout<ResumeSessionResultBlock,
+    PACKET_FIELD(ResumeSessionResultBlock, contentEpoch),
+    PACKET_FIELD(ResumeSessionResultBlock, capabilities),
+    PACKET_FIELD(ResumeSessionResultBlock, resumeToken),
+    PACKET_FIELD(ResumeSessionResultBlock, mapId),
+    PACKET_FIELD(ResumeSessionResultBlock, posX),
+    PACKET_FIELD(ResumeSessionResultBlock, posY)> ResumeSessionResultLayout;
+
+// SP_CREATE_OBJECT, beginning of every object record
+struct CreateObjectHeaderBlock
+{
+    uint64_t guid;
+    uint32_t fieldCount;
+};
+typedef PacketLayout<CreateObjectHeaderBlock,
+    PACKET_FIELD(CreateObjectHeaderBlock, guid),
+    PACKET_FIELD(CreateObjectHeaderBlock, fieldCount)> CreateObjectHeaderLayout;
+
+// SP_CREATE_OBJECT, object position following updatefields
+struct CreateObjectPositionBlock
+{
+    float x;
+    float y;
+};
+typedef PacketLayout<CreateObjectPositionBlock,
+    PACKET_FIELD(CreateObjectPositionBlock, x),
+    PACKET_FIELD(CreateObjectPositionBlock, y)> CreateObjectPositionLayout;
+
+// SP_CREATE_OBJECT, movement info of units following position
+struct CreateObjectMovementBlock
+{
+    uint8_t moveMask;
+};
+typedef PacketLayout<CreateObjectMovementBlock, PACKET_FIELD(CreateObjectMovementBlock, moveMask)> CreateObjectMovementLayout;
+
+// SP_UPDATE_OBJECT, packet header
+struct UpdateObjectHeaderBlock
+{
+    uint64_t guid;
+    uint8_t count;
+};
+typedef PacketLayout<UpdateObjectHeaderBlock,
+    PACKET_FIELD(UpdateObjectHeaderBlock, guid),
+    PACKET_FIELD(UpdateObjectHeaderBlock, count)> UpdateObjectHeaderLayout;
+
+// SP_UPDATE_OBJECT, one updated field
+struct UpdateObjectFieldBlock
+{
+    uint32_t field;
+    uint32_t value;
+};
+typedef PacketLayout<UpdateObjectFieldBlock,
+    PACKET_FIELD(UpdateObjectFieldBlock, field),
+    PACKET_FIELD(UpdateObjectFieldBlock, value)> UpdateObjectFieldLayout;
+
+// SP_CREATE_OBJECT_COMPACT, beginning of every object record followed by packed position and field set
+struct CreateObjectCompactHeaderBlock
+{
+    uint64_t guid;
+    uint8_t moveMask;
+};
+typedef PacketLayout<CreateObjectCompactHeaderBlock,
+    PACKET_FIELD(CreateObjectCompactHeaderBlock, guid),
+    PACKET_FIELD(CreateObjectCompactHeaderBlock, moveMask)> CreateObjectCompactHeaderLayout;
+
+// SP_UPDATE_OBJECT_COMPACT, beginning of every object record followed by field set
+struct UpdateObjectCompactHeaderBlock
+{
+    uint64_t guid;
+};
+typedef PacketLayout<UpdateObjectCompactHeaderBlock, PACKET_FIELD(UpdateObjectCompactHeaderBlock, guid)> UpdateObjectCompactHeaderLayout;
+
+// SP_PONG, echoed client time of ping and server time of reply
+struct PongBlock
+{
+    uint32_t clientTime;
+    uint32_t serverTime;
+};
+typedef PacketLayout<PongBlock,
+    PACKET_FIELD(PongBlock, clientTime),
+    PACKET_FIELD(PongBlock, serverTime)> PongLayout;
+
+// SP_DESTROY_OBJECT, one destroyed object
+struct DestroyObjectBlock
+{
+    uint64_t guid;
+};
+typedef PacketLayout<DestroyObjectBlock, PACKET_FIELD(DestroyObjectBlock, guid)> DestroyObjectLayout;
+
+// SP_MAP_METADATA, map dimensions following OK status
+struct MapMetadataHeaderBlock
+{
+    uint32_t mapId;
+    uint32_t sizeX;
+    uint32_t sizeY;
+};
+typedef PacketLayout<MapMetadataHeaderBlock,
+    PACKET_FIELD(MapMetadataHeaderBlock, mapId),
+    PACKET_FIELD(MapMetadataHeaderBlock, sizeX),
+    PACKET_FIELD(MapMetadataHeaderBlock, sizeY)> MapMetadataHeaderLayout;
+
+// SP_MAP_METADATA, entry point and default field following map name
+struct MapMetadataFieldsBlock
+{
+    uint32_t entryX;
+    uint32_t entryY;
+    uint16_t defaultFieldType;
+    uint32_t defaultFieldTexture;
+    uint32_t defaultFieldFlags;
+};
+typedef PacketLayout<MapMetadataFieldsBlock,
+    PACKET_FIELD(MapMetadataFieldsBlock, entryX),
+    PACKET_FIELD(MapMetadataFieldsBlock, entryY),
+    PACKET_FIELD(MapMetadataFieldsBlock, defaultFieldType),
+    PACKET_FIELD(MapMetadataFieldsBlock, defaultFieldTexture),
+    PACKET_FIELD(MapMetadataFieldsBlock, defaultFieldFlags)> MapMetadataFieldsLayout;
+
+// SP_MAP_CHUNK, chunk header following OK status
+struct MapChunkHeaderBlock
+{
+    uint32_t mapId;
+    uint32_t startX;
+    uint32_t startY;
+    uint32_t sizeX;
+    uint32_t sizeY;
+};
+typedef PacketLayout<MapChunkHeaderBlock,
+    PACKET_FIELD(MapChunkHeaderBlock, mapId),
+    PACKET_FIELD(MapChunkHeaderBlock, startX),
+    PACKET_FIELD(MapChunkHeaderBlock, startY),
+    PACKET_FIELD(MapChunkHeaderBlock, sizeX),
+    PACKET_FIELD(MapChunkHeaderBlock, sizeY)> MapChunkHeaderLayout;
+
+// SP_MAP_CHUNK, one map field
+struct MapChunkFieldBlock
+{
+    uint16_t type;
+    uint32_t texture;
+    uint32_t flags;
+};
+typedef PacketLayout<MapChunkFieldBlock,
+    PACKET_FIELD(MapChunkFieldBlock, type),
+    PACKET_FIELD(MapChunkFieldBlock, texture),
+    PACKET_FIELD(MapChunkFieldBlock, flags)> MapChunkFieldLayout;
+
+// SP_MAP_METADATA_VERIFY_CHECKSUM
+struct MapMetaChecksumVerifyBlock
+{
+    uint8_t status;
+    uint32_t mapId;
+};
+typedef PacketLayout<MapMetaChecksumVerifyBlock,
+    PACKET_FIELD(MapMetaChecksumVerifyBlock, status),
+    PACKET_FIELD(MapMetaChecksumVerifyBlock, mapId)> MapMetaChecksumVerifyLayout;
+
+// SP_MAP_CHUNK_VERIFY_CHECKSUM
+struct MapChunkChecksumVerifyBlock
+{
+    uint8_t status;
+    uint32_t mapId;
+    uint32_t startX;
+    uint32_t startY;
+};
+typedef PacketLayout<MapChunkChecksumVerifyBlock,
+    PACKET_FIELD(MapChunkChecksumVerifyBlock, status),
+    PACKET_FIELD(MapChunkChecksumVerifyBlock, mapId),
+    PACKET_FIELD(MapChunkChecksumVerifyBlock, startX),
+    PACKET_FIELD(MapChunkChecksumVerifyBlock, startY)> MapChunkChecksumVerifyLayout;
+
+// SP_IMAGE_METADATA, image metadata following OK status
+struct ImageMetadataBlock
+{
+    uint32_t id;
+    uint32_t sizeX;
+    uint32_t sizeY;
+    uint32_t baseCenterX;
+    uint32_t baseCenterY;
+    uint32_t collisionX1;
+    uint32_t collisionY1;
+    uint32_t collisionX2;
+    uint32_t collisionY2;
+    uint32_t animCount;
+};
+typedef PacketLayout<ImageMetadataBlock,
+    PACKET_FIELD(ImageMetadataBlock, id),
+    PACKET_FIELD(ImageMetadataBlock, sizeX),
+    PACKET_FIELD(ImageMetadataBlock, sizeY),
+    PACKET_FIELD(ImageMetadataBlock, baseCenterX),
+    PACKET_FIELD(ImageMetadataBlock, baseCenterY),
+    PACKET_FIELD(ImageMetadataBlock, collisionX1),
+    PACKET_FIELD(ImageMetadataBlock, collisionY1),
+    PACKET_FIELD(ImageMetadataBlock, collisionX2),
+    PACKET_FIELD(ImageMetadataBlock, collisionY2),
+    PACKET_FIELD(ImageMetadataBlock, animCount)> ImageMetadataLayout;
+
+// SP_IMAGE_METADATA, one animation record
+struct ImageAnimationBlock
+{
+    uint32_t animId;
+    uint32_t frameBegin;
+    uint32_t frameEnd;
+    uint32_t frameDelay;
+};
+typedef PacketLayout<ImageAnimationBlock,
+    PACKET_FIELD(ImageAnimationBlock, animId),
+    PACKET_FIELD(ImageAnimationBlock, frameBegin),
+    PACKET_FIELD(ImageAnimationBlock, frameEnd),
+    PACKET_FIELD(ImageAnimationBlock, frameDelay)> ImageAnimationLayout;
+
+// SP_VERIFY_IMAGE_METADATA_CHECKSUM
+struct ImageMetaChecksumVerifyBlock
+{
+    uint8_t status;
+    uint32_t id;
+};
+typedef PacketLayout<ImageMetaChecksumVerifyBlock,
+    PACKET_FIELD(ImageMetaChecksumVerifyBlock, status),
+    PACKET_FIELD(ImageMetaChecksumVerifyBlock, id)> ImageMetaChecksumVerifyLayout;
+
+// SP_NAME_QUERY_RESPONSE, GUID followed by name
+struct NameQueryResponseHeaderBlock
+{
+    uint64_t guid;
+};
+typedef PacketLayout<NameQueryResponseHeaderBlock, PACKET_FIELD(NameQueryResponseHeaderBlock, guid)> NameQueryResponseHeaderLayout;
+
+// SP_MOVE_START_DIRECTION
+struct MoveStartDirBlock
+{
+    uint64_t guid;
+    uint8_t dir;
+};
+typedef PacketLayout<MoveStartDirBlock,
+    PACKET_FIELD(MoveStartDirBlock, guid),
+    PACKET_FIELD(MoveStartDirBlock, dir)> MoveStartDirLayout;
+
+// SP_MOVE_STOP_DIRECTION
+struct MoveStopDirBlock
+{
+    uint64_t guid;
+    uint8_t dir;
+    float x;
+    float y;
+};
+typedef PacketLayout<MoveStopDirBlock,
+    PACKET_FIELD(MoveStopDirBlock, guid),
+    PACKET_FIELD(MoveStopDirBlock, dir),
+    PACKET_FIELD(MoveStopDirBlock, x),
+    PACKET_FIELD(MoveStopDirBlock, y)> MoveStopDirLayout;
+
+// SP_MOVE_HEARTBEAT
+struct MoveHeartbeatBlock
+{
+    uint64_t guid;
+    uint8_t moveMask;
+    float x;
+    float y;
+};
+typedef PacketLayout<MoveHeartbeatBlock,
+    PACKET_FIELD(MoveHeartbeatBlock, guid),
+    PACKET_FIELD(MoveHeartbeatBlock, moveMask),
+    PACKET_FIELD(MoveHeartbeatBlock, x),
+    PACKET_FIELD(MoveHeartbeatBlock, y)> MoveHeartbeatLayout;
+
+// SP_CHAT_MESSAGE, header followed by message
+struct ChatMessageHeaderBlock
+{
+    uint8_t type;
+    uint64_t guid;
+};
+typedef PacketLayout<ChatMessageHeaderBlock,
+    PACKET_FIELD(ChatMessageHeaderBlock, type),
+    PACKET_FIELD(ChatMessageHeaderBlock, guid)> ChatMessageHeaderLayout;
+
+// SP_DIALOGUE_DATA, packet header
+struct DialogueDataHeaderBlock
+{
+    uint64_t sourceGuid;
+    uint8_t state;
+};
+typedef PacketLayout<DialogueDataHeaderBlock,
+    PACKET_FIELD(DialogueDataHeaderBlock, sourceGuid),
+    PACKET_FIELD(DialogueDataHeaderBlock, state)> DialogueDataHeaderLayout;
+
+// SP_DIALOGUE_DATA, decision ID followed by its text
+struct DialogueDecisionBlock
+{
+    uint32_t id;
+};
+typedef PacketLayout<DialogueDecisionBlock, PACKET_FIELD(DialogueDecisionBlock, id)> DialogueDecisionLayout;
+
+// SP_INVENTORY, item GUID leading every slot
+struct InventoryItemGuidBlock
+{
+    uint32_t guid;
+};
+typedef PacketLayout<InventoryItemGuidBlock, PACKET_FIELD(InventoryItemGuidBlock, guid)> InventoryItemGuidLayout;
+
+// SP_ITEM_QUERY_RESPONSE, item identification following OK status
+struct ItemQueryHeaderBlock
+{
+    uint32_t id;
+    uint32_t imageId;
+};
+typedef PacketLayout<ItemQueryHeaderBlock,
+    PACKET_FIELD(ItemQueryHeaderBlock, id),
+    PACKET_FIELD(ItemQueryHeaderBlock, imageId)> ItemQueryHeaderLayout;
+
+// SP_ITEM_QUERY_RESPONSE, item properties following name and description
+struct ItemQueryPropertiesBlock
+{
+    uint32_t stackSize;
+    uint32_t rarity;
+};
+typedef PacketLayout<ItemQueryPropertiesBlock,
+    PACKET_FIELD(ItemQueryPropertiesBlock, stackSize),
+    PACKET_FIELD(ItemQueryPropertiesBlock, rarity)> ItemQueryPropertiesLayout;
+
+// SP_ITEM_OPERATION_INFO
+struct ItemOperationInfoBlock
+{
+    uint8_t operation;
+    uint32_t itemId;
+    uint32_t count;
+};
+typedef PacketLayout<ItemOperationInfoBlock,
+    PACKET_FIELD(ItemOperationInfoBlock, operation),
+    PACKET_FIELD(ItemOperationInfoBlock, itemId),
+    PACKET_FIELD(ItemOperationInfoBlock, count)> ItemOperationInfoLayout;
+
+// SP_UPDATE_INVENTORY_SLOT, packet header
+struct InventorySlotHeaderBlock
+{
+    uint32_t slot;
+    uint32_t guid;
+};
+typedef PacketLayout<InventorySlotHeaderBlock,
+    PACKET_FIELD(InventorySlotHeaderBlock, slot),
+    PACKET_FIELD(InventorySlotHeaderBlock, guid)> InventorySlotHeaderLayout;
+
+// SP_UPDATE_INVENTORY_SLOT and SP_INVENTORY, slot contents following non-zero item guid
+struct InventorySlotContentsBlock
+{
+    uint32_t id;
+    uint32_t count;
+};
+typedef PacketLayout<InventorySlotContentsBlock,
+    PACKET_FIELD(InventorySlotContentsBlock, id),
+    PACKET_FIELD(InventorySlotContentsBlock, count)> InventorySlotContentsLayout;
+
+// CP_MOVE_START_DIRECTION
+struct MoveStartDirRequestBlock
+{
+    uint8_t dir;
+};
+typedef PacketLayout<MoveStartDirRequestBlock, PACKET_FIELD(MoveStartDirRequestBlock, dir)> MoveStartDirRequestLayout;
+
+// CP_MOVE_STOP_DIRECTION
+struct MoveStopDirRequestBlock
+{
+    uint8_t dir;
+    float x;
+    float y;
+};
+typedef PacketLayout<MoveStopDirRequestBlock,
+    PACKET_FIELD(MoveStopDirRequestBlock, dir),
+    PACKET_FIELD(MoveStopDirRequestBlock, x),
+    PACKET_FIELD(MoveStopDirRequestBlock, y)> MoveStopDirRequestLayout;
+
+// CP_MOVE_HEARTBEAT
+struct MoveHeartbeatRequestBlock
+{
+    uint8_t moveMask;
+    float x;
+    float y;
+};
+typedef PacketLayout<MoveHeartbeatRequestBlock,
+    PACKET_FIELD(MoveHeartbeatRequestBlock, moveMask),
+    PACKET_FIELD(MoveHeartbeatRequestBlock, x),
+    PACKET_FIELD(MoveHeartbeatRequestBlock, y)> MoveHeartbeatRequestLayout;
+
+// CP_CHAT_MESSAGE, talk type followed by message
+struct ChatMessageRequestHeaderBlock
+{
+    uint8_t type;
+};
+typedef PacketLayout<ChatMessageRequestHeaderBlock, PACKET_FIELD(ChatMessageRequestHeaderBlock, type)> ChatMessageRequestHeaderLayout;
+
+#endif
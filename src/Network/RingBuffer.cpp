@@ -0,0 +1,144 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "RingBuffer.h"
+
+RingBuffer::RingBuffer(uint32_t capacity) : m_capacity(capacity), m_readPos(0), m_usedSize(0)
+{
+    m_buffer = new uint8_t[capacity];
+}
+
+RingBuffer::~RingBuffer()
+{
+    delete[] m_buffer;
+}
+
+uint32_t RingBuffer::GetCapacity() const
+{
+    return m_capacity;
+}
+
+uint32_t RingBuffer::GetUsedSize() const
+{
+    return m_usedSize;
+}
+
+uint32_t RingBuffer::GetFreeSize() const
+{
+    return m_capacity - m_usedSize;
+}
+
+void RingBuffer::Reset()
+{
+    m_readPos = 0;
+    m_usedSize = 0;
+}
+
+uint8_t* RingBuffer::GetWritePointer(uint32_t &contiguousSize)
+{
+    uint32_t writePos = (m_readPos + m_usedSize) % m_capacity;
+
+    // free space either ends at the end of buffer, or at the read position, if the stored data wraps around
+    if (writePos >= m_readPos && m_usedSize < m_capacity)
+        contiguousSize = m_capacity - writePos;
+    else
+        contiguousSize = m_readPos - writePos;
+
+    return &m_buffer[writePos];
+}
+
+void RingBuffer::CommitWrite(uint32_t size)
+{
+    m_usedSize += num_min(size, GetFreeSize());
+}
+
+bool RingBuffer::Write(const void* data, uint32_t size)
+{
+    if (size > GetFreeSize())
+        return false;
+
+    uint32_t writePos = (m_readPos + m_usedSize) % m_capacity;
+    // write first portion till the end of buffer, and the rest from the beginning
+    uint32_t firstPart = num_min(size, m_capacity - writePos);
+
+    memcpy(&m_buffer[writePos], data, firstPart);
+    if (firstPart < size)
+        memcpy(m_buffer, (const uint8_t*)data + firstPart, size - firstPart);
+
+    m_usedSize += size;
+    return true;
+}
+
+const uint8_t* RingBuffer::GetReadPointer(uint32_t &contiguousSize) const
+{
+    contiguousSize = num_min(m_usedSize, m_capacity - m_readPos);
+    return &m_buffer[m_readPos];
+}
+
+uint32_t RingBuffer::GetReadSegments(const uint8_t* &first, uint32_t &firstSize, const uint8_t* &second, uint32_t &secondSize) const
+{
+    first = GetReadPointer(firstSize);
+
+    // the rest of data continues at the beginning of buffer
+    second = m_buffer;
+    secondSize = m_usedSize - firstSize;
+
+    if (firstSize == 0)
+        return 0;
+
+    return (secondSize > 0) ? 2 : 1;
+}
+
+bool RingBuffer::Peek(void* dst, uint32_t size, uint32_t offset) const
+{
+    if (offset + size > m_usedSize)
+        return false;
+
+    uint32_t readPos = (m_readPos + offset) % m_capacity;
+    // read first portion till the end of buffer, and the rest from the beginning
+    uint32_t firstPart = num_min(size, m_capacity - readPos);
+
+    memcpy(dst, &m_buffer[readPos], firstPart);
+    if (firstPart < size)
+        memcpy((uint8_t*)dst + firstPart, m_buffer, size - firstPart);
+
+    return true;
+}
+
+bool RingBuffer::Read(void* dst, uint32_t size)
+{
+    if (!Peek(dst, size))
+        return false;
+
+    Skip(size);
+    return true;
+}
+
+void RingBuffer::Skip(uint32_t size)
+{
+    size = num_min(size, m_usedSize);
+
+    m_readPos = (m_readPos + size) % m_capacity;
+    m_usedSize -= size;
+
+    // rewind to the beginning when empty, so the next write gets the largest contiguous space possible
+    if (m_usedSize == 0)
+        m_readPos = 0;
+}
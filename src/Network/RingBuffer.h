@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_RINGBUFFER_H
+#define BW_RINGBUFFER_H
+
+#include <cstdint>
+
+/*
+ * Class representing fixed-size circular byte buffer
+ */
+class RingBuffer
+{
+    public:
+        // constructor allocating buffer of specified capacity
+        RingBuffer(uint32_t capacity);
+        ~RingBuffer();
+
+        // the buffer owns its memory, copying would lead to double free
+        RingBuffer(const RingBuffer&) = delete;
+        RingBuffer& operator=(const RingBuffer&) = delete;
+
+        // retrieves total capacity of buffer
+        uint32_t GetCapacity() const;
+        // retrieves count of bytes stored in buffer
+        uint32_t GetUsedSize() const;
+        // retrieves count of bytes, that could be stored in buffer
+        uint32_t GetFreeSize() const;
+        // discards all stored data
+        void Reset();
+
+        // retrieves pointer to first free byte and size of contiguous free space behind it
+        uint8_t* GetWritePointer(uint32_t &contiguousSize);
+        // marks specified count of bytes behind write pointer as stored
+        void CommitWrite(uint32_t size);
+        // stores data into buffer; fails, if there's not enough free space
+        bool Write(const void* data, uint32_t size);
+
+        // retrieves pointer to first stored byte and size of contiguous stored data behind it
+        const uint8_t* GetReadPointer(uint32_t &contiguousSize) const;
+        // retrieves stored data as up to two contiguous segments (the second one when wrapped); returns segment count
+        uint32_t GetReadSegments(const uint8_t* &first, uint32_t &firstSize, const uint8_t* &second, uint32_t &secondSize) const;
+        // copies data from buffer without removing them; fails, if there's not enough stored data
+        bool Peek(void* dst, uint32_t size, uint32_t offset = 0) const;
+        // copies data from buffer and removes them; fails, if there's not enough stored data
+        bool Read(void* dst, uint32_t size);
+        // removes specified count of bytes from the beginning of buffer
+        void Skip(uint32_t size);
+
+    private:
+        // buffer memory
+        uint8_t* m_buffer;
+        // buffer capacity
+        uint32_t m_capacity;
+        // position of first stored byte
+        uint32_t m_readPos;
+        // count of stored bytes
+        uint32_t m_usedSize;
+};
+
+#endif
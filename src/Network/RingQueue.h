@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_RINGQUEUE_H
+#define BW_RINGQUEUE_H
+
+#include <cstdint>
+
+/*
+ * Bounded queue with fixed storage for use within single thread; never allocates after construction
+ */
+template<class T, uint32_t Capacity>
+class RingQueue
+{
+    // cursors are free-running and wrap around, so the capacity has to divide 2^32
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "RingQueue capacity has to be power of two");
+
+    public:
+        RingQueue() : m_head(0), m_tail(0)
+        {
+            //
+        }
+
+        // puts item to the end of queue; fails, if the queue is full
+        bool Push(const T& item)
+        {
+            if (m_tail - m_head >= Capacity)
+                return false;
+
+            m_items[m_tail & (Capacity - 1)] = item;
+            m_tail++;
+            return true;
+        }
+
+        // retrieves the first item; the queue must not be empty
+        T& Front()
+        {
+            return m_items[m_head & (Capacity - 1)];
+        }
+
+        // removes the first item; the queue must not be empty
+        void PopFront()
+        {
+            m_head++;
+        }
+
+        // retrieves current count of items in queue
+        uint32_t GetSize() const
+        {
+            return m_tail - m_head;
+        }
+
+        // is the queue empty?
+        bool IsEmpty() const
+        {
+            return m_head == m_tail;
+        }
+
+        // retrieves queue capacity
+        uint32_t GetCapacity() const
+        {
+            return Capacity;
+        }
+
+    private:
+        // stored items
+        T m_items[Capacity];
+        // position of first item
+        uint32_t m_head;
+        // position behind last item
+        uint32_t m_tail;
+};
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_SPSCQUEUE_H
+#define BW_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+// assumed cache line size, used to keep producer and consumer data apart
+#define SPSC_CACHE_LINE_SIZE 64
+
+/*
+ * Bounded lock-free queue for exactly one producer thread and exactly one consumer thread
+ */
+template<class T>
+class SPSCQueue
+{
+    public:
+        // capacity is rounded up to power of two, as the cursors are free-running and wrap around
+        SPSCQueue(uint32_t capacity) : m_head(0), m_tail(0), m_highWaterMark(0)
+        {
+            m_capacity = 1;
+            while (m_capacity < capacity)
+                m_capacity <<= 1;
+
+            m_items = new T[m_capacity];
+        }
+
+        ~SPSCQueue()
+        {
+            delete[] m_items;
+        }
+
+        // the queue owns its memory, copying would lead to double free
+        SPSCQueue(const SPSCQueue&) = delete;
+        SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+        // puts item to the end of queue; fails, if the queue is full (producer thread only)
+        bool Push(const T& item)
+        {
+            uint32_t tail = m_tail.load(std::memory_order_relaxed);
+            uint32_t depth = tail - m_head.load(std::memory_order_acquire);
+
+            if (depth >= m_capacity)
+                return false;
+
+            m_items[tail & (m_capacity - 1)] = item;
+            m_tail.store(tail + 1, std::memory_order_release);
+
+            // only producer writes high-water mark, so there's no need to do compare-exchange
+            if (depth + 1 > m_highWaterMark.load(std::memory_order_relaxed))
+                m_highWaterMark.store(depth + 1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        // removes item from the beginning of queue; fails, if the queue is empty (consumer thread only)
+        bool Pop(T& item)
+        {
+            uint32_t head = m_head.load(std::memory_order_relaxed);
+
+            if (head == m_tail.load(std::memory_order_acquire))
+                return false;
+
+            item = m_items[head & (m_capacity - 1)];
+            m_head.store(head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // retrieves current count of items in queue (approximate when called from third thread)
+        uint32_t GetSize() const
+        {
+            return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+        }
+
+        // is the queue empty? (approximate when called from third thread)
+        bool IsEmpty() const
+        {
+            return GetSize() == 0;
+        }
+
+        // retrieves queue capacity
+        uint32_t GetCapacity() const
+        {
+            return m_capacity;
+        }
+
+        // retrieves the highest count of items ever present in queue
+        uint32_t GetHighWaterMark() const
+        {
+            return m_highWaterMark.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // stored items; set up in constructor, never changed afterwards
+        T* m_items;
+        // count of items the queue is able to hold
+        uint32_t m_capacity;
+
+        // position of first item; written by consumer
+        std::atomic<uint32_t> m_head;
+        // padding to keep cursors in separate cache lines
+        char m_headPadding[SPSC_CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+        // position behind last item; written by producer
+        std::atomic<uint32_t> m_tail;
+        // the highest count of items ever present; written by producer
+        std::atomic<uint32_t> m_highWaterMark;
+        // padding to keep producer data apart from anything behind the queue
+        char m_tailPadding[SPSC_CACHE_LINE_SIZE - 2 * sizeof(std::atomic<uint32_t>)];
+};
+
+#endif
@@ -21,12 +21,12 @@
 #include "SmartPacket.h"
 #include "Log.h"
 
-SmartPacket::SmartPacket() : m_opcode(0), m_size(0), m_readPos(0), m_writePos(0)
+SmartPacket::SmartPacket() : m_opcode(0), m_size(0), m_readPos(0), m_writePos(0), m_readError(false)
 {
     //
 }
 
-SmartPacket::SmartPacket(uint16_t opcode, uint16_t size) : m_opcode(opcode), m_size(size), m_readPos(0), m_writePos(0)
+SmartPacket::SmartPacket(uint16_t opcode, uint32_t size) : m_opcode(opcode), m_size(size), m_readPos(0), m_writePos(0), m_readError(false)
 {
     m_data.reserve(size);
 }
@@ -42,9 +42,41 @@ void SmartPacket::ResetData()
     m_size = 0;
     m_readPos = 0;
     m_writePos = 0;
+    m_readError = false;
 }
 
-void SmartPacket::SetReadPos(uint16_t pos)
+void SmartPacket::Initialize(uint16_t opcode, uint32_t size)
+{
+    m_opcode = opcode;
+    m_size = size;
+    m_readPos = 0;
+    m_writePos = 0;
+    m_readError = false;
+
+    // resize does not reallocate, when there's enough capacity
+    m_data.resize(size);
+}
+
+void SmartPacket::Reserve(uint32_t capacity)
+{
+    m_data.reserve(capacity);
+}
+
+uint32_t SmartPacket::GetCapacity()
+{
+    return (uint32_t)m_data.capacity();
+}
+
+void SmartPacket::ReleaseData()
+{
+    std::vector<uint8_t>().swap(m_data);
+    m_size = 0;
+    m_readPos = 0;
+    m_writePos = 0;
+    m_readError = false;
+}
+
+void SmartPacket::SetReadPos(uint32_t pos)
 {
     // do not allow setting cursor outside of data range
     if (pos > m_size)
@@ -56,18 +88,23 @@ void SmartPacket::SetReadPos(uint16_t pos)
     m_readPos = pos;
 }
 
-uint16_t SmartPacket::GetWritePos()
+uint32_t SmartPacket::GetWritePos()
 {
     return m_writePos;
 }
 
+uint32_t SmartPacket::GetRemainingSize()
+{
+    return (m_readPos < m_size) ? (m_size - m_readPos) : 0;
+}
+
 std::string SmartPacket::ReadString()
 {
     // we can detect only starting point being out of range at this time
     if (m_readPos >= m_size)
-        throw new PacketReadException(m_readPos, 1);
+        throw PacketReadException(m_readPos, 1);
 
-    int i;
+    uint32_t i;
 
     // find zero, or end of packet
     for (i = m_readPos; i < m_size; i++)
@@ -78,10 +115,10 @@ std::string SmartPacket::ReadString()
 
     // if we reached end without finding zero, that means, the string is not properly ended
     // or we just tried to read something, that's not string; by all means, this is errorneous state
-    if (m_data[i] != '\0')
-        throw new PacketReadException(m_readPos, m_size - m_readPos + 1);
+    if (i == m_size || m_data[i] != '\0')
+        throw PacketReadException(m_readPos, m_size - m_readPos + 1);
 
-    int oldReadPos = m_readPos;
+    uint32_t oldReadPos = m_readPos;
     // set read position one character further to skip the zero termination
     m_readPos = i + 1;
 
@@ -93,10 +130,88 @@ void SmartPacket::_Read(void* dst, size_t size)
 {
     // disallow reading more bytes than available
     if (m_readPos + size > m_size)
-        throw new PacketReadException(m_readPos, m_size);
+        throw PacketReadException(m_readPos, (int)size);
 
     memcpy(dst, &m_data[m_readPos], size);
-    m_readPos += (uint16_t)size;
+    m_readPos += (uint32_t)size;
+}
+
+bool SmartPacket::HasReadError()
+{
+    return m_readError;
+}
+
+bool SmartPacket::_CheckRead(uint64_t size)
+{
+    if ((uint64_t)m_readPos + size > m_size)
+    {
+        m_readError = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool SmartPacket::ReadBytes(void* dst, uint32_t size)
+{
+    if (!_CheckRead(size))
+        return false;
+
+    if (size > 0)
+        memcpy(dst, &m_data[m_readPos], size);
+    m_readPos += (uint32_t)size;
+
+    return true;
+}
+
+bool SmartPacket::ReadSpan(PacketSpan &span, uint32_t size)
+{
+    if (!_CheckRead(size))
+        return false;
+
+    span.data = m_data.data() + m_readPos;
+    span.size = size;
+    m_readPos += (uint32_t)size;
+
+    return true;
+}
+
+bool SmartPacket::ReadString(std::string &dst)
+{
+    const uint8_t* start = m_data.data() + m_readPos;
+    const uint8_t* end = (m_readPos < m_size) ? (const uint8_t*)memchr(start, '\0', m_size - m_readPos) : nullptr;
+
+    if (!end)
+    {
+        m_readError = true;
+        return false;
+    }
+
+    dst.assign((const char*)start, end - start);
+    m_readPos += (uint32_t)(end - start) + 1;
+
+    return true;
+}
+
+bool SmartPacket::ReadVarUInt32(uint32_t &value)
+{
+    value = 0;
+
+    // 32bit value spans at most 5 bytes; every byte except the last one has the highest bit set
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        if (!_CheckRead(1))
+            return false;
+
+        uint8_t byte = m_data[m_readPos++];
+        value |= (uint32_t)(byte & 0x7F) << (7 * i);
+
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+
+    m_readError = true;
+    return false;
 }
 
 uint64_t SmartPacket::ReadUInt64()
@@ -167,12 +282,23 @@ void SmartPacket::_Write(void* data, size_t size)
 {
     m_data.resize(m_writePos + 1 + size);
     memcpy(&m_data[m_writePos], data, size);
-    m_writePos += (uint16_t)size;
+    m_writePos += (uint32_t)size;
 
-    m_size += (uint16_t)size;
+    m_size += (uint32_t)size;
 }
 
-void SmartPacket::_WriteAt(void* data, size_t size, uint16_t position)
+uint8_t* SmartPacket::_WriteSpace(size_t size)
+{
+    m_data.resize(m_writePos + size);
+    uint8_t* dst = &m_data[m_writePos];
+    m_writePos += (uint32_t)size;
+
+    m_size += (uint32_t)size;
+
+    return dst;
+}
+
+void SmartPacket::_WriteAt(void* data, size_t size, uint32_t position)
 {
     memcpy(&m_data[position], data, size);
 }
@@ -234,24 +360,47 @@ void SmartPacket::WriteFloat(float val)
     _Write(&cval, sizeof(float));
 }
 
-void SmartPacket::WriteUInt32At(uint32_t val, uint16_t position)
+void SmartPacket::WriteBytes(const void* data, uint32_t size)
+{
+    if (size == 0)
+        return;
+
+    memcpy(_WriteSpace(size), data, size);
+}
+
+void SmartPacket::WriteVarUInt32(uint32_t val)
+{
+    uint8_t bytes[5];
+    uint32_t count = 0;
+
+    while (val >= 0x80)
+    {
+        bytes[count++] = (uint8_t)(val & 0x7F) | 0x80;
+        val >>= 7;
+    }
+    bytes[count++] = (uint8_t)val;
+
+    WriteBytes(bytes, count);
+}
+
+void SmartPacket::WriteUInt32At(uint32_t val, uint32_t position)
 {
     val = htonl(val);
     _WriteAt(&val, sizeof(uint32_t), position);
 }
 
-void SmartPacket::WriteUInt16At(uint16_t val, uint16_t position)
+void SmartPacket::WriteUInt16At(uint16_t val, uint32_t position)
 {
     val = htons(val);
     _WriteAt(&val, sizeof(uint16_t), position);
 }
 
-void SmartPacket::WriteUInt8At(uint8_t val, uint16_t position)
+void SmartPacket::WriteUInt8At(uint8_t val, uint32_t position)
 {
     _WriteAt(&val, sizeof(uint8_t), position);
 }
 
-void SmartPacket::SetData(uint8_t* data, uint16_t size)
+void SmartPacket::SetData(uint8_t* data, uint32_t size)
 {
     m_data = std::vector<uint8_t>(data, data + size);
 }
@@ -271,7 +420,7 @@ void SmartPacket::SetOpcode(uint16_t opcode)
     m_opcode = opcode;
 }
 
-uint16_t SmartPacket::GetSize()
+uint32_t SmartPacket::GetSize()
 {
     return m_size;
 }
@@ -25,6 +25,12 @@
 #include <vector>
 
 #include "Opcodes.h"
+#include "PacketLayout.h"
+
+// header size value announcing extended header - contents size follows as 32bit integer
+#define PACKET_EXTENDED_SIZE_MARKER     0xFFFF
+// maximum contents size of one packet; larger extended frames are considered protocol error
+#define PACKET_MAX_SIZE                 16*1024*1024
 
 /*
  * Exception class thrown when trying to read more than available remaining bytes
@@ -47,6 +53,17 @@ class PacketReadException : public std::exception
         int attemptSize;
 };
 
+/*
+ * Read-only view into packet contents; valid only until the packet is modified or reused
+ */
+struct PacketSpan
+{
+    // first byte of view
+    const uint8_t* data;
+    // count of bytes in view
+    uint32_t size;
+};
+
 /*
  * Class wrapping game packet header and contents
  */
@@ -56,29 +73,41 @@ class SmartPacket
         // default constructor, almost useless
         SmartPacket();
         // constructor for known packet headers
-        SmartPacket(uint16_t opcode, uint16_t size = 0);
+        SmartPacket(uint16_t opcode, uint32_t size = 0);
         ~SmartPacket();
 
         // size of header
         static const int HeaderSize = 2 * sizeof(uint16_t);
+        // size of extended header (header with size marker followed by 32bit contents size)
+        static const int ExtendedHeaderSize = HeaderSize + sizeof(uint32_t);
 
         // Sets opcode
         void SetOpcode(uint16_t opcode);
         // Sets data, typically when read from socket
-        void SetData(uint8_t* data, uint16_t size);
+        void SetData(uint8_t* data, uint32_t size);
         // Retrieves data array pointer
         uint8_t* GetData();
         // Retrieves packet opcode
         uint16_t GetOpcode();
         // Retrieves packet contents size (excluding header!)
-        uint16_t GetSize();
+        uint32_t GetSize();
         // Resets contents so the packet object could be reused
         void ResetData();
+        // Prepares recycled packet object for new opcode and contents of given size; keeps allocated memory if possible
+        void Initialize(uint16_t opcode, uint32_t size);
+        // Reserves memory for contents of given size
+        void Reserve(uint32_t capacity);
+        // Retrieves size of contents the packet could hold without reallocation
+        uint32_t GetCapacity();
+        // Releases memory allocated for contents
+        void ReleaseData();
 
         // Sets read cursor position
-        void SetReadPos(uint16_t pos);
+        void SetReadPos(uint32_t pos);
         // Retrieves location of write cursor
-        uint16_t GetWritePos();
+        uint32_t GetWritePos();
+        // Retrieves count of bytes not yet read
+        uint32_t GetRemainingSize();
 
         // Reads zero-terminated string on current location
         std::string ReadString();
@@ -101,6 +130,67 @@ class SmartPacket
         // Reads 32bit floating point number on current location
         float ReadFloat();
 
+        // Decodes fixed-size block described by layout on current location; when there's not enough data,
+        // fails and sets read error flag instead of throwing exception
+        template<class Layout>
+        bool Decode(typename Layout::Structure &dst)
+        {
+            if (!_CheckRead(Layout::Size))
+                return false;
+
+            Layout::DecodeFields(dst, &m_data[m_readPos]);
+            m_readPos += (uint32_t)Layout::Size;
+
+            return true;
+        }
+
+        // Decodes consecutive fixed-size blocks described by layout on current location with single bounds check;
+        // when there's not enough data, fails and sets read error flag instead of throwing exception
+        template<class Layout>
+        bool DecodeRepeated(typename Layout::Structure* dst, uint32_t count)
+        {
+            if (!_CheckRead((uint64_t)Layout::Size * count))
+                return false;
+
+            for (uint32_t i = 0; i < count; i++)
+                Layout::DecodeFields(dst[i], &m_data[m_readPos + i * Layout::Size]);
+            m_readPos += (uint32_t)(Layout::Size * count);
+
+            return true;
+        }
+
+        // Reads raw bytes on current location with single bounds check; when there's not enough data,
+        // fails and sets read error flag instead of throwing exception
+        bool ReadBytes(void* dst, uint32_t size);
+        // Retrieves view of raw bytes on current location without copying them; when there's not enough data,
+        // fails and sets read error flag instead of throwing exception
+        bool ReadSpan(PacketSpan &span, uint32_t size);
+        // Reads zero-terminated string on current location; when the string is not terminated within packet,
+        // fails and sets read error flag instead of throwing exception
+        bool ReadString(std::string &dst);
+        // Reads variable-length 32bit unsigned integer (7 bits per byte, least significant first) on current location;
+        // when the value is truncated or too long, fails and sets read error flag instead of throwing exception
+        bool ReadVarUInt32(uint32_t &value);
+
+        // Reads array of values on current location with single bounds check; when there's not enough data,
+        // fails and sets read error flag instead of throwing exception
+        template<typename T>
+        bool ReadArray(T* dst, uint32_t count)
+        {
+            if (!_CheckRead((uint64_t)PacketFieldCodec<T>::Size * count))
+                return false;
+
+            const uint8_t* src = &m_data[m_readPos];
+            for (uint32_t i = 0; i < count; i++)
+                dst[i] = PacketFieldCodec<T>::Decode(src + i * PacketFieldCodec<T>::Size);
+            m_readPos += (uint32_t)(PacketFieldCodec<T>::Size * count);
+
+            return true;
+        }
+
+        // Was there an attempt to read more data than available using methods without exceptions?
+        bool HasReadError();
+
         // Writes zero-terminated string on current location
         void WriteString(const char* str);
         // Writes 64bit unsigned integer on current location
@@ -122,33 +212,56 @@ class SmartPacket
         // Writes 32bit floating point number on current location
         void WriteFloat(float val);
 
+        // Writes raw bytes on current location
+        void WriteBytes(const void* data, uint32_t size);
+        // Writes variable-length 32bit unsigned integer (7 bits per byte, least significant first) on current location
+        void WriteVarUInt32(uint32_t val);
+
+        // Writes array of values on current location
+        template<typename T>
+        void WriteArray(const T* src, uint32_t count)
+        {
+            if (count == 0)
+                return;
+
+            uint8_t* dst = _WriteSpace(PacketFieldCodec<T>::Size * count);
+            for (uint32_t i = 0; i < count; i++)
+                PacketFieldCodec<T>::Encode(dst + i * PacketFieldCodec<T>::Size, src[i]);
+        }
+
         // Writes 32bit unsigned integer at specified position
-        void WriteUInt32At(uint32_t val, uint16_t position);
+        void WriteUInt32At(uint32_t val, uint32_t position);
         // Writes 16bit unsigned integer at specified position
-        void WriteUInt16At(uint16_t val, uint16_t position);
+        void WriteUInt16At(uint16_t val, uint32_t position);
         // Writes 8bit unsigned integer at specified position
-        void WriteUInt8At(uint8_t val, uint16_t position);
+        void WriteUInt8At(uint8_t val, uint32_t position);
 
     protected:
         // Internal method for reading general data regardless of their type
         void _Read(void* dst, size_t size);
+        // Internal method for checking remaining data before bulk read; sets read error flag on failure
+        bool _CheckRead(uint64_t size);
         // Internal method for writing general data regardless of their type
         void _Write(void* data, size_t size);
+        // Internal method for appending space for data, which is written directly afterwards; returns pointer to it
+        uint8_t* _WriteSpace(size_t size);
         // Internal method for writing general data regardless of their type on specified location
-        void _WriteAt(void* data, size_t size, uint16_t position);
+        void _WriteAt(void* data, size_t size, uint32_t position);
 
         // packet opcode
         uint16_t m_opcode;
         // contents size (excluding header)
-        uint16_t m_size;
+        uint32_t m_size;
 
         // packet contents (excluding header)
         std::vector<uint8_t> m_data;
 
         // read cursor (points to first byte, that will be read by next Read* method)
-        uint16_t m_readPos;
+        uint32_t m_readPos;
         // write cursor (points to first byte, that will be written by next Write* method)
-        uint16_t m_writePos;
+        uint32_t m_writePos;
+        // set when any Decode* method failed due to lack of data
+        bool m_readError;
 };
 
 #endif
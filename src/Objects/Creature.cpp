@@ -41,6 +41,7 @@ void Creature::CreateUpdateFields()
 
     m_updateFields = new uint32_t[UNIT_FIELDS_END];
     memset(m_updateFields, 0, sizeof(uint32_t) * UNIT_FIELDS_END);
+    m_updateFieldCount = UNIT_FIELDS_END;
 }
 
 bool Creature::CanTalkTo()
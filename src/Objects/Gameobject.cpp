@@ -41,4 +41,5 @@ void Gameobject::CreateUpdateFields()
 
     m_updateFields = new uint32_t[GAMEOBJECT_FIELDS_END];
     memset(m_updateFields, 0, sizeof(uint32_t) * GAMEOBJECT_FIELDS_END);
+    m_updateFieldCount = GAMEOBJECT_FIELDS_END;
 }
@@ -41,4 +41,5 @@ void Player::CreateUpdateFields()
 
     m_updateFields = new uint32_t[PLAYER_FIELDS_END];
     memset(m_updateFields, 0, sizeof(uint32_t) * PLAYER_FIELDS_END);
+    m_updateFieldCount = PLAYER_FIELDS_END;
 }
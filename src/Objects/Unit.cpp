@@ -26,10 +26,14 @@
 #include "ImageStorage.h"
 #include "StorageManager.h"
 #include "Log.h"
+#include "UpdateFieldRegistry.h"
+#include "Application.h"
 
 Unit::Unit(ObjectType type) : WorldObject(type), m_moveVector(0.0f, 0.0f)
 {
     m_moveMask = 0;
+    m_snapshotFirst = 0;
+    m_snapshotCount = 0;
     m_displayChatHide = 0;
     m_displayChat = nullptr;
 }
@@ -43,7 +47,11 @@ void Unit::Update()
 {
     WorldObject::Update();
 
-    if (m_moveMask != 0)
+    // remote units follow server snapshots
+    if (m_snapshotCount > 0)
+        UpdateInterpolatedPosition();
+    // local movement
+    else if (m_moveMask != 0)
     {
         uint32_t moveDiff = getMSTimeDiff(m_lastMovementUpdate, getMSTime());
         if (moveDiff >= 1)
@@ -166,6 +174,17 @@ void Unit::CreateUpdateFields()
     WorldObject::CreateUpdateFields();
 }
 
+void Unit::RegisterFieldSubscriptions()
+{
+    // movement vector is derived from movement speed
+    sUpdateFieldRegistry->Subscribe(UPDATEFIELD_BIT(UNIT_FIELD_MOVEMENT_SPEED), [](WorldObject* obj, uint64_t changed) -> bool {
+        Unit* unit = obj->ToUnit();
+        if (unit)
+            unit->UpdateMovementVector();
+        return false;
+    });
+}
+
 bool Unit::CanMoveOn(MapFieldType type, uint32_t flags)
 {
     // for now just ground type
@@ -255,21 +274,163 @@ static const uint32_t movementAnims[] = {
     ANIM_IDLE
 };
 
+Vector2 Unit::GetMovementVector(uint8_t moveMask)
+{
+    Vector2 vec(0.0f, 0.0f);
+
+    if (moveMask % 5 != 0)
+    {
+        vec.SetFromPolar(movementAngles[moveMask], GetFloatValue(UNIT_FIELD_MOVEMENT_SPEED));
+        vec.x *= MOVEMENT_UPDATE_UNIT_FRACTION;
+        vec.y *= MOVEMENT_UPDATE_UNIT_FRACTION;
+    }
+
+    return vec;
+}
+
 void Unit::UpdateMovementVector()
 {
-    if (m_moveMask % 5 == 0)
+    m_moveVector = GetMovementVector(m_moveMask);
+
+    SetAnimId(movementAnims[m_moveMask]);
+}
+
+MovementSnapshot& Unit::GetSnapshot(uint32_t order)
+{
+    return m_snapshots[(m_snapshotFirst + order) % UNIT_MOVEMENT_SNAPSHOT_COUNT];
+}
+
+void Unit::AddMovementSnapshot(uint32_t time, float x, float y, uint8_t moveMask)
+{
+    // keep snapshots ordered; packets handled later could not be older than the newest one
+    if (m_snapshotCount > 0 && (int32_t)(time - GetSnapshot(m_snapshotCount - 1).time) < 0)
+        time = GetSnapshot(m_snapshotCount - 1).time;
+
+    // drop the oldest one, when full
+    if (m_snapshotCount == UNIT_MOVEMENT_SNAPSHOT_COUNT)
+    {
+        m_snapshotFirst = (m_snapshotFirst + 1) % UNIT_MOVEMENT_SNAPSHOT_COUNT;
+        m_snapshotCount--;
+    }
+
+    MovementSnapshot &snap = GetSnapshot(m_snapshotCount);
+    snap.time = time;
+    snap.position = Position(x, y);
+    snap.moveMask = moveMask & 0x0F;
+
+    m_snapshotCount++;
+}
+
+void Unit::AddMovementSnapshot(uint32_t time, uint8_t moveMask)
+{
+    Position pos = m_position;
+
+    // continue from where the unit would be according to previous snapshot
+    if (m_snapshotCount > 0)
+        pos = ExtrapolateSnapshot(GetSnapshot(m_snapshotCount - 1), time);
+
+    AddMovementSnapshot(time, pos.x, pos.y, moveMask);
+}
+
+uint8_t Unit::GetLatestMoveMask()
+{
+    if (m_snapshotCount > 0)
+        return GetSnapshot(m_snapshotCount - 1).moveMask;
+
+    return m_moveMask;
+}
+
+bool Unit::IsInterpolated()
+{
+    return (m_snapshotCount > 0);
+}
+
+uint8_t Unit::GetMoveMask()
+{
+    return m_moveMask;
+}
+
+Position Unit::ExtrapolateSnapshot(MovementSnapshot &snapshot, uint32_t time)
+{
+    int32_t diff = (int32_t)(time - snapshot.time);
+    if (diff <= 0 || snapshot.moveMask % 5 == 0)
+        return snapshot.position;
+
+    // no cap here; heartbeats are sent on movement changes only (and at most every MOVEMENT_HEARTBEAT_MAX_INTERVAL
+    // when drifting), so a unit walking straight has to keep walking until the server says otherwise
+
+    Vector2 vec = GetMovementVector(snapshot.moveMask);
+
+    return Position(snapshot.position.x + vec.x * (float)diff, snapshot.position.y + vec.y * (float)diff);
+}
+
+Position Unit::SampleSnapshots(uint32_t time)
+{
+    uint32_t i;
+
+    // not yet at the oldest snapshot, hold it
+    if ((int32_t)(time - GetSnapshot(0).time) <= 0)
+        return GetSnapshot(0).position;
+
+    // find the newest snapshot not newer than requested time
+    for (i = m_snapshotCount - 1; i > 0; i--)
     {
-        m_moveVector.x = 0;
-        m_moveVector.y = 0;
+        if ((int32_t)(time - GetSnapshot(i).time) >= 0)
+            break;
     }
-    else
+
+    MovementSnapshot &from = GetSnapshot(i);
+
+    // beyond the newest snapshot - extrapolate
+    if (i == m_snapshotCount - 1)
+        return ExtrapolateSnapshot(from, time);
+
+    MovementSnapshot &to = GetSnapshot(i + 1);
+
+    uint32_t span = to.time - from.time;
+    if (span == 0)
+        return to.position;
+
+    float coef = (float)(time - from.time) / (float)span;
+
+    return Position(from.position.x + (to.position.x - from.position.x) * coef, from.position.y + (to.position.y - from.position.y) * coef);
+}
+
+void Unit::UpdateInterpolatedPosition()
+{
+    // we display the past, so there's always some snapshot to interpolate towards
+    uint32_t renderTime = getMSTime() - UNIT_INTERPOLATION_DELAY;
+
+    // throw away snapshots we already passed, keep the one we interpolate from
+    while (m_snapshotCount > 1 && (int32_t)(renderTime - GetSnapshot(1).time) >= 0)
     {
-        m_moveVector.SetFromPolar(movementAngles[m_moveMask], GetFloatValue(UNIT_FIELD_MOVEMENT_SPEED));
-        m_moveVector.x *= MOVEMENT_UPDATE_UNIT_FRACTION;
-        m_moveVector.y *= MOVEMENT_UPDATE_UNIT_FRACTION;
+        m_snapshotFirst = (m_snapshotFirst + 1) % UNIT_MOVEMENT_SNAPSHOT_COUNT;
+        m_snapshotCount--;
     }
 
-    SetAnimId(movementAnims[m_moveMask]);
+    // movement mask (and therefore animation) follows the displayed snapshot
+    uint8_t moveMask = ((int32_t)(renderTime - GetSnapshot(0).time) >= 0) ? GetSnapshot(0).moveMask : m_moveMask;
+    if (moveMask != m_moveMask)
+    {
+        bool wasMoving = (m_moveMask != 0);
+
+        m_moveMask = moveMask;
+        UpdateMovementVector();
+
+        if (!wasMoving && m_moveMask != 0)
+            OnMoveStart();
+        else if (wasMoving && m_moveMask == 0)
+            OnMoveStop();
+
+        sDrawing->SetCanvasRedrawFlag();
+    }
+
+    Position pos = SampleSnapshots(renderTime);
+    if (pos.x != m_position.x || pos.y != m_position.y)
+    {
+        SetPosition(pos.x, pos.y);
+        sDrawing->SetCanvasRedrawFlag();
+    }
 }
 
 SDL_Texture* Unit::GetDisplayChat()
@@ -288,6 +449,10 @@ void Unit::Talk(TalkType type, const wchar_t* str)
 {
     m_displayChatTalkType = type;
 
+    // headless bot does not render chat bubbles
+    if (sApplication->IsHeadless())
+        return;
+
     SDL_Surface* textsurf = sDrawing->RenderFontWrappedUnicode(FONT_CHAT, str, 200, BWCOLOR_BLUE);
     if (!textsurf)
         return;
@@ -28,6 +28,24 @@ enum MapFieldType;
 // this is the number which we use to multiply movement vector
 #define MOVEMENT_UPDATE_UNIT_FRACTION 0.001f
 
+// delay of displayed remote unit position behind the time snapshots arrive (ms); should cover heartbeat interval
+#define UNIT_INTERPOLATION_DELAY        100
+// count of movement snapshots kept for every remote unit
+#define UNIT_MOVEMENT_SNAPSHOT_COUNT    8
+
+/*
+ * Structure of remote unit movement snapshot
+ */
+struct MovementSnapshot
+{
+    // local time of snapshot arrival
+    uint32_t time;
+    // unit position
+    Position position;
+    // movement mask valid since this snapshot
+    uint8_t moveMask;
+};
+
 /*
  * Class for all "alive" objects in game (player, NPC)
  */
@@ -39,6 +57,9 @@ class Unit : public WorldObject
         virtual void InitializeObject(uint64_t guid);
         virtual void Update();
 
+        // registers updatefield change subscriptions of this class
+        static void RegisterFieldSubscriptions();
+
         // called when movement starts (from stopped state)
         virtual void OnMoveStart();
         // called when movement completelly stops
@@ -59,6 +80,19 @@ class Unit : public WorldObject
         // can the unit move over this field type?
         bool CanMoveOn(MapFieldType type, uint32_t flags);
 
+        // stores server position of remote unit; displayed position is then interpolated between snapshots
+        void AddMovementSnapshot(uint32_t time, float x, float y, uint8_t moveMask);
+        // stores movement change of remote unit without known position; it's extrapolated from previous snapshot
+        void AddMovementSnapshot(uint32_t time, uint8_t moveMask);
+        // retrieves movement mask of the newest snapshot, or current movement mask when there's none
+        uint8_t GetLatestMoveMask();
+        // is the unit position driven by server snapshots?
+        bool IsInterpolated();
+        // retrieves current movement mask
+        uint8_t GetMoveMask();
+        // calculates movement vector ("distance per millisecond") for specified movement mask
+        Vector2 GetMovementVector(uint8_t moveMask);
+
     protected:
         // protected constructor; instantiate child classes only
         Unit(ObjectType type);
@@ -67,6 +101,15 @@ class Unit : public WorldObject
         // updates movement vector after moveMask change
         void UpdateMovementVector();
 
+        // retrieves snapshot by its age order (0 = the oldest one)
+        MovementSnapshot& GetSnapshot(uint32_t order);
+        // calculates position at specified time from snapshot, using its movement mask
+        Position ExtrapolateSnapshot(MovementSnapshot &snapshot, uint32_t time);
+        // calculates position at specified time from stored snapshots
+        Position SampleSnapshots(uint32_t time);
+        // updates displayed position and movement mask from snapshots
+        void UpdateInterpolatedPosition();
+
         // current movement mask (ORed movement direction elements)
         uint8_t m_moveMask;
         // calculated movement unit vector ("distance per millisecond")
@@ -74,6 +117,13 @@ class Unit : public WorldObject
         // last movement update time (mstime)
         uint32_t m_lastMovementUpdate;
 
+        // movement snapshots of remote unit (ring buffer)
+        MovementSnapshot m_snapshots[UNIT_MOVEMENT_SNAPSHOT_COUNT];
+        // position of the oldest snapshot in ring buffer
+        uint32_t m_snapshotFirst;
+        // count of stored snapshots
+        uint32_t m_snapshotCount;
+
         // chat bubble texture
         SDL_Texture* m_displayChat;
         // timestamp of chat bubble hide
@@ -0,0 +1,67 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "UpdateFieldRegistry.h"
+#include "WorldObject.h"
+#include "Unit.h"
+
+// dirty field mask has one bit per updatefield
+static_assert(PLAYER_FIELDS_END <= 64 && GAMEOBJECT_FIELDS_END <= 64, "Updatefield count exceeds dirty mask width");
+
+UpdateFieldRegistry::UpdateFieldRegistry()
+{
+    m_initialized = false;
+}
+
+void UpdateFieldRegistry::Initialize()
+{
+    if (m_initialized)
+        return;
+
+    WorldObject::RegisterFieldSubscriptions();
+    Unit::RegisterFieldSubscriptions();
+
+    m_initialized = true;
+}
+
+void UpdateFieldRegistry::Subscribe(uint64_t fieldMask, UpdateFieldCallback callback)
+{
+    UpdateFieldSubscription sub;
+    sub.fieldMask = fieldMask;
+    sub.callback = callback;
+    m_subscriptions.push_back(sub);
+}
+
+bool UpdateFieldRegistry::Dispatch(WorldObject* obj, uint64_t changedMask)
+{
+    bool visible = false;
+
+    // call only subscribers interested in changed fields
+    for (UpdateFieldSubscription& sub : m_subscriptions)
+    {
+        if (sub.fieldMask & changedMask)
+        {
+            if (sub.callback(obj, sub.fieldMask & changedMask))
+                visible = true;
+        }
+    }
+
+    return visible;
+}
@@ -0,0 +1,71 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_UPDATEFIELD_REGISTRY_H
+#define BW_UPDATEFIELD_REGISTRY_H
+
+#include "Singleton.h"
+
+class WorldObject;
+
+// bit of updatefield in dirty field mask
+#define UPDATEFIELD_BIT(field) (((uint64_t)1) << (field))
+
+// subscriber callback; receives object and mask of changed fields, returns true if visible property changed
+typedef std::function<bool(WorldObject*, uint64_t)> UpdateFieldCallback;
+
+/*
+ * Structure of one updatefield change subscription
+ */
+struct UpdateFieldSubscription
+{
+    // mask of fields the subscriber is interested in
+    uint64_t fieldMask;
+    // callback to be called when any of fields changes
+    UpdateFieldCallback callback;
+};
+
+/*
+ * Singleton class maintaining subscriptions of subsystems to updatefield changes
+ */
+class UpdateFieldRegistry
+{
+    friend class Singleton<UpdateFieldRegistry>;
+    public:
+        // registers subscriptions of all object classes
+        void Initialize();
+        // subscribes callback to changes of fields in supplied mask
+        void Subscribe(uint64_t fieldMask, UpdateFieldCallback callback);
+        // notifies subscribers of changed fields; returns true if visible property changed
+        bool Dispatch(WorldObject* obj, uint64_t changedMask);
+
+    protected:
+        // protected singleton constructor
+        UpdateFieldRegistry();
+
+    private:
+        // registered subscriptions
+        std::vector<UpdateFieldSubscription> m_subscriptions;
+        // was the registry initialized?
+        bool m_initialized;
+};
+
+#define sUpdateFieldRegistry Singleton<UpdateFieldRegistry>::getInstance()
+
+#endif
@@ -29,12 +29,16 @@
 #include "Gameplay.h"
 #include "Colors.h"
 #include "Map.h"
+#include "UpdateFieldRegistry.h"
 
 WorldObject::WorldObject(ObjectType type) : m_position(0.0f, 0.0f), m_mapId(0), m_objectType(type)
 {
     m_animId = -1;
     m_animFrame = 0;
     m_animTimer = getMSTime();
+    m_dirtyFields = 0;
+    m_updateFields = nullptr;
+    m_updateFieldCount = 0;
 
     m_name = L"???";
     m_nameTexture = nullptr;
@@ -82,15 +86,70 @@ Creature* WorldObject::ToCreature()
 
 void WorldObject::ApplyValueSet(uint8_t* values, uint32_t size)
 {
-    memcpy(m_updateFields, values, size);
+    uint32_t* newValues = (uint32_t*)values;
+
+    // fields beyond the ones this object has are ignored
+    uint32_t count = num_min(size / (uint32_t)sizeof(uint32_t), m_updateFieldCount);
+
+    // compare field by field to know, what changed
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (m_updateFields[i] != newValues[i])
+            MarkFieldDirty(i);
+    }
+
+    memcpy(m_updateFields, values, count * sizeof(uint32_t));
+}
+
+void WorldObject::MarkFieldDirty(uint32_t field)
+{
+    // fields beyond mask width cannot have subscribers
+    if (field < 64)
+        m_dirtyFields |= UPDATEFIELD_BIT(field);
+}
+
+uint32_t WorldObject::GetUpdateFieldCount()
+{
+    return m_updateFieldCount;
+}
+
+bool WorldObject::ProcessFieldChanges()
+{
+    if (!m_dirtyFields)
+        return false;
+
+    // clear mask before dispatching, subscribers may change fields again
+    uint64_t changed = m_dirtyFields;
+    m_dirtyFields = 0;
+
+    return sUpdateFieldRegistry->Dispatch(this, changed);
+}
+
+void WorldObject::RegisterFieldSubscriptions()
+{
+    // name color depends on faction
+    sUpdateFieldRegistry->Subscribe(UPDATEFIELD_BIT(UNIT_FIELD_FACTION), [](WorldObject* obj, uint64_t changed) -> bool {
+        obj->InvalidateNameTexture();
+        return true;
+    });
+
+    // changed image is immediatelly visible
+    sUpdateFieldRegistry->Subscribe(UPDATEFIELD_BIT(OBJECT_FIELD_IMAGEID), [](WorldObject* obj, uint64_t changed) -> bool {
+        return true;
+    });
 }
 
 void WorldObject::SetUInt32Value(uint32_t field, uint32_t value)
 {
+    // field index may come from network, do not write past updatefields
+    if (field >= m_updateFieldCount)
+        return;
+
     if (m_updateFields[field] == value)
         return;
 
     m_updateFields[field] = value;
+    MarkFieldDirty(field);
 }
 
 void WorldObject::SetUInt64Value(uint32_t field, uint64_t value)
@@ -102,13 +161,14 @@ void WorldObject::SetUInt64Value(uint32_t field, uint64_t value)
 void WorldObject::SetUByteValue(uint32_t field, uint8_t offset, uint8_t value)
 {
     // allowed offsets are 0-3, as there are 4 bytes in uint32_t
-    if (offset > 3)
+    if (offset > 3 || field >= m_updateFieldCount)
         return;
 
     if (m_updateFields[field] >> (offset * 8) == value)
         return;
 
     m_updateFields[field] = m_updateFields[field] & (~(0xFF << (offset * 8))) | (value << (offset * 8));
+    MarkFieldDirty(field);
 }
 
 void WorldObject::SetInt32Value(uint32_t field, int32_t value)
@@ -170,12 +230,17 @@ float WorldObject::GetFloatValue(uint32_t field)
 void WorldObject::SetName(const wchar_t* name)
 {
     m_name = name;
+    InvalidateNameTexture();
+    sDrawing->SetCanvasRedrawFlag();
+}
+
+void WorldObject::InvalidateNameTexture()
+{
     if (m_nameTexture)
     {
         SDL_DestroyTexture(m_nameTexture);
         m_nameTexture = nullptr;
     }
-    sDrawing->SetCanvasRedrawFlag();
 }
 
 const wchar_t* WorldObject::GetName()
@@ -303,10 +368,13 @@ void WorldObject::SetPosition(Position pos)
 
 void WorldObject::SetPosition(float x, float y)
 {
+    bool depthChanged = (m_position.y != y);
+
     m_position.x = x;
     m_position.y = y;
 
-    if (GetMap())
+    // visibility order depends just on Y coordinate
+    if (depthChanged && GetMap())
         GetMap()->CheckObjectVisibilityIndex(m_visibilityIndex);
 }
 
@@ -317,6 +385,9 @@ void WorldObject::SetPositionX(float x)
 
 void WorldObject::SetPositionY(float y)
 {
+    if (m_position.y == y)
+        return;
+
     m_position.y = y;
 
     if (GetMap())
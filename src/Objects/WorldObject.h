@@ -125,7 +125,7 @@ class WorldObject
         // casts object to Creature class, if possible; otherwise returns nullptr
         Creature* ToCreature();
 
-        // overrides updatefield values with supplied
+        // overrides updatefield values with supplied; values past object updatefield count are ignored
         void ApplyValueSet(uint8_t* values, uint32_t size);
 
         // sets 32bit unsigned field value
@@ -156,6 +156,13 @@ class WorldObject
         int8_t GetByteValue(uint32_t field, uint8_t offset);
         // retrieves float field value
         float GetFloatValue(uint32_t field);
+        // retrieves count of updatefields of this object
+        uint32_t GetUpdateFieldCount();
+        // notifies subscribers of changed fields and clears dirty mask; returns true if visible property changed
+        bool ProcessFieldChanges();
+
+        // registers updatefield change subscriptions of this class
+        static void RegisterFieldSubscriptions();
 
         // retrieves animation timer
         uint32_t GetAnimTimer();
@@ -180,6 +187,10 @@ class WorldObject
         WorldObject(ObjectType type);
         // allocate update field space and nullify contents
         virtual void CreateUpdateFields();
+        // marks updatefield as changed
+        void MarkFieldDirty(uint32_t field);
+        // destroys prerendered name texture, so it would be rendered again
+        void InvalidateNameTexture();
 
         // object name
         std::wstring m_name;
@@ -187,6 +198,10 @@ class WorldObject
         Position m_position;
         // updatefields
         uint32_t* m_updateFields;
+        // count of allocated updatefields
+        uint32_t m_updateFieldCount;
+        // mask of updatefields changed since last processing
+        uint64_t m_dirtyFields;
         // current map ID
         uint32_t m_mapId;
         // type of object
@@ -77,6 +77,46 @@ void ResourceManager::SignalResourceMetadataRetrieved(ResourceType type, uint32_
     }
 }
 
+void ResourceManager::SignalResourceVerified(ResourceType type, uint32_t id, bool valid)
+{
+    // the resource may not be used yet (verification of whole cache); it will be loaded when needed
+    ResourceMap::iterator itr = m_resources[type].find(id);
+    if (itr == m_resources[type].end())
+        return;
+
+    // retrieve fresh copy
+    if (!valid)
+    {
+        RequestResource(type, id);
+        return;
+    }
+
+    // the resource was waiting for verification
+    if (itr->second->loadState == RLS_VERIFYING)
+    {
+        itr->second->loadState = RLS_NOT_LOADED;
+
+        if (type == RSTYPE_IMAGE)
+        {
+            LoadImageResource((ImageResource*)itr->second);
+            sDrawing->SetUIRedrawFlag();
+        }
+    }
+}
+
+void ResourceManager::SignalResourceMetadataVerified(ResourceType type, uint32_t id, bool valid)
+{
+    // the resource may not be used yet (verification of whole cache); it will be loaded when needed
+    ResourceMap::iterator itr = m_resources[type].find(id);
+    if (itr == m_resources[type].end())
+        return;
+
+    if (valid)
+        SignalResourceMetadataRetrieved(type, id);
+    else
+        RequestResourceMetadata(type, id);
+}
+
 ImageResource* ResourceManager::GetOrCreateImageResource(uint32_t id, bool isInternal)
 {
     ImageResource* imgres;
@@ -209,11 +249,17 @@ void ResourceManager::CacheAnimSpriteRectagles(ImageResource* imgres)
 void ResourceManager::LoadImageResourceMeta(ImageResource* imgres)
 {
     // loading should not already be in progress
-    if (imgres->metaLoadState != RLS_RETRIEVING && imgres->metaLoadState != RLS_LOADING_FROM_FILE)
+    if (imgres->metaLoadState != RLS_RETRIEVING && imgres->metaLoadState != RLS_LOADING_FROM_FILE && imgres->metaLoadState != RLS_VERIFYING)
     {
         ImageMetadataDatabaseRecord* rec = !imgres->isInternal ? sImageStorage->GetImageMetadataRecord(imgres->id) : sInternalImageStorage->GetImageMetadataRecord(imgres->id);
+        // we know about this image, but nothing is used before the server confirms it's up to date (internal resources are pure client-side)
+        if (rec && !imgres->isInternal && !sResourceStreamManager->IsMetadataChecksumVerified(RSTYPE_IMAGE, imgres->id))
+        {
+            imgres->metaLoadState = RLS_VERIFYING;
+            sResourceStreamManager->SendVerifyMetadataChecksumPacket(RSTYPE_IMAGE, imgres->id, rec->checksum.c_str());
+        }
         // we know about this image
-        if (rec)
+        else if (rec)
         {
             imgres->metaLoadState = RLS_LOADED;
             imgres->metadata = rec;
@@ -221,9 +267,6 @@ void ResourceManager::LoadImageResourceMeta(ImageResource* imgres)
             CacheAnimSpriteRectagles(imgres);
 
             sDrawing->SetCanvasRedrawFlag();
-
-            if (!imgres->isInternal)
-                sResourceStreamManager->SendVerifyMetadataChecksumPacket(RSTYPE_IMAGE, imgres->id, rec->checksum.c_str());
         }
         else
         {
@@ -236,11 +279,18 @@ void ResourceManager::LoadImageResourceMeta(ImageResource* imgres)
 void ResourceManager::LoadImageResource(ImageResource* imgres)
 {
     // loading should not already be in progress (also prohibit state: loaded + metadata loading)
-    if (imgres->loadState != RLS_RETRIEVING && imgres->loadState != RLS_LOADING_FROM_FILE && !(imgres->loadState == RLS_LOADED && imgres->metaLoadState == RLS_RETRIEVING))
+    if (imgres->loadState != RLS_RETRIEVING && imgres->loadState != RLS_LOADING_FROM_FILE && imgres->loadState != RLS_VERIFYING && !(imgres->loadState == RLS_LOADED && imgres->metaLoadState == RLS_RETRIEVING))
     {
         ImageDatabaseRecord* rec = !imgres->isInternal ? sImageStorage->GetImageRecord(imgres->id) : sInternalImageStorage->GetImageRecord(imgres->id);
+        // we know about this resource, but it's not shown until the server confirms it's up to date; usually
+        // the verification was already sent at login, so we just wait for its result
+        if (rec && !imgres->isInternal && !sResourceStreamManager->IsResourceChecksumVerified(RSTYPE_IMAGE, imgres->id))
+        {
+            imgres->loadState = RLS_VERIFYING;
+            sResourceStreamManager->SendVerifyChecksumPacket(RSTYPE_IMAGE, imgres->id, rec->checksumStr.c_str());
+        }
         // we know about this resource
-        if (rec)
+        else if (rec)
         {
             imgres->loadState = RLS_LOADING_FROM_FILE;
             SDL_Surface* imgsurface = IMG_Load((std::string(DATA_DIR) + rec->filename).c_str());
@@ -268,14 +318,6 @@ void ResourceManager::LoadImageResource(ImageResource* imgres)
                 sLog->Error("Could not load image (ID: %u) from file %s", imgres->id, rec->filename.c_str());
             }
 
-            // i know i would read this later, so.. my idea is to draw the old resource,
-            // send checksum verify packet and if the checksum does not match, request the
-            // resource once again, drop old texture, load new texture and redraw
-
-            // internal resources are pure client-side - i.e. UI textures, etc.
-
-            if (!imgres->isInternal)
-                sResourceStreamManager->SendVerifyChecksumPacket(RSTYPE_IMAGE, imgres->id, rec->checksumStr.c_str());
         }
         else
         {
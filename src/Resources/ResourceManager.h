@@ -29,6 +29,7 @@ enum ResourceLoadState
     RLS_RETRIEVING = 2,             // resource is being retrieved from remote server
     RLS_LOADING_FROM_FILE = 3,      // resource is being loaded from file
     RLS_LOADED = 4,                 // resource is loaded and directly available
+    RLS_VERIFYING = 5,              // resource is cached, but waits for checksum verification before use
     MAX_RLS
 };
 
@@ -83,6 +84,10 @@ class ResourceManager
         void SignalResourceRetrieved(ResourceType type, uint32_t id);
         // signals resource manager about resource metadata retrieval
         void SignalResourceMetadataRetrieved(ResourceType type, uint32_t id);
+        // signals resource manager about result of cached resource checksum verification
+        void SignalResourceVerified(ResourceType type, uint32_t id, bool valid);
+        // signals resource manager about result of cached resource metadata checksum verification
+        void SignalResourceMetadataVerified(ResourceType type, uint32_t id, bool valid);
         // retrieves prerendered image
         SDL_Texture* GetImage(uint32_t id);
         // retrieves image metadata
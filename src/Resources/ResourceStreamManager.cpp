@@ -25,13 +25,14 @@
 #include "Log.h"
 #include "SmartPacket.h"
 #include "NetworkManager.h"
+#include "ImageStorage.h"
 
 #include <iomanip>
 #include <sstream>
 
 ResourceStreamManager::ResourceStreamManager()
 {
-    //
+    m_nextChecksumBatchId = 1;
 }
 
 ResourceStreamManager::~ResourceStreamManager()
@@ -53,7 +54,7 @@ void ResourceStreamManager::CreateResourceStream(const char* filename, ResourceT
     m_resourceStreams[pos] = rs;
 }
 
-void ResourceStreamManager::WriteToResourceStream(ResourceType type, uint32_t id, uint16_t size, uint8_t* data)
+void ResourceStreamManager::WriteToResourceStream(ResourceType type, uint32_t id, uint32_t size, const uint8_t* data)
 {
     uint64_t pos = MAKE_RES_PAIR(id, type);
     ResourceStreamRecord* rs = m_resourceStreams[pos];
@@ -100,47 +101,73 @@ void ResourceStreamManager::FinishResourceStream(ResourceType type, uint32_t id)
 
 void ResourceStreamManager::SendVerifyChecksumPacket(ResourceType type, uint32_t id, const char* checksum)
 {
-    // if checksum already verified, do not verify again
-    if (IsResourceChecksumVerified(type, id))
-        return;
+    std::list<ResourceChecksumContainer> resList;
+    ResourceChecksumContainer res;
+
+    res.type = type;
+    res.id = id;
+    res.checksum = checksum;
+    resList.push_back(res);
 
-    SmartPacket pkt(CP_RESOURCE_VERIFY_CHECKSUM);
-    pkt.WriteUInt16(1);
-    pkt.WriteUInt8(type);
-    pkt.WriteUInt32(id);
-    pkt.WriteString(checksum);
-    sNetwork->SendPacket(pkt);
+    SendVerifyChecksumsPacket(resList);
 }
 
 void ResourceStreamManager::SendVerifyChecksumsPacket(std::list<ResourceChecksumContainer> &resList)
 {
-    std::list<ResourceChecksumContainer>::iterator itr = resList.begin();
+    std::list<ResourceChecksumContainer>::iterator itr;
+    std::vector<uint64_t> batch;
+    uint64_t pos;
 
-    uint16_t cnt;
-    for (int i = 0; i < resList.size(); i++)
+    // leave out everything already verified or being verified
+    for (itr = resList.begin(); itr != resList.end(); )
     {
+        if (IsResourceChecksumVerified((*itr).type, (*itr).id) || IsResourceChecksumPending((*itr).type, (*itr).id))
+            itr = resList.erase(itr);
+        else
+            ++itr;
+    }
+
+    bool batchIds = (sNetwork->GetProtocolCapabilities() & PROTOCOL_CAP_CHECKSUM_BATCH_ID) != 0;
+
+    itr = resList.begin();
+    while (itr != resList.end())
+    {
+        uint16_t cnt = (uint16_t)num_min((size_t)MAX_CHECKSUM_VERIFY_ITEMS, (size_t)std::distance(itr, resList.end()));
+        uint32_t batchId = m_nextChecksumBatchId++;
+
         SmartPacket pkt(CP_RESOURCE_VERIFY_CHECKSUM);
-        cnt = num_min(MAX_CHECKSUM_VERIFY_ITEMS, (uint16_t) resList.size() - 1 - i);
+        if (batchIds)
+            pkt.WriteUInt32(batchId);
         pkt.WriteUInt16(cnt);
 
-        for (int j = 0; j < cnt; j++)
+        batch.clear();
+        for (uint16_t j = 0; j < cnt; j++)
         {
             pkt.WriteUInt8((*itr).type);
             pkt.WriteUInt32((*itr).id);
             pkt.WriteString((*itr).checksum);
+
+            pos = MAKE_RES_PAIR((*itr).id, (*itr).type);
+            batch.push_back(pos);
             ++itr;
         }
 
-        i += cnt;
+        // dropped packet gets no reply; without batch IDs it would also pair all later replies with wrong batches
+        if (!sNetwork->SendPacket(pkt))
+        {
+            m_unsentChecksums.insert(batch.begin(), batch.end());
+            continue;
+        }
 
-        sNetwork->SendPacket(pkt);
+        m_pendingChecksums.insert(batch.begin(), batch.end());
+        m_pendingChecksumBatches[batchId].swap(batch);
     }
 }
 
 void ResourceStreamManager::SendVerifyMetadataChecksumPacket(ResourceType type, uint32_t id, const char* checksum)
 {
-    // if checksum already verified, do not verify again
-    if (IsMetadataChecksumVerified(type, id))
+    // if checksum already verified or being verified, do not verify again
+    if (IsMetadataChecksumVerified(type, id) || IsMetadataChecksumPending(type, id))
         return;
 
     if (type == RSTYPE_IMAGE)
@@ -148,27 +175,181 @@ void ResourceStreamManager::SendVerifyMetadataChecksumPacket(ResourceType type,
         SmartPacket pkt(CP_VERIFY_IMAGE_METADATA_CHECKSUM);
         pkt.WriteUInt32(id);
         pkt.WriteString(checksum);
-        sNetwork->SendPacket(pkt);
+
+        uint64_t pos = MAKE_RES_PAIR(id, type);
+        if (sNetwork->SendPacket(pkt))
+            m_pendingMetadataChecksums.insert(pos);
+        else
+            m_unsentMetadataChecksums.insert(pos);
     }
 }
 
+void ResourceStreamManager::ResendUnsentChecksums()
+{
+    if (m_unsentChecksums.empty() && m_unsentMetadataChecksums.empty())
+        return;
+
+    ConnectionState state = sNetwork->GetConnectionState();
+    if (state != CONNECTION_STATE_LOBBY && state != CONNECTION_STATE_INGAME)
+        return;
+
+    std::list<ResourceChecksumContainer> resList;
+    ResourceChecksumContainer res;
+    std::set<uint64_t> unsent;
+
+    // checksums are retrieved again, the resource could have changed in the meantime
+    unsent.swap(m_unsentChecksums);
+    for (std::set<uint64_t>::iterator itr = unsent.begin(); itr != unsent.end(); ++itr)
+    {
+        res.type = (ResourceType)(*itr & 0xFFFFFFFF);
+        res.id = (uint32_t)(*itr >> 32);
+        res.checksum = sResourceManager->GetResourceFileChecksum(res.type, res.id);
+        if (res.checksum)
+            resList.push_back(res);
+    }
+
+    SendVerifyChecksumsPacket(resList);
+
+    unsent.clear();
+    unsent.swap(m_unsentMetadataChecksums);
+    for (std::set<uint64_t>::iterator itr = unsent.begin(); itr != unsent.end(); ++itr)
+    {
+        ResourceType type = (ResourceType)(*itr & 0xFFFFFFFF);
+        uint32_t id = (uint32_t)(*itr >> 32);
+        const char* checksum = GetMetadataChecksum(type, id);
+        if (checksum)
+            SendVerifyMetadataChecksumPacket(type, id, checksum);
+    }
+}
+
+void ResourceStreamManager::RequeuePendingChecksums()
+{
+    // every batched resource is in pending set as well
+    m_unsentChecksums.insert(m_pendingChecksums.begin(), m_pendingChecksums.end());
+    m_unsentMetadataChecksums.insert(m_pendingMetadataChecksums.begin(), m_pendingMetadataChecksums.end());
+
+    m_pendingChecksumBatches.clear();
+    m_pendingChecksums.clear();
+    m_pendingMetadataChecksums.clear();
+}
+
+void ResourceStreamManager::VerifyCachedResources()
+{
+    std::list<ResourceChecksumContainer> resList;
+    ResourceChecksumContainer res;
+
+    // responses to packets sent during previous connection will never come
+    m_pendingChecksumBatches.clear();
+    m_pendingChecksums.clear();
+    m_pendingMetadataChecksums.clear();
+    m_unsentChecksums.clear();
+    m_unsentMetadataChecksums.clear();
+
+    // all cached images go in as few packets as possible
+    ImageRecordMap const& images = sImageStorage->GetImageRecords();
+    for (ImageRecordMap::const_iterator itr = images.begin(); itr != images.end(); ++itr)
+    {
+        res.type = RSTYPE_IMAGE;
+        res.id = itr->second.id;
+        res.checksum = itr->second.checksumStr.c_str();
+        resList.push_back(res);
+    }
+
+    SendVerifyChecksumsPacket(resList);
+
+    // there's no multi-item metadata verify packet, but all of them are sent at once in single flush anyway
+    ImageMetaRecordMap const& metadata = sImageStorage->GetImageMetadataRecords();
+    for (ImageMetaRecordMap::const_iterator itr = metadata.begin(); itr != metadata.end(); ++itr)
+        SendVerifyMetadataChecksumPacket(RSTYPE_IMAGE, itr->second.id, itr->second.checksum.c_str());
+
+    sLog->Info("Verifying %u cached images and %u image metadata records", (uint32_t)m_pendingChecksums.size(), (uint32_t)m_pendingMetadataChecksums.size());
+}
+
+void ResourceStreamManager::SignalChecksumsVerified(uint32_t batchId, std::set<uint64_t> &failed)
+{
+    // without batch ID, the server replies in order of requests
+    std::map<uint32_t, std::vector<uint64_t>>::iterator batchItr = (batchId == 0) ? m_pendingChecksumBatches.begin() : m_pendingChecksumBatches.find(batchId);
+
+    // response without request, nothing to pair it with
+    if (batchItr == m_pendingChecksumBatches.end())
+    {
+        sLog->Error("Received checksum verify result of unknown batch %u", batchId);
+        return;
+    }
+
+    std::vector<uint64_t> batch;
+    batch.swap(batchItr->second);
+    m_pendingChecksumBatches.erase(batchItr);
+
+    // results are stored persistently, all at once
+    sVerificationStorage->BeginTransaction();
+
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        ResourceType type = (ResourceType)(batch[i] & 0xFFFFFFFF);
+        uint32_t id = (uint32_t)(batch[i] >> 32);
+        bool valid = (failed.find(batch[i]) == failed.end());
+
+        m_pendingChecksums.erase(batch[i]);
+
+        if (valid)
+            SetResourceChecksumVerified(type, id);
+
+        sResourceManager->SignalResourceVerified(type, id, valid);
+    }
+
+    sVerificationStorage->CommitTransaction();
+}
+
+void ResourceStreamManager::SignalMetadataChecksumVerified(ResourceType type, uint32_t id, bool valid)
+{
+    uint64_t pos = MAKE_RES_PAIR(id, type);
+    m_pendingMetadataChecksums.erase(pos);
+
+    if (valid)
+        SetMetadataChecksumVerified(type, id);
+
+    sResourceManager->SignalResourceMetadataVerified(type, id, valid);
+}
+
+const char* ResourceStreamManager::GetMetadataChecksum(ResourceType type, uint32_t id)
+{
+    if (type != RSTYPE_IMAGE)
+        return nullptr;
+
+    ImageMetadataDatabaseRecord* rec = sImageStorage->GetImageMetadataRecord(id);
+    return rec ? rec->checksum.c_str() : nullptr;
+}
+
 void ResourceStreamManager::SetResourceChecksumVerified(ResourceType type, uint32_t id)
 {
     uint64_t pos = MAKE_RES_PAIR(id, type);
     m_resourceChecksumsVerified[pos] = true;
+
+    // remember it for next sessions
+    sVerificationStorage->SetVerified(VERIFIED_CONTENT_RESOURCE, id, type, 0, sResourceManager->GetResourceFileChecksum(type, id));
 }
 
 void ResourceStreamManager::SetMetadataChecksumVerified(ResourceType type, uint32_t id)
 {
     uint64_t pos = MAKE_RES_PAIR(id, type);
     m_metadataChecksumsVerified[pos] = true;
+
+    // remember it for next sessions
+    sVerificationStorage->SetVerified(VERIFIED_CONTENT_RESOURCE_METADATA, id, type, 0, GetMetadataChecksum(type, id));
 }
 
 bool ResourceStreamManager::IsResourceChecksumVerified(ResourceType type, uint32_t id)
 {
     uint64_t pos = MAKE_RES_PAIR(id, type);
     if (m_resourceChecksumsVerified.find(pos) == m_resourceChecksumsVerified.end())
-        return false;
+    {
+        // verified in previous session with the same server content
+        if (!sVerificationStorage->IsVerified(VERIFIED_CONTENT_RESOURCE, id, type, 0, sResourceManager->GetResourceFileChecksum(type, id)))
+            return false;
+
+        m_resourceChecksumsVerified[pos] = true;
+    }
 
     return m_resourceChecksumsVerified[pos];
 }
@@ -177,7 +358,25 @@ bool ResourceStreamManager::IsMetadataChecksumVerified(ResourceType type, uint32
 {
     uint64_t pos = MAKE_RES_PAIR(id, type);
     if (m_metadataChecksumsVerified.find(pos) == m_metadataChecksumsVerified.end())
-        return false;
+    {
+        // verified in previous session with the same server content
+        if (!sVerificationStorage->IsVerified(VERIFIED_CONTENT_RESOURCE_METADATA, id, type, 0, GetMetadataChecksum(type, id)))
+            return false;
+
+        m_metadataChecksumsVerified[pos] = true;
+    }
 
     return m_metadataChecksumsVerified[pos];
 }
+
+bool ResourceStreamManager::IsResourceChecksumPending(ResourceType type, uint32_t id)
+{
+    uint64_t pos = MAKE_RES_PAIR(id, type);
+    return (m_pendingChecksums.find(pos) != m_pendingChecksums.end());
+}
+
+bool ResourceStreamManager::IsMetadataChecksumPending(ResourceType type, uint32_t id)
+{
+    uint64_t pos = MAKE_RES_PAIR(id, type);
+    return (m_pendingMetadataChecksums.find(pos) != m_pendingMetadataChecksums.end());
+}
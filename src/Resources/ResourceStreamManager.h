@@ -59,7 +59,7 @@ struct ResourceChecksumContainer
 #define MAKE_RES_PAIR(a,b) ((uint64_t)((uint64_t)a << 32 | b));
 
 // maximum number of resources in checksum verify packet
-#define MAX_CHECKSUM_VERIFY_ITEMS 50
+#define MAX_CHECKSUM_VERIFY_ITEMS 500
 
 class ResourceStreamManager
 {
@@ -70,7 +70,7 @@ class ResourceStreamManager
         // creates new resource stream record
         void CreateResourceStream(const char* filename, ResourceType type, uint32_t id);
         // writes data into opened resource stream
-        void WriteToResourceStream(ResourceType type, uint32_t id, uint16_t size, uint8_t* data);
+        void WriteToResourceStream(ResourceType type, uint32_t id, uint32_t size, const uint8_t* data);
         // finishes resource stream, closes file
         void FinishResourceStream(ResourceType type, uint32_t id);
 
@@ -80,6 +80,17 @@ class ResourceStreamManager
         void SendVerifyChecksumsPacket(std::list<ResourceChecksumContainer> &resList);
         // sends packet to verify metadata checksum of single resource
         void SendVerifyMetadataChecksumPacket(ResourceType type, uint32_t id, const char* checksum);
+        // sends checksums of all cached resources and their metadata for verification
+        void VerifyCachedResources();
+        // sends checksum verify packets again for resources, which could not be sent before
+        void ResendUnsentChecksums();
+        // marks verifications waiting for server response as unsent, so they're sent again within resumed session
+        void RequeuePendingChecksums();
+        // signals result of pending checksum verify packet with given batch ID (0 = the oldest one); the server lists
+        // just failed resources
+        void SignalChecksumsVerified(uint32_t batchId, std::set<uint64_t> &failed);
+        // signals result of resource metadata checksum verification
+        void SignalMetadataChecksumVerified(ResourceType type, uint32_t id, bool valid);
 
         // sets flag to not verify resource checksum during this run again
         void SetResourceChecksumVerified(ResourceType type, uint32_t id);
@@ -89,11 +100,18 @@ class ResourceStreamManager
         bool IsResourceChecksumVerified(ResourceType type, uint32_t id);
         // was resource metadata checksum already verified?
         bool IsMetadataChecksumVerified(ResourceType type, uint32_t id);
+        // is resource checksum verification waiting for server response?
+        bool IsResourceChecksumPending(ResourceType type, uint32_t id);
+        // is resource metadata checksum verification waiting for server response?
+        bool IsMetadataChecksumPending(ResourceType type, uint32_t id);
 
     protected:
         // protected singleton constructor
         ResourceStreamManager();
 
+        // retrieves checksum of locally stored resource metadata
+        const char* GetMetadataChecksum(ResourceType type, uint32_t id);
+
     private:
         // opened and running resource streams
         std::map<uint64_t, ResourceStreamRecord*> m_resourceStreams;
@@ -101,6 +119,18 @@ class ResourceStreamManager
         std::map<uint64_t, bool> m_resourceChecksumsVerified;
         // map of verified resource metadata checksums
         std::map<uint64_t, bool> m_metadataChecksumsVerified;
+        // resources sent in checksum verify packets by batch ID; IDs grow, so the first one is the oldest batch
+        std::map<uint32_t, std::vector<uint64_t>> m_pendingChecksumBatches;
+        // ID of the next checksum verify batch
+        uint32_t m_nextChecksumBatchId;
+        // resources with checksum verification waiting for server response
+        std::set<uint64_t> m_pendingChecksums;
+        // resources with metadata checksum verification waiting for server response
+        std::set<uint64_t> m_pendingMetadataChecksums;
+        // resources, whose checksum verify packet could not be sent
+        std::set<uint64_t> m_unsentChecksums;
+        // resources, whose metadata checksum verify packet could not be sent
+        std::set<uint64_t> m_unsentMetadataChecksums;
 };
 
 #define sResourceStreamManager Singleton<ResourceStreamManager>::getInstance()
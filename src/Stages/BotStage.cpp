@@ -0,0 +1,242 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "Stages.h"
+#include "Gameplay.h"
+#include "Application.h"
+#include "ResourceStreamManager.h"
+#include "Config.h"
+#include "Log.h"
+#include "Player.h"
+
+#include <sstream>
+
+void BotStage::OnEnter()
+{
+    m_pathIndex = 0;
+    m_pathStepStart = getMSTime();
+    m_chatIndex = 0;
+    m_lastChatTime = getMSTime();
+
+    switch (GetType())
+    {
+        // menu is the first stage - connect right away
+        case STAGE_MENU:
+            sGameplay->ConnectToServer();
+            break;
+        // in game - load script and start walking
+        case STAGE_GAME:
+            sLog->Info("Bot %s entered world", sConfig->GetStringValue(CONFIG_STRING_BOT_USERNAME));
+            LoadPath();
+            LoadChat();
+            if (!m_path.empty())
+                ApplyMoveMask(m_path[0].moveMask);
+            break;
+        default:
+            break;
+    }
+}
+
+void BotStage::OnBeforeDraw()
+{
+    if (GetType() != STAGE_GAME || !sGameplay->GetPlayer())
+        return;
+
+    UpdatePath();
+    UpdateChat();
+}
+
+void BotStage::OnGlobalAction(GlobalActionIDs actionId, void* /*actionParam*/)
+{
+    const char* username = sConfig->GetStringValue(CONFIG_STRING_BOT_USERNAME);
+
+    switch (actionId)
+    {
+        case GA_CONNECTION_CONNECTED:
+            sGameplay->Login(username, sConfig->GetStringValue(CONFIG_STRING_BOT_PASSWORD));
+            break;
+        case GA_CONNECTION_FETCHING:
+            // the same as in menu stage
+            sGameplay->RequestCharacterList();
+            sResourceStreamManager->VerifyCachedResources();
+            sApplication->SetStageType(STAGE_LOBBY);
+            break;
+        case GA_CHARACTER_LIST_ACQUIRED:
+        {
+            std::list<CharacterListRecord*> const& chars = sGameplay->GetCharacterList();
+            uint32_t index = (uint32_t)sConfig->GetIntValue(CONFIG_INT_BOT_CHARACTER);
+
+            if (index >= chars.size())
+            {
+                sLog->Error("Bot %s: character index %u not available (%u characters)", username, index, (uint32_t)chars.size());
+                sApplication->Quit(1);
+                return;
+            }
+
+            std::list<CharacterListRecord*>::const_iterator itr = chars.begin();
+            std::advance(itr, index);
+            sGameplay->EnterWorld((*itr)->guid);
+            break;
+        }
+        // there's nobody to retry for bot, just end with error
+        case GA_CONNECTION_UNABLE_TO_CONNECT:
+            // reconnection attempt of session resume failed, there may be another one
+            if (GetType() == STAGE_GAME)
+            {
+                sGameplay->SignalConnectionLost();
+                break;
+            }
+            sLog->Error("Bot %s: unable to connect", username);
+            sApplication->Quit(1);
+            break;
+        case GA_CONNECTION_INVALID_USER:
+        case GA_CONNECTION_INVALID_PASSWORD:
+        case GA_CONNECTION_INCOMPATIBLE_VERSION:
+        case GA_CONNECTION_BANNED:
+            sLog->Error("Bot %s: login refused (%u)", username, (uint32_t)actionId);
+            sApplication->Quit(1);
+            break;
+        case GA_CONNECTION_DISCONNECTED:
+            // in world, try to resume the session first
+            if (GetType() == STAGE_GAME)
+            {
+                sGameplay->SignalConnectionLost();
+                break;
+            }
+            sLog->Error("Bot %s: disconnected", username);
+            sApplication->Quit(1);
+            break;
+        case GA_CONNECTION_RESUMED:
+            sLog->Info("Bot %s resumed session", username);
+            break;
+        case GA_CONNECTION_RESUME_FAILED:
+            sLog->Error("Bot %s: disconnected, session could not be resumed", username);
+            sApplication->Quit(1);
+            break;
+        default:
+            break;
+    }
+}
+
+void BotStage::LoadPath()
+{
+    std::istringstream script(sConfig->GetStringValue(CONFIG_STRING_BOT_PATH));
+    std::string token;
+    BotPathStep step;
+
+    m_path.clear();
+
+    // every token consists of direction letters followed by duration, i.e. "UR1500"
+    while (script >> token)
+    {
+        size_t i;
+        step.moveMask = 0;
+
+        for (i = 0; i < token.length() && !isdigit(token[i]); i++)
+        {
+            switch (toupper(token[i]))
+            {
+                case 'U': step.moveMask |= MOVE_UP; break;
+                case 'D': step.moveMask |= MOVE_DOWN; break;
+                case 'L': step.moveMask |= MOVE_LEFT; break;
+                case 'R': step.moveMask |= MOVE_RIGHT; break;
+                case 'W': break;
+                default:
+                    i = token.length();
+                    break;
+            }
+        }
+
+        int64_t duration;
+        if (i >= token.length() || !str2int(duration, token.c_str() + i) || duration <= 0)
+        {
+            sLog->Error("Invalid bot path step: %s", token.c_str());
+            continue;
+        }
+
+        step.duration = (uint32_t)duration;
+        m_path.push_back(step);
+    }
+}
+
+void BotStage::LoadChat()
+{
+    std::istringstream chat(sConfig->GetStringValue(CONFIG_STRING_BOT_CHAT));
+    std::string msg;
+
+    m_chatMessages.clear();
+
+    // messages are separated by '|' character
+    while (std::getline(chat, msg, '|'))
+    {
+        msg = str_trim(msg);
+        if (msg.length() > 0)
+            m_chatMessages.push_back(UTF8ToWString(msg));
+    }
+}
+
+void BotStage::ApplyMoveMask(uint8_t moveMask)
+{
+    Player* plr = sGameplay->GetPlayer();
+    if (!plr)
+        return;
+
+    static const MoveDirectionElement directions[] = { MOVE_UP, MOVE_RIGHT, MOVE_DOWN, MOVE_LEFT };
+
+    // act like player pressing and releasing keys, so the real movement code is used
+    for (MoveDirectionElement dir : directions)
+    {
+        bool press = (moveMask & dir) != 0;
+        if (press != plr->IsMovingInDirection(dir))
+            sGameplay->MovementKeyEvent(dir, press);
+    }
+}
+
+void BotStage::UpdatePath()
+{
+    if (m_path.empty())
+        return;
+
+    uint32_t now = getMSTime();
+    if (getMSTimeDiff(m_pathStepStart, now) < m_path[m_pathIndex].duration)
+        return;
+
+    // move to next step, and loop at the end
+    m_pathIndex = (m_pathIndex + 1) % m_path.size();
+    m_pathStepStart = now;
+
+    ApplyMoveMask(m_path[m_pathIndex].moveMask);
+}
+
+void BotStage::UpdateChat()
+{
+    uint32_t interval = (uint32_t)sConfig->GetIntValue(CONFIG_INT_BOT_CHAT_INTERVAL);
+    if (interval == 0 || m_chatMessages.empty())
+        return;
+
+    uint32_t now = getMSTime();
+    if (getMSTimeDiff(m_lastChatTime, now) < interval)
+        return;
+
+    sGameplay->SendChat(TALK_SAY, m_chatMessages[m_chatIndex].c_str());
+
+    m_chatIndex = (m_chatIndex + 1) % m_chatMessages.size();
+    m_lastChatTime = now;
+}
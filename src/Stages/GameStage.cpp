@@ -128,7 +128,26 @@ void GameStage::OnUIAction(uint32_t elementId, UIActionType actionId)
 
 void GameStage::OnGlobalAction(GlobalActionIDs actionId, void* actionParam)
 {
-    //
+    switch (actionId)
+    {
+        // try to get back to the same session; gameplay class decides whether it's possible
+        case GA_CONNECTION_DISCONNECTED:
+        case GA_CONNECTION_UNABLE_TO_CONNECT:
+            sGameplay->SignalConnectionLost();
+            break;
+        case GA_CONNECTION_RESUMING:
+            sDrawing->AddUIWidget(SplashMessageWidget::Create(SPLASH_TYPE_NORMAL, 500, FONT_MAIN, L"Connection lost, reconnecting...", false));
+            break;
+        case GA_CONNECTION_RESUMED:
+            sDrawing->RemoveUIWidgetsOfType(UIWIDGET_SPLASHMESSAGE);
+            break;
+        // the player has to log in again
+        case GA_CONNECTION_RESUME_FAILED:
+            sApplication->SetStageType(STAGE_MENU);
+            break;
+        default:
+            break;
+    }
 }
 
 void GameStage::OpenChat()
@@ -27,6 +27,7 @@
 #include "Stages.h"
 #include "Gameplay.h"
 #include "Application.h"
+#include "ResourceStreamManager.h"
 
 enum MenuStageElementIDs
 {
@@ -160,6 +161,8 @@ void MenuStage::OnGlobalAction(GlobalActionIDs actionId, void* actionParam)
             sDrawing->AddUIWidget(SplashMessageWidget::Create(SPLASH_TYPE_NORMAL, 500, FONT_MAIN, L"Fetching data...", false));
             // request character list and move to lobby stage
             sGameplay->RequestCharacterList();
+            // verify the whole local cache while the character list loads, so the world is shown from verified data only
+            sResourceStreamManager->VerifyCachedResources();
             sApplication->SetStageType(STAGE_LOBBY);
             break;
         case GA_CONNECTION_SUCCESS:
@@ -56,6 +56,9 @@ class StageTemplate
         // called when global action occured
         virtual void OnGlobalAction(GlobalActionIDs actionId, void* actionParam) { };
 
+        // retrieves stage type
+        StageType GetType() { return m_type; };
+
     protected:
         // protected constructor; instantiate only child classes
         StageTemplate(StageType type) : m_type(type) { };
@@ -166,4 +169,54 @@ class GameStage : public StageTemplate
         GamePanelWidget* m_gamePanel;
 };
 
+/*
+ * Structure of one step of bot path
+ */
+struct BotPathStep
+{
+    // movement mask to be held during this step (0 = wait)
+    uint8_t moveMask;
+    // duration of step in milliseconds
+    uint32_t duration;
+};
+
+/*
+ * Headless bot stage class; replaces every stage when running without window, and plays script from config
+ */
+class BotStage : public StageTemplate
+{
+    public:
+        BotStage(StageType type) : StageTemplate(type) { };
+
+        void OnEnter();
+        void OnBeforeDraw();
+        void OnGlobalAction(GlobalActionIDs actionId, void* actionParam);
+
+    protected:
+        // parses path script from config
+        void LoadPath();
+        // parses chat messages from config
+        void LoadChat();
+        // presses and releases movement keys to match supplied mask
+        void ApplyMoveMask(uint8_t moveMask);
+        // moves to the next step of path, when the current one is done
+        void UpdatePath();
+        // says next chat message, when it's time to do so
+        void UpdateChat();
+
+    private:
+        // steps of path walked in loop
+        std::vector<BotPathStep> m_path;
+        // index of current path step
+        uint32_t m_pathIndex;
+        // time of current path step start
+        uint32_t m_pathStepStart;
+        // chat messages said in loop
+        std::vector<std::wstring> m_chatMessages;
+        // index of next chat message
+        uint32_t m_chatIndex;
+        // time of last chat message
+        uint32_t m_lastChatTime;
+};
+
 #endif
@@ -29,6 +29,7 @@ enum FileDBStorageTypes
     SQLITE_DB_MAP = 1,
     SQLITE_DB_ITEMCACHE = 2,
     SQLITE_DB_INTERNAL_IMAGE = 3,
+    SQLITE_DB_VERIFICATION = 4,
     MAX_SQLITE_DB
 };
 
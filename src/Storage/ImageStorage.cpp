@@ -213,3 +213,13 @@ void ImageStorage::WipeImageMetadata(uint32_t id)
     DBExecute("DELETE FROM image_anims WHERE id = %u", id);
     DBExecute("DELETE FROM image_metadata WHERE id = %u", id);
 }
+
+ImageRecordMap const& ImageStorage::GetImageRecords()
+{
+    return m_imageRecords;
+}
+
+ImageMetaRecordMap const& ImageStorage::GetImageMetadataRecords()
+{
+    return m_imageMetadata;
+}
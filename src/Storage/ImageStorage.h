@@ -144,6 +144,10 @@ class ImageStorage : public FileStorage
         ImageAnimationDatabaseRecord* GetImageAnimationRecord(uint32_t id, uint32_t animId);
         // wipes all image metadata including animations
         void WipeImageMetadata(uint32_t id);
+        // retrieves all image records
+        ImageRecordMap const& GetImageRecords();
+        // retrieves all image metadata records
+        ImageMetaRecordMap const& GetImageMetadataRecords();
 
     protected:
         //
@@ -26,13 +26,15 @@
 #include "MapStorage.h"
 #include "ItemCacheStorage.h"
 #include "InternalImageStorage.h"
+#include "VerificationStorage.h"
 
 // array of file storages to load
 static FileDBStorageParams fileDatabases[MAX_SQLITE_DB] = {
     { "images.db", instantiateFileStorage<ImageStorage> },
     { "maps.db", instantiateFileStorage<MapStorage> },
     { "itemcache.db", instantiateFileStorage<ItemCacheStorage> },
-    { "internal/internalimages.db", instantiateFileStorage<InternalImageStorage> }
+    { "internal/internalimages.db", instantiateFileStorage<InternalImageStorage> },
+    { "verification.db", instantiateFileStorage<VerificationStorage> }
 };
 
 StorageManager::StorageManager()
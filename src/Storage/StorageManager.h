@@ -27,6 +27,7 @@
 #include "MapStorage.h"
 #include "ItemCacheStorage.h"
 #include "InternalImageStorage.h"
+#include "VerificationStorage.h"
 
 /*
  * Singleton class for managing any type of storage
@@ -59,5 +60,6 @@ class StorageManager
 #define sMapStorage ((MapStorage*)sStorageManager->GetFileStorage(SQLITE_DB_MAP))
 #define sItemCache ((ItemCacheStorage*)sStorageManager->GetFileStorage(SQLITE_DB_ITEMCACHE))
 #define sInternalImageStorage ((InternalImageStorage*)sStorageManager->GetFileStorage(SQLITE_DB_INTERNAL_IMAGE))
+#define sVerificationStorage ((VerificationStorage*)sStorageManager->GetFileStorage(SQLITE_DB_VERIFICATION))
 
 #endif
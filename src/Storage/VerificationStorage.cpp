@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "General.h"
+#include "VerificationStorage.h"
+#include "Log.h"
+
+VerificationStorage::VerificationStorage() : FileStorage(SQLITE_DB_VERIFICATION)
+{
+    m_storedEpoch = 0;
+    m_activeEpoch = 0;
+}
+
+VerificationStorage::~VerificationStorage()
+{
+    //
+}
+
+void VerificationStorage::CreateTablesIfNotExist()
+{
+    DBExecute("CREATE TABLE IF NOT EXISTS content_epoch (epoch INTEGER);");
+    DBExecute("CREATE TABLE IF NOT EXISTS verified_content (type INTEGER, id INTEGER, sub_a INTEGER, sub_b INTEGER, checksum TEXT);");
+}
+
+void VerificationStorage::Load()
+{
+    m_verified.clear();
+    m_storedEpoch = 0;
+
+    Query* qr = DBQuery("SELECT epoch FROM content_epoch");
+
+    if (qr->num_rows() > 0 && qr->fetch_row())
+        m_storedEpoch = qr->getuval();
+
+    qr->free_result();
+    delete qr;
+
+    qr = DBQuery("SELECT type, id, sub_a, sub_b, checksum FROM verified_content");
+
+    uint32_t count = 0;
+    uint8_t type;
+    uint32_t id, subA, subB;
+
+    if (qr->num_rows() > 0)
+    {
+        while (qr->fetch_row())
+        {
+            type = (uint8_t)qr->getuval();
+            id = qr->getuval();
+            subA = qr->getuval();
+            subB = qr->getuval();
+            m_verified[VerifiedContentKey(type, id, subA, subB)] = qr->getstr();
+            count++;
+        }
+    }
+
+    qr->free_result();
+    delete qr;
+
+    sLog->Info("VerificationStorage: Loaded %u verified checksums of content epoch %u", count, m_storedEpoch);
+}
+
+void VerificationStorage::SetContentEpoch(uint32_t epoch)
+{
+    m_activeEpoch = epoch;
+
+    // server does not tell us, whether the content changed; we have to verify everything
+    if (epoch == 0 || epoch == m_storedEpoch)
+        return;
+
+    sLog->Info("VerificationStorage: content epoch changed from %u to %u, discarding verified checksums", m_storedEpoch, epoch);
+
+    DBExecute("DELETE FROM verified_content;");
+    DBExecute("DELETE FROM content_epoch;");
+    DBExecute("INSERT INTO content_epoch (epoch) VALUES (%u);", epoch);
+
+    m_verified.clear();
+    m_storedEpoch = epoch;
+}
+
+uint32_t VerificationStorage::GetContentEpoch()
+{
+    return m_activeEpoch;
+}
+
+bool VerificationStorage::IsVerified(VerifiedContentType type, uint32_t id, uint32_t subA, uint32_t subB, const char* checksum)
+{
+    if (m_activeEpoch == 0 || m_activeEpoch != m_storedEpoch || !checksum)
+        return false;
+
+    VerifiedContentMap::iterator itr = m_verified.find(VerifiedContentKey((uint8_t)type, id, subA, subB));
+    if (itr == m_verified.end())
+        return false;
+
+    // local content changed since the verification
+    return (itr->second == checksum);
+}
+
+void VerificationStorage::SetVerified(VerifiedContentType type, uint32_t id, uint32_t subA, uint32_t subB, const char* checksum)
+{
+    if (m_activeEpoch == 0 || m_activeEpoch != m_storedEpoch || !checksum)
+        return;
+
+    VerifiedContentKey key((uint8_t)type, id, subA, subB);
+
+    VerifiedContentMap::iterator itr = m_verified.find(key);
+    if (itr != m_verified.end() && itr->second == checksum)
+        return;
+
+    DBExecute("DELETE FROM verified_content WHERE type = %u AND id = %u AND sub_a = %u AND sub_b = %u;", (uint32_t)type, id, subA, subB);
+    DBExecute("INSERT INTO verified_content (type, id, sub_a, sub_b, checksum) VALUES (%u, %u, %u, %u, '%s');", (uint32_t)type, id, subA, subB, checksum);
+
+    m_verified[key] = checksum;
+}
+
+void VerificationStorage::BeginTransaction()
+{
+    DBExecute("BEGIN TRANSACTION;");
+}
+
+void VerificationStorage::CommitTransaction()
+{
+    DBExecute("COMMIT;");
+}
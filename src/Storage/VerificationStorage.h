@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2016 Martin Ubl <http://kennny.cz>
+ *
+ * This file is part of BubbleWorld MMORPG engine
+ *
+ * BubbleWorld is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BubbleWorld is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BubbleWorld. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef BW_VERIFICATIONSTORAGE_H
+#define BW_VERIFICATIONSTORAGE_H
+
+#include "FileStorage.h"
+
+// types of content, which checksum verification is remembered
+enum VerifiedContentType
+{
+    VERIFIED_CONTENT_MAP = 0,                   // map header; id = map ID
+    VERIFIED_CONTENT_MAP_CHUNK = 1,             // map chunk; id = map ID, subA = startX, subB = startY
+    VERIFIED_CONTENT_RESOURCE = 2,              // resource file; id = resource ID, subA = resource type
+    VERIFIED_CONTENT_RESOURCE_METADATA = 3,     // resource metadata; id = resource ID, subA = resource type
+    MAX_VERIFIED_CONTENT
+};
+
+// key of verified content: type, id, subA, subB
+typedef std::tuple<uint8_t, uint32_t, uint32_t, uint32_t> VerifiedContentKey;
+// map of verified content checksums
+typedef std::map<VerifiedContentKey, std::string> VerifiedContentMap;
+
+/*
+ * Class used for maintaining checksums verified by server; they stay valid as long as the server announces
+ * the same content epoch at login
+ */
+class VerificationStorage : public FileStorage
+{
+    public:
+        VerificationStorage();
+        ~VerificationStorage();
+
+        void CreateTablesIfNotExist();
+        void Load();
+
+        // sets content epoch announced by server; records of another epoch are discarded; 0 = unknown, nothing is remembered
+        void SetContentEpoch(uint32_t epoch);
+        // retrieves content epoch announced by server in current session
+        uint32_t GetContentEpoch();
+        // was the content with specified checksum verified in current content epoch?
+        bool IsVerified(VerifiedContentType type, uint32_t id, uint32_t subA, uint32_t subB, const char* checksum);
+        // remembers content with specified checksum as verified in current content epoch
+        void SetVerified(VerifiedContentType type, uint32_t id, uint32_t subA, uint32_t subB, const char* checksum);
+
+        // starts transaction, so multiple records could be stored at once
+        void BeginTransaction();
+        // commits started transaction
+        void CommitTransaction();
+
+    protected:
+        //
+
+    private:
+        // content epoch of stored records
+        uint32_t m_storedEpoch;
+        // content epoch announced by server in current session
+        uint32_t m_activeEpoch;
+        // verified content checksums
+        VerifiedContentMap m_verified;
+};
+
+#endif